@@ -1,42 +1,76 @@
 #vertex
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
+#ifdef INSTANCED
+layout (location = 3) in mat4 aModel;
+#else
+uniform mat4 model;
+#endif
+
 out vec2 fragTexCoords;
 
-uniform mat4 model;
-uniform mat4 viewProjection;
+layout (std140) uniform FrameData {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec3 cameraPosition;
+  float time;
+};
+
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
 
 out vec3 fragNormal;
 
+//Normals are octahedral encoded into two shorts
+vec3 OctDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0) {
+    vec2 sign_not_zero = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    n.xy = (1.0 - abs(n.yx)) * sign_not_zero;
+  }
+  return normalize(n);
+}
+
 void main() {
-  fragNormal = aNormal;
+  vec3 pos = aPos * positionScale + positionOffset;
+
+  fragNormal = OctDecode(clamp(aNormal / 32767.0, -1.0, 1.0));
   fragTexCoords = aTexCoords;
-  gl_Position = viewProjection * model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+  mat4 modelMatrix = aModel;
+#else
+  mat4 modelMatrix = model;
+#endif
+  gl_Position = viewProjection * modelMatrix * vec4(pos, 1.0);
 }
 
 #fragment 
 #version 330 core
 
 out vec4 fragColor;
-uniform sampler2D texture0;
+uniform sampler2DArray texture0;
 
-uniform vec3 fragBaseColor = vec3(0.0);
+layout (std140) uniform MaterialData {
+  vec4 baseColor;
+  int textureLayer;
+};
 
 in vec2 fragTexCoords;
 in vec3 fragNormal;
 
 void main() {
 
-  vec4 texColor = texture(texture0, fragTexCoords);
+  vec4 texColor = texture(texture0, vec3(fragTexCoords, float(textureLayer)));
 
   if (texColor == vec4(0.0, 0.0, 0.0, 1.0)) {
     texColor = vec4(1.0);
   }
 
 
-  fragColor = texColor * vec4(fragBaseColor, 1.0) * vec4(fragNormal, 1.0);  
+  fragColor = texColor * vec4(baseColor.rgb, 1.0) * vec4(fragNormal, 1.0);  
 }
 
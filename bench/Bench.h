@@ -0,0 +1,41 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <LinearMath/btVector3.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../src/Core/MapLoader.h"
+
+//Wall clock stopwatch, starts on construction
+class BenchTimer {
+public:
+  BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+
+  double GetElapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+  }
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+//Paths are relative to bin/<config>, same as the engine's
+constexpr const char* kBenchLevelPath = "../../assets/leveldata/level3.json";
+constexpr const char* kBenchMapPath = "../../assets/map3.gltf";
+
+//Thread counts to run scaling benchmarks at, 1, 2, 4 ... up to the hardware thread count
+std::vector<unsigned int> GetBenchThreadCounts();
+
+//World space box around a level's colliders, ignoring their rotation
+void GetColliderBounds(const std::vector<MapLoader::Collider>& colliders, btVector3& min, btVector3& max);
+
+void RunJobSystemBench();
+void RunPhysicsBench();
+void RunQueryBench();
+void RunBvhBench();
+void RunUniformBench();
+void RunModelLoadBench();
+void RunTextureCookBench();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "Bench.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../src/Graphics/Bvh.h"
+#include "../src/Graphics/FrustumCulling.h"
+#include "../src/Graphics/ModelLoader.h"
+
+//Build, refit and query times for the scene BVH over the bounds of every
+//map3 primitive. The map is small, so it's also tiled into a grid of copies
+//to see how things scale to bigger levels.
+
+static const unsigned int kTilesPerSide[] = { 1, 8, 32 };
+static const size_t kQueryCount = 10000;
+static const size_t kFrustumCount = 1000;
+static const size_t kNearestCount = 8;
+static const int kRepeats = 5;
+
+static glm::mat4 TransformToMatrix(const TransformComponent& transform) {
+  glm::mat4 matrix(1.0);
+  matrix = glm::translate(matrix, transform.position_);
+  matrix = matrix * glm::mat4(transform.rotation_);
+  matrix = glm::scale(matrix, transform.scale_);
+  return matrix;
+}
+
+//Same boxes UpdateBounds gives the map at the origin
+static BoundingBoxes GatherMeshBounds(Model& model) {
+  std::vector<glm::vec3> centers;
+  std::vector<glm::vec3> extents;
+
+  for (const Mesh& mesh : model.GetMeshes()) {
+    glm::mat4 matrix = TransformToMatrix(mesh.local_transform_);
+    for (const PrimitiveData& primitive : mesh.primitives_) {
+      glm::vec3 center, extent;
+      TransformBounds(matrix, primitive.bounds_center_, primitive.bounds_extents_, center, extent);
+      centers.push_back(center);
+      extents.push_back(extent);
+    }
+  }
+
+  BoundingBoxes boxes;
+  boxes.Resize(centers.size());
+  for (size_t i = 0; i < centers.size(); ++i) {
+    boxes.Set(i, centers[i], extents[i]);
+  }
+  return boxes;
+}
+
+static glm::vec3 GetExtents(const BoundingBoxes& boxes, const size_t& index) {
+  return glm::vec3(boxes.extent_x_[index], boxes.extent_y_[index], boxes.extent_z_[index]);
+}
+
+static void GetBounds(const BoundingBoxes& boxes, glm::vec3& min, glm::vec3& max) {
+  min = glm::vec3(0.f);
+  max = glm::vec3(0.f);
+  for (size_t i = 0; i < boxes.Size(); ++i) {
+    glm::vec3 center = boxes.GetCenter(i);
+    glm::vec3 extents = GetExtents(boxes, i);
+    min = i == 0 ? center - extents : glm::min(min, center - extents);
+    max = i == 0 ? center + extents : glm::max(max, center + extents);
+  }
+}
+
+//tiles x tiles copies of boxes side by side on the ground plane
+static BoundingBoxes TileBoxes(const BoundingBoxes& boxes, const unsigned int& tiles) {
+  glm::vec3 min, max;
+  GetBounds(boxes, min, max);
+  glm::vec3 size = max - min;
+
+  BoundingBoxes tiled;
+  tiled.Resize(boxes.Size() * tiles * tiles);
+
+  size_t index = 0;
+  for (unsigned int x = 0; x < tiles; ++x) {
+    for (unsigned int z = 0; z < tiles; ++z) {
+      glm::vec3 offset(size.x * x, 0.f, size.z * z);
+      for (size_t i = 0; i < boxes.Size(); ++i) {
+        tiled.Set(index++, boxes.GetCenter(i) + offset, GetExtents(boxes, i));
+      }
+    }
+  }
+  return tiled;
+}
+
+//Fastest of kRepeats runs in milliseconds
+template<typename Function>
+static double RunBest(Function function) {
+  double best = 0.0;
+  for (int i = 0; i < kRepeats; ++i) {
+    BenchTimer timer;
+    function();
+    double time = timer.GetElapsedMs();
+    best = i == 0 ? time : std::min(best, time);
+  }
+  return best;
+}
+
+//results is node count for build and refit, the average per query for
+//culling and box queries and the number of hits for rays
+static void PrintResult(const char* name, const size_t& boxes, const double& time, const size_t& operations, const size_t& results) {
+  std::printf("%-12s %8zu %10.3f %12.3f %10zu\n", name, boxes, time, time * 1000.0 / static_cast<double>(operations), results);
+}
+
+static void RunCases(const BoundingBoxes& boxes) {
+  glm::vec3 min, max;
+  GetBounds(boxes, min, max);
+  glm::vec3 size = max - min;
+
+  std::mt19937 generator(1234);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  auto random_point = [&]() { return min + size * glm::vec3(unit(generator), unit(generator), unit(generator)); };
+
+  Bvh bvh;
+  double build_time = RunBest([&bvh, &boxes]() { bvh.Build(boxes); });
+  PrintResult("build", boxes.Size(), build_time, 1, bvh.GetNodeCount());
+
+  //Same tree, every box nudged like a moving model would be
+  BoundingBoxes moved = boxes;
+  for (size_t i = 0; i < moved.Size(); ++i) {
+    moved.Set(i, moved.GetCenter(i) + glm::vec3(0.1f, 0.f, 0.f), GetExtents(moved, i));
+  }
+  double refit_time = RunBest([&bvh, &moved]() { bvh.Refit(moved); });
+  PrintResult("refit", boxes.Size(), refit_time, 1, bvh.GetNodeCount());
+  bvh.Build(boxes);
+
+  //Cameras a little above the map looking somewhere across it
+  std::vector<Frustum> frustums(kFrustumCount);
+  glm::mat4 projection = glm::perspective(glm::radians(70.f), 16.f / 9.f, 0.1f, 100.f);
+  for (Frustum& frustum : frustums) {
+    glm::vec3 eye = random_point() + glm::vec3(0.f, 2.f, 0.f);
+    glm::vec3 target = random_point();
+    frustum = ExtractFrustum(projection * glm::lookAt(eye, target, glm::vec3(0.f, 1.f, 0.f)));
+  }
+
+  std::vector<unsigned char> visible;
+  size_t visible_count = 0;
+  double flat_time = RunBest([&]() {
+    visible_count = 0;
+    for (const Frustum& frustum : frustums) {
+      CullBoxes(frustum, boxes, visible);
+      visible_count += std::count(visible.begin(), visible.end(), 1);
+    }
+  });
+  PrintResult("cull flat", boxes.Size(), flat_time, frustums.size(), visible_count / frustums.size());
+
+  double tree_time = RunBest([&]() {
+    visible_count = 0;
+    for (const Frustum& frustum : frustums) {
+      bvh.CullFrustum(frustum, visible);
+      visible_count += std::count(visible.begin(), visible.end(), 1);
+    }
+  });
+  PrintResult("cull bvh", boxes.Size(), tree_time, frustums.size(), visible_count / frustums.size());
+
+  //Query boxes about a twentieth of the map across
+  std::vector<glm::vec3> query_points(kQueryCount);
+  std::vector<glm::vec3> query_vectors(kQueryCount);
+  for (size_t i = 0; i < kQueryCount; ++i) {
+    query_points[i] = random_point();
+    query_vectors[i] = random_point() - query_points[i];
+  }
+
+  std::vector<unsigned int> results;
+  size_t result_count = 0;
+  glm::vec3 query_extents = size * 0.025f;
+  double overlap_time = RunBest([&]() {
+    result_count = 0;
+    for (const glm::vec3& point : query_points) {
+      results.clear();
+      bvh.QueryOverlap(point - query_extents, point + query_extents, results);
+      result_count += results.size();
+    }
+  });
+  PrintResult("overlap", boxes.Size(), overlap_time, kQueryCount, result_count / kQueryCount);
+
+  double ray_time = RunBest([&]() {
+    result_count = 0;
+    for (size_t i = 0; i < kQueryCount; ++i) {
+      unsigned int primitive;
+      float distance;
+      result_count += bvh.Raycast(query_points[i], query_vectors[i], 1.f, primitive, distance) ? 1 : 0;
+    }
+  });
+  PrintResult("ray", boxes.Size(), ray_time, kQueryCount, result_count);
+
+  double nearest_time = RunBest([&]() {
+    result_count = 0;
+    for (const glm::vec3& point : query_points) {
+      results.clear();
+      bvh.QueryNearest(point, kNearestCount, results);
+      result_count += results.size();
+    }
+  });
+  PrintResult("nearest 8", boxes.Size(), nearest_time, kQueryCount, result_count / kQueryCount);
+}
+
+void RunBvhBench() {
+  Model model;
+  if (!model.LoadModel(kBenchMapPath)) {
+    std::printf("Could not load %s\n", kBenchMapPath);
+    return;
+  }
+  BoundingBoxes boxes = GatherMeshBounds(model);
+
+  std::printf("%-12s %8s %10s %12s %10s\n", "case", "boxes", "ms", "us/op", "results");
+  for (const unsigned int& tiles : kTilesPerSide) {
+    RunCases(TileBoxes(boxes, tiles));
+  }
+}
\ No newline at end of file
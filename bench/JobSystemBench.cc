@@ -0,0 +1,102 @@
+#include "Bench.h"
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include "../src/Core/JobSystem.h"
+
+//Measures what the job system costs on top of the work itself, every job here
+//is empty or close to it so the numbers are pure spawn, steal and wait overhead
+
+static const unsigned int kFlatJobs = 100000;
+static const unsigned int kNestedParents = 256;
+static const unsigned int kNestedChildren = 256;
+static const size_t kParallelForCount = 1 << 20;
+static const size_t kParallelForGrain = 1024;
+static const int kRepeats = 5;
+
+struct JobBenchResult {
+  double time_ = 0.0;
+  unsigned long long jobs_ = 0;
+  unsigned long long stolen_ = 0;
+};
+
+//Keeps the fastest of kRepeats runs, the rest is scheduler noise
+template<typename Function>
+static JobBenchResult RunBest(Function function) {
+  JobBenchResult best;
+  for (int i = 0; i < kRepeats; ++i) {
+    JobSystem::Stats before = JobSystem::GetStats();
+    BenchTimer timer;
+    function();
+    double time = timer.GetElapsedMs();
+    JobSystem::Stats after = JobSystem::GetStats();
+
+    if (i == 0 || time < best.time_) {
+      best.time_ = time;
+      best.jobs_ = after.jobs_executed_ - before.jobs_executed_;
+      best.stolen_ = after.jobs_stolen_ - before.jobs_stolen_;
+    }
+  }
+  return best;
+}
+
+static void PrintResult(const char* name, const unsigned int& threads, const JobBenchResult& result) {
+  double ns_per_job = result.jobs_ > 0 ? result.time_ * 1e6 / static_cast<double>(result.jobs_) : 0.0;
+  double stolen_percent = result.jobs_ > 0 ? 100.0 * static_cast<double>(result.stolen_) / static_cast<double>(result.jobs_) : 0.0;
+  std::printf("%-14s %7u %10.3f %10llu %9.1f %8.1f%%\n", name, threads, result.time_, result.jobs_, ns_per_job, stolen_percent);
+}
+
+//Every job pushed from the main thread, workers can only get work by stealing
+static void FlatSpawn() {
+  JobCounter counter;
+  for (unsigned int i = 0; i < kFlatJobs; ++i) {
+    JobSystem::Submit([]() {}, &counter);
+  }
+  JobSystem::Wait(counter);
+}
+
+//Parents spawn onto their own deque, mostly local pops once the parents are spread out
+static void NestedSpawn() {
+  JobCounter counter;
+  for (unsigned int i = 0; i < kNestedParents; ++i) {
+    JobSystem::Submit([&counter]() {
+      for (unsigned int j = 0; j < kNestedChildren; ++j) {
+        JobSystem::Submit([]() {}, &counter);
+      }
+    }, &counter);
+  }
+  JobSystem::Wait(counter);
+}
+
+static void ParallelForSum() {
+  static std::vector<unsigned int> values(kParallelForCount, 1);
+  std::atomic<unsigned long long> sum = 0;
+
+  JobSystem::ParallelFor(values.size(), kParallelForGrain, [&sum](size_t begin, size_t end) {
+    unsigned long long partial = 0;
+    for (size_t i = begin; i < end; ++i) {
+      partial += values[i];
+    }
+    sum.fetch_add(partial, std::memory_order_relaxed);
+  });
+
+  if (sum != kParallelForCount) {
+    std::printf("ParallelFor sum mismatch: %llu\n", sum.load());
+  }
+}
+
+void RunJobSystemBench() {
+  std::printf("%-14s %7s %10s %10s %9s %9s\n", "case", "threads", "ms", "jobs", "ns/job", "stolen");
+
+  for (const unsigned int& threads : GetBenchThreadCounts()) {
+    JobSystem::Initialize(threads - 1);
+
+    PrintResult("flat spawn", threads, RunBest(FlatSpawn));
+    PrintResult("nested spawn", threads, RunBest(NestedSpawn));
+    PrintResult("parallel for", threads, RunBest(ParallelForSum));
+
+    JobSystem::Shutdown();
+  }
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "Bench.h"
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../src/Graphics/ModelLoader.h"
+
+//Allocations and copied bytes per model on top of what parsing the glTF
+//already costs. "before" replays the primitive extraction Model did when
+//PrimitiveData owned std::vectors, "after" is Model::LoadModel today with the
+//mesh cache, optimizer, LODs and texture cooking off so only extraction and
+//vertex packing are left.
+
+static const char* const kBenchModels[] = {
+  "../../assets/simple_plane.gltf",
+  "../../assets/ball.gltf",
+  "../../assets/better.gltf",
+  "../../assets/grassblock.gltf",
+  "../../assets/leveltest.gltf",
+  "../../assets/map.gltf",
+  "../../assets/map2.gltf",
+  "../../assets/map3.gltf",
+};
+
+//Every operator new in the bench goes through here, but only counts while
+//CountAllocations runs so the other benchmarks don't pay for the atomics
+static std::atomic<bool> counting_allocations = false;
+static std::atomic<size_t> allocation_count = 0;
+static std::atomic<size_t> allocated_bytes = 0;
+
+void* operator new(size_t size) {
+  if (counting_allocations.load(std::memory_order_relaxed)) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+
+  void* memory = std::malloc(size > 0 ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+struct AllocationStats {
+  size_t allocations_ = 0;
+  size_t bytes_ = 0;
+  size_t copied_ = 0;
+};
+
+template<typename Function>
+static AllocationStats CountAllocations(Function function) {
+  size_t count = allocation_count.load();
+  size_t bytes = allocated_bytes.load();
+  AllocationStats stats;
+  counting_allocations.store(true);
+  stats.copied_ = function();
+  counting_allocations.store(false);
+  stats.allocations_ = allocation_count.load() - count;
+  stats.bytes_ = allocated_bytes.load() - bytes;
+  return stats;
+}
+
+static size_t legacy_copied_bytes = 0;
+
+//Owned bytes like the old PrimitiveData members, counting every copy into them
+struct LegacyBytes {
+  std::vector<unsigned char> data_;
+
+  LegacyBytes() = default;
+  LegacyBytes(const unsigned char* begin, const unsigned char* end) : data_(begin, end) { legacy_copied_bytes += data_.size(); }
+  LegacyBytes(const LegacyBytes& other) : data_(other.data_) { legacy_copied_bytes += data_.size(); }
+  LegacyBytes(LegacyBytes&&) = default;
+  LegacyBytes& operator=(const LegacyBytes& other) {
+    data_ = other.data_;
+    legacy_copied_bytes += data_.size();
+    return *this;
+  }
+  LegacyBytes& operator=(LegacyBytes&&) = default;
+};
+
+struct LegacyPrimitive {
+  LegacyBytes position_;
+  LegacyBytes normal_;
+  LegacyBytes texcoords_;
+  LegacyBytes indices_;
+  LegacyBytes texture_data_;
+  std::string material_name_;
+};
+
+struct LegacyMesh {
+  std::vector<LegacyPrimitive> primitives_;
+};
+
+//The old code copied whole buffer views, not just the accessor's range
+static LegacyBytes CopyBufferView(const tinygltf::Accessor& accessor, const tinygltf::Model& model) {
+  const tinygltf::BufferView& buffer_view = model.bufferViews[accessor.bufferView];
+  const unsigned char* begin = model.buffers[buffer_view.buffer].data.data() + buffer_view.byteOffset;
+  return LegacyBytes(begin, begin + buffer_view.byteLength);
+}
+
+//Same copies as the old ProcessMesh: into the PrimitiveData, again on
+//push_back, returned by value
+static std::vector<LegacyPrimitive> LegacyProcessMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model) {
+  std::vector<LegacyPrimitive> primitives;
+  for (const tinygltf::Primitive& primitive : mesh.primitives) {
+    LegacyPrimitive primitive_data;
+    primitive_data.indices_ = CopyBufferView(model.accessors[primitive.indices], model);
+
+    for (const auto& attribute : primitive.attributes) {
+      const tinygltf::Accessor& accessor = model.accessors[attribute.second];
+      if (attribute.first == "POSITION") {
+        primitive_data.position_ = CopyBufferView(accessor, model);
+      } else if (attribute.first == "TEXCOORD_0") {
+        primitive_data.texcoords_ = CopyBufferView(accessor, model);
+      } else if (attribute.first == "NORMAL") {
+        primitive_data.normal_ = CopyBufferView(accessor, model);
+      }
+    }
+
+    const tinygltf::Material& material = model.materials[primitive.material];
+    if (material.pbrMetallicRoughness.baseColorTexture.index > -1) {
+      const tinygltf::Texture& base_texture = model.textures[material.pbrMetallicRoughness.baseColorTexture.index];
+      const tinygltf::Image& image = model.images[base_texture.source];
+      primitive_data.material_name_ = image.name;
+      primitive_data.texture_data_ = LegacyBytes(image.image.data(), image.image.data() + image.image.size());
+    }
+
+    primitives.push_back(primitive_data);
+  }
+  return primitives;
+}
+
+//Copied into a local Mesh, then copied again into meshes_
+static void LegacyProcessNodes(const tinygltf::Node& node, const tinygltf::Model& model, std::vector<LegacyMesh>& meshes) {
+  LegacyMesh new_mesh;
+  new_mesh.primitives_ = LegacyProcessMesh(model.meshes[node.mesh], model);
+  meshes.push_back(new_mesh);
+
+  for (const int& child : node.children) {
+    LegacyProcessNodes(model.nodes[child], model, meshes);
+  }
+}
+
+static bool ParseModel(const std::string& filename, tinygltf::Model& model) {
+  tinygltf::TinyGLTF loader;
+  std::string warning, error;
+  return loader.LoadASCIIFromFile(&model, &error, &warning, filename) && !model.scenes.empty();
+}
+
+static void PrintStats(const char* model, const char* name, const AllocationStats& stats) {
+  std::printf("%-20s %-7s %10zu %12.1f %12.1f\n", model, name, stats.allocations_, stats.bytes_ / 1024.0, stats.copied_ / 1024.0);
+}
+
+void RunModelLoadBench() {
+  ModelLoadOptions options;
+  options.mesh_optimize_.enabled_ = false;
+  options.lod_.max_lods_ = 1;
+  options.texture_cook_.enabled_ = false;
+  options.use_mesh_cache_ = false;
+
+  std::printf("before and after are on top of parse, after copies only while packing vertices\n");
+  std::printf("%-20s %-7s %10s %12s %12s\n", "model", "case", "allocs", "alloc KB", "copied KB");
+
+  for (const char* filename : kBenchModels) {
+    std::string name = std::string(filename).substr(std::string(filename).find_last_of('/') + 1);
+
+    bool parsed = true;
+    AllocationStats parse = CountAllocations([&filename, &parsed]() {
+      tinygltf::Model model;
+      parsed = ParseModel(filename, model);
+      return size_t(0);
+    });
+    if (!parsed) {
+      std::printf("Could not load %s\n", filename);
+      continue;
+    }
+
+    AllocationStats before = CountAllocations([&filename]() {
+      tinygltf::Model model;
+      ParseModel(filename, model);
+
+      legacy_copied_bytes = 0;
+      std::vector<LegacyMesh> meshes;
+      int scene = model.defaultScene >= 0 ? model.defaultScene : 0;
+      for (const int& node : model.scenes[scene].nodes) {
+        LegacyProcessNodes(model.nodes[node], model, meshes);
+      }
+      return legacy_copied_bytes;
+    });
+
+    AllocationStats after = CountAllocations([&filename, &options]() {
+      Model model;
+      model.LoadModel(filename, options);
+
+      size_t copied = 0;
+      for (const Mesh& mesh : model.GetMeshes()) {
+        for (const PrimitiveData& primitive : mesh.primitives_) {
+          copied += primitive.vertices_.size_;
+        }
+      }
+      return copied;
+    });
+
+    before.allocations_ -= parse.allocations_;
+    before.bytes_ -= parse.bytes_;
+    after.allocations_ -= parse.allocations_;
+    after.bytes_ -= parse.bytes_;
+
+    PrintStats(name.c_str(), "parse", parse);
+    PrintStats("", "before", before);
+    PrintStats("", "after", after);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "Bench.h"
+
+#include <btBulletDynamicsCommon.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "../src/Core/JobSystem.h"
+#include "../src/Physics/LevelCollision.h"
+#include "../src/Physics/PhysicsMotionState.h"
+#include "../src/Physics/PhysicsWorld.h"
+
+//Drops a pile of boxes and spheres onto the level3 colliders and times every
+//fixed step, once on the sequential world and then on the parallel one at
+//each thread count
+
+static const unsigned int kBodyCount = 1000;
+static const unsigned int kStepCount = 300;
+static const float kFixedStep = 1.f / 60.f;
+static const float kBodyHalfSize = 0.2f;
+static const float kBodySpacing = 0.6f;
+
+struct PhysicsBenchResult {
+  double mean_ = 0.0;
+  double max_ = 0.0;
+  size_t moved_ = 0;
+};
+
+void GetColliderBounds(const std::vector<MapLoader::Collider>& colliders, btVector3& min, btVector3& max) {
+  min = btVector3(0.f, 0.f, 0.f);
+  max = btVector3(0.f, 0.f, 0.f);
+
+  for (size_t i = 0; i < colliders.size(); ++i) {
+    btVector3 position(colliders[i].position_.x, colliders[i].position_.y, colliders[i].position_.z);
+    btVector3 half_extents(colliders[i].size_.x, colliders[i].size_.y, colliders[i].size_.z);
+
+    if (i == 0) {
+      min = position - half_extents;
+      max = position + half_extents;
+    }
+    min.setMin(position - half_extents);
+    max.setMax(position + half_extents);
+  }
+}
+
+//Layers of bodies on a grid over the level, alternating boxes and spheres
+static void AddBodies(PhysicsWorld& world, const btVector3& min, const btVector3& max) {
+  std::shared_ptr<btCollisionShape> box = world.AcquireBoxShape(glm::vec3(kBodyHalfSize, kBodyHalfSize, kBodyHalfSize));
+  std::shared_ptr<btCollisionShape> sphere = world.AcquireSphereShape(kBodyHalfSize);
+
+  unsigned int columns = std::max(1u, static_cast<unsigned int>((max.x() - min.x()) / kBodySpacing));
+  unsigned int rows = std::max(1u, static_cast<unsigned int>((max.z() - min.z()) / kBodySpacing));
+
+  for (unsigned int i = 0; i < kBodyCount; ++i) {
+    unsigned int column = i % columns;
+    unsigned int row = (i / columns) % rows;
+    unsigned int layer = i / (columns * rows);
+
+    btVector3 position(min.x() + (column + 0.5f) * kBodySpacing, max.y() + 1.f + layer * kBodySpacing, min.z() + (row + 0.5f) * kBodySpacing);
+    std::shared_ptr<btCollisionShape> shape = i % 2 == 0 ? box : sphere;
+
+    std::shared_ptr<PhysicsMotionState> motion_state = std::make_shared<PhysicsMotionState>(world, btTransform(btQuaternion::getIdentity(), position), i);
+    btVector3 inertia(0.f, 0.f, 0.f);
+    shape->calculateLocalInertia(1.f, inertia);
+    btRigidBody::btRigidBodyConstructionInfo construction_info(1.f, motion_state.get(), shape.get(), inertia);
+    std::shared_ptr<btRigidBody> body = std::make_shared<btRigidBody>(construction_info);
+
+    world.AddMotionState(motion_state);
+    world.AddRigidBody(body, shape);
+  }
+}
+
+static PhysicsBenchResult RunWorld(const PhysicsBackend& backend, const std::vector<MapLoader::Collider>& colliders) {
+  PhysicsWorld world(backend);
+  LevelCollision level_collision;
+  world.DisableDebug();
+
+  level_collision.AddColliders(world, colliders);
+
+  btVector3 min, max;
+  GetColliderBounds(colliders, min, max);
+  AddBodies(world, min, max);
+
+  PhysicsBenchResult result;
+  for (unsigned int step = 0; step < kStepCount; ++step) {
+    world.UpdateWorld(kFixedStep);
+    world.ClearSettledBodies();
+
+    result.mean_ += world.GetStepTime();
+    result.max_ = std::max(result.max_, world.GetStepTime());
+  }
+  result.mean_ /= kStepCount;
+  result.moved_ = world.GetMovedBodies().size();
+  return result;
+}
+
+static void PrintResult(const char* backend, const unsigned int& threads, const PhysicsBenchResult& result) {
+  std::printf("%-10s %7u %10.3f %10.3f %12zu\n", backend, threads, result.mean_, result.max_, result.moved_);
+}
+
+void RunPhysicsBench() {
+  MapLoader map;
+  map.LoadMap(kBenchLevelPath);
+  const std::vector<MapLoader::Collider>& colliders = map.GetColliders();
+
+  std::printf("%u bodies on %zu colliders, %u steps\n", kBodyCount, colliders.size(), kStepCount);
+  std::printf("%-10s %7s %10s %10s %12s\n", "backend", "threads", "mean ms", "max ms", "still moving");
+
+  JobSystem::Initialize(0);
+  PrintResult("sequential", 1, RunWorld(PhysicsBackend::kPhysicsBackendSequential, colliders));
+  JobSystem::Shutdown();
+
+#if BT_THREADSAFE
+  for (const unsigned int& threads : GetBenchThreadCounts()) {
+    JobSystem::Initialize(threads - 1);
+    PrintResult("parallel", threads, RunWorld(PhysicsBackend::kPhysicsBackendParallel, colliders));
+    JobSystem::Shutdown();
+
+    //Bullet numbers threads the first time they run its code, the next
+    //round of workers has to start again from 1
+    btResetThreadIndexCounter();
+  }
+#else
+  std::printf("parallel backend needs --bullet-threadsafe\n");
+#endif
+}
\ No newline at end of file
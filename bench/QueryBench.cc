@@ -0,0 +1,136 @@
+#include "Bench.h"
+
+#include <btBulletDynamicsCommon.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../src/Core/JobSystem.h"
+#include "../src/Physics/LevelCollision.h"
+#include "../src/Physics/PhysicsWorld.h"
+
+//Rays and sphere sweeps per second against the level3 collision, one query at
+//a time through SingleRayCast and then batched at each thread count
+
+static const size_t kRayCount = 100000;
+static const size_t kSweepCount = 20000;
+static const float kSweepRadius = 0.2f;
+static const int kRepeats = 3;
+
+//Batches only split across the workers on the parallel backend
+#if BT_THREADSAFE
+static const PhysicsBackend kQueryBackend = PhysicsBackend::kPhysicsBackendParallel;
+#else
+static const PhysicsBackend kQueryBackend = PhysicsBackend::kPhysicsBackendSequential;
+#endif
+
+//Half the queries drop straight down onto the level, the rest run in random
+//directions from inside it
+template<typename Query>
+static std::vector<Query> GenerateQueries(const size_t& count, const btVector3& min, const btVector3& max) {
+  std::mt19937 generator(1234);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+  std::vector<Query> queries(count);
+  for (size_t i = 0; i < count; ++i) {
+    btVector3 point = min + (max - min) * btVector3(unit(generator), unit(generator), unit(generator));
+
+    if (i % 2 == 0) {
+      queries[i].from_ = glm::vec3(point.x(), max.y() + 2.f, point.z());
+      queries[i].to_ = glm::vec3(point.x(), min.y() - 1.f, point.z());
+    } else {
+      btVector3 offset = btVector3(direction(generator), direction(generator), direction(generator)).normalized() * 10.f;
+      queries[i].from_ = glm::vec3(point.x(), point.y(), point.z());
+      queries[i].to_ = glm::vec3(point.x() + offset.x(), point.y() + offset.y(), point.z() + offset.z());
+    }
+  }
+  return queries;
+}
+
+static size_t CountHits(const std::vector<QueryHit>& hits) {
+  size_t count = 0;
+  for (const QueryHit& hit : hits) {
+    count += hit.IsHit() ? 1 : 0;
+  }
+  return count;
+}
+
+//Fastest of kRepeats runs in milliseconds
+template<typename Function>
+static double RunBest(Function function) {
+  double best = 0.0;
+  for (int i = 0; i < kRepeats; ++i) {
+    BenchTimer timer;
+    function();
+    double time = timer.GetElapsedMs();
+    best = i == 0 ? time : std::min(best, time);
+  }
+  return best;
+}
+
+static void PrintResult(const char* name, const unsigned int& threads, const double& time, const size_t& count, const size_t& hits) {
+  double per_second = time > 0.0 ? static_cast<double>(count) * 1000.0 / time : 0.0;
+  std::printf("%-11s %7u %10.3f %14.0f %7.1f%%\n", name, threads, time, per_second, 100.0 * static_cast<double>(hits) / static_cast<double>(count));
+}
+
+void RunQueryBench() {
+  MapLoader map;
+  map.LoadMap(kBenchLevelPath);
+
+  btVector3 min, max;
+  GetColliderBounds(map.GetColliders(), min, max);
+
+  std::vector<RayQuery> rays = GenerateQueries<RayQuery>(kRayCount, min, max);
+  std::vector<SweepQuery> sweeps = GenerateQueries<SweepQuery>(kSweepCount, min, max);
+  for (SweepQuery& sweep : sweeps) {
+    sweep.half_extents_ = glm::vec3(kSweepRadius);
+  }
+
+  std::vector<QueryHit> ray_hits(rays.size());
+  std::vector<QueryHit> sweep_hits(sweeps.size());
+
+  std::printf("%zu rays, %zu sweeps on %zu colliders\n", rays.size(), sweeps.size(), map.GetColliders().size());
+  std::printf("%-11s %7s %10s %14s %8s\n", "case", "threads", "ms", "queries/s", "hit");
+
+#if BT_THREADSAFE
+  const std::vector<unsigned int> thread_counts = GetBenchThreadCounts();
+#else
+  const std::vector<unsigned int> thread_counts = { 1 };
+#endif
+
+  for (const unsigned int& threads : thread_counts) {
+    JobSystem::Initialize(threads - 1);
+    {
+      PhysicsWorld world(kQueryBackend);
+      LevelCollision level_collision;
+      world.DisableDebug();
+      level_collision.AddColliders(world, map.GetColliders());
+
+      if (threads == 1) {
+        size_t single_hits = 0;
+        double time = RunBest([&world, &rays, &single_hits]() {
+          single_hits = 0;
+          for (const RayQuery& ray : rays) {
+            btCollisionWorld::ClosestRayResultCallback callback(btVector3(ray.from_.x, ray.from_.y, ray.from_.z), btVector3(ray.to_.x, ray.to_.y, ray.to_.z));
+            world.SingleRayCast(ray.from_, ray.to_, callback);
+            single_hits += callback.hasHit() ? 1 : 0;
+          }
+        });
+        PrintResult("single ray", threads, time, rays.size(), single_hits);
+      }
+
+      double ray_time = RunBest([&world, &rays, &ray_hits]() { world.RayCastBatch(rays.data(), rays.size(), ray_hits.data()); });
+      PrintResult("ray batch", threads, ray_time, rays.size(), CountHits(ray_hits));
+
+      double sweep_time = RunBest([&world, &sweeps, &sweep_hits]() { world.SweepBatch(sweeps.data(), sweeps.size(), sweep_hits.data()); });
+      PrintResult("sweep batch", threads, sweep_time, sweeps.size(), CountHits(sweep_hits));
+    }
+    JobSystem::Shutdown();
+
+    //Same as the physics bench, the next round of workers gets fresh Bullet thread indices
+    btResetThreadIndexCounter();
+  }
+}
\ No newline at end of file
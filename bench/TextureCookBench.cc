@@ -0,0 +1,147 @@
+#include "Bench.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/Graphics/ModelLoader.h"
+#include "../src/Graphics/TextureCooker.h"
+
+//What cooking costs on the loading thread and what it saves on the GPU for
+//the textures in our assets. Raw textures upload their base level as they
+//came from the file and the driver builds an RGBA8 chain from it, cooked ones
+//upload every block compressed level. There is no context here, so upload is
+//reported in bytes sent, which is what upload time scales with.
+
+static const char* const kBenchTextureModels[] = {
+  "../../assets/ball.gltf",
+  "../../assets/better.gltf",
+  "../../assets/grassblock.gltf",
+  "../../assets/leveltest.gltf",
+  "../../assets/map.gltf",
+  "../../assets/map2.gltf",
+  "../../assets/map3.gltf",
+};
+
+static const char* const kBenchTextureImages[] = {
+  "../../assets/smiley.png",
+};
+
+static const int kRepeats = 3;
+
+struct TextureTotals {
+  size_t raw_upload_ = 0;
+  size_t raw_memory_ = 0;
+  size_t cooked_ = 0;
+  double cook_ms_ = 0.0;
+};
+
+static const char* GetFormatName(const TextureFormat& format) {
+  switch (format) {
+    case TextureFormat::kTextureFormatBC1:
+      return "BC1";
+    case TextureFormat::kTextureFormatBC3:
+      return "BC3";
+    case TextureFormat::kTextureFormatBC5:
+      return "BC5";
+    default:
+      return "RGBA8";
+  }
+}
+
+//glTexImage3D with GL_RGBA plus glGenerateMipmap, every level stored as RGBA8
+static size_t GetRawChainSize(const int& width, const int& height) {
+  size_t size = 0;
+  int mip_width = width;
+  int mip_height = height;
+  while (true) {
+    size += GetMipSize(TextureFormat::kTextureFormatRGBA8, mip_width, mip_height);
+    if (mip_width == 1 && mip_height == 1) {
+      return size;
+    }
+    mip_width = std::max(mip_width / 2, 1);
+    mip_height = std::max(mip_height / 2, 1);
+  }
+}
+
+static void MeasureTexture(const std::string& name, const unsigned char* pixels, const int& width, const int& height, const int& components, const int& bits, TextureTotals& totals) {
+  CookedTexture texture;
+  double best = 0.0;
+  for (int i = 0; i < kRepeats; ++i) {
+    BenchTimer timer;
+    texture = CookTexture(pixels, width, height, components, bits);
+    double time = timer.GetElapsedMs();
+    best = i == 0 ? time : std::min(best, time);
+  }
+
+  const size_t raw_upload = static_cast<size_t>(width) * height * components * bits / 8;
+  const size_t raw_memory = GetRawChainSize(width, height);
+  size_t cooked = 0;
+  for (const std::vector<unsigned char>& mip : texture.mips_) {
+    cooked += mip.size();
+  }
+
+  totals.raw_upload_ += raw_upload;
+  totals.raw_memory_ += raw_memory;
+  totals.cooked_ += cooked;
+  totals.cook_ms_ += best;
+
+  std::printf("%-24s %5dx%-5d %-6s %9.3f %10.1f %10.1f %10.1f\n", name.c_str(), width, height, GetFormatName(texture.format_), best,
+    raw_upload / 1024.0, raw_memory / 1024.0, cooked / 1024.0);
+}
+
+void RunTextureCookBench() {
+  ModelLoadOptions options;
+  options.mesh_optimize_.enabled_ = false;
+  options.lod_.max_lods_ = 1;
+  options.texture_cook_.enabled_ = false;
+  options.use_mesh_cache_ = false;
+
+  std::printf("%-24s %11s %-6s %9s %10s %10s %10s\n", "texture", "size", "format", "cook ms", "raw up KB", "raw mem KB", "cooked KB");
+
+  TextureTotals totals;
+  for (const char* filename : kBenchTextureModels) {
+    Model model;
+    if (!model.LoadModel(filename, options)) {
+      std::printf("Could not load %s\n", filename);
+      continue;
+    }
+
+    //Primitives share images, each one is measured once per model
+    std::set<const unsigned char*> measured;
+    for (const Mesh& mesh : model.GetMeshes()) {
+      for (const PrimitiveData& primitive : mesh.primitives_) {
+        const MaterialData& material = primitive.material_;
+        if (!material.use_texture_ || material.texture_data_.Empty() || !measured.insert(material.texture_data_.data_).second) {
+          continue;
+        }
+
+        std::string name = std::string(filename).substr(std::string(filename).find_last_of('/') + 1) + ":" + material.name_;
+        MeasureTexture(name, material.texture_data_.data_, material.texture_width_, material.texture_height_, material.component_, material.bits_, totals);
+      }
+    }
+  }
+
+  for (const char* filename : kBenchTextureImages) {
+    int width = 0, height = 0, components = 0;
+    unsigned char* pixels = stbi_load(filename, &width, &height, &components, 0);
+    if (!pixels) {
+      std::printf("Could not load %s\n", filename);
+      continue;
+    }
+
+    MeasureTexture(std::string(filename).substr(std::string(filename).find_last_of('/') + 1), pixels, width, height, components, 8, totals);
+    stbi_image_free(pixels);
+  }
+
+  if (totals.cooked_ == 0) {
+    return;
+  }
+
+  std::printf("total cook %.3f ms, upload %.1fx smaller, GPU memory %.1fx smaller\n", totals.cook_ms_,
+    static_cast<double>(totals.raw_upload_) / totals.cooked_, static_cast<double>(totals.raw_memory_) / totals.cooked_);
+}
\ No newline at end of file
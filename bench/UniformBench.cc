@@ -0,0 +1,136 @@
+#include "Bench.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "../src/Graphics/Shader.h"
+
+//CPU cost of the uniforms RenderQueue sets for every draw: the old
+//std::map<std::string, int> lookup, a search by UniformName and a resolved
+//UniformHandle. GL is replaced with functions that do nothing, so only the
+//lookup and the call are measured.
+
+static const unsigned int kDrawCount = 1000000;
+static const int kRepeats = 5;
+
+static const char* const kShaderUniforms[] = { "model", "positionScale", "positionOffset", "texture0", "viewProjection" };
+
+constexpr UniformName kUniformModel("model");
+constexpr UniformName kUniformPositionScale("positionScale");
+constexpr UniformName kUniformPositionOffset("positionOffset");
+
+static int next_location = 0;
+static unsigned int uniform_calls = 0;
+
+static GLint APIENTRY StubGetUniformLocation(GLuint, const GLchar*) {
+  return next_location++;
+}
+
+static void APIENTRY StubUniform3f(GLint, GLfloat, GLfloat, GLfloat) {
+  ++uniform_calls;
+}
+
+static void APIENTRY StubUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {
+  ++uniform_calls;
+}
+
+static void APIENTRY StubDeleteProgram(GLuint) {}
+
+//What Shader did before uniform handles
+class StringUniforms {
+public:
+  void LoadUniform(const std::string& uniform) {
+    uniforms_.emplace(std::make_pair(uniform, glGetUniformLocation(0, uniform.c_str())));
+  }
+
+  void SetUniform_Float3(const std::string& uniform, const float& x, const float& y, const float& z) {
+    glUniform3f(uniforms_[uniform], x, y, z);
+  }
+
+  void SetUniform_Matrix(const std::string& uniform, const glm::mat4& matrix) {
+    glUniformMatrix4fv(uniforms_[uniform], 1, GL_FALSE, glm::value_ptr(matrix));
+  }
+private:
+  std::map<std::string, int> uniforms_;
+};
+
+//Fastest of kRepeats runs in milliseconds
+template<typename Function>
+static double RunBest(Function function) {
+  double best = 0.0;
+  for (int i = 0; i < kRepeats; ++i) {
+    BenchTimer timer;
+    function();
+    double time = timer.GetElapsedMs();
+    best = i == 0 ? time : std::min(best, time);
+  }
+  return best;
+}
+
+static void PrintResult(const char* name, const double& time) {
+  std::printf("%-12s %10.3f %10.2f\n", name, time, time * 1e6 / kDrawCount);
+}
+
+void RunUniformBench() {
+  PFNGLGETUNIFORMLOCATIONPROC get_uniform_location = glad_glGetUniformLocation;
+  PFNGLUNIFORM3FPROC uniform_3f = glad_glUniform3f;
+  PFNGLUNIFORMMATRIX4FVPROC uniform_matrix_4fv = glad_glUniformMatrix4fv;
+  PFNGLDELETEPROGRAMPROC delete_program = glad_glDeleteProgram;
+
+  glad_glGetUniformLocation = StubGetUniformLocation;
+  glad_glUniform3f = StubUniform3f;
+  glad_glUniformMatrix4fv = StubUniformMatrix4fv;
+  glad_glDeleteProgram = StubDeleteProgram;
+  {
+    StringUniforms string_uniforms;
+    Shader shader;
+    for (const char* uniform : kShaderUniforms) {
+      string_uniforms.LoadUniform(uniform);
+      shader.LoadUniform(uniform);
+    }
+
+    glm::mat4 model(1.f);
+    glm::vec3 scale(1.f);
+    glm::vec3 offset(0.f);
+
+    std::printf("%u draws, 1 matrix and 2 vec3 each\n", kDrawCount);
+    std::printf("%-12s %10s %10s\n", "case", "ms", "ns/draw");
+
+    PrintResult("string map", RunBest([&]() {
+      for (unsigned int i = 0; i < kDrawCount; ++i) {
+        string_uniforms.SetUniform_Float3("positionScale", scale.x, scale.y, scale.z);
+        string_uniforms.SetUniform_Float3("positionOffset", offset.x, offset.y, offset.z);
+        string_uniforms.SetUniform_Matrix("model", model);
+      }
+    }));
+
+    PrintResult("name hash", RunBest([&]() {
+      for (unsigned int i = 0; i < kDrawCount; ++i) {
+        shader.SetUniform_Float3(kUniformPositionScale, scale.x, scale.y, scale.z);
+        shader.SetUniform_Float3(kUniformPositionOffset, offset.x, offset.y, offset.z);
+        shader.SetUniform_Matrix(kUniformModel, model);
+      }
+    }));
+
+    UniformHandle model_uniform = shader.GetUniform(kUniformModel);
+    UniformHandle position_scale_uniform = shader.GetUniform(kUniformPositionScale);
+    UniformHandle position_offset_uniform = shader.GetUniform(kUniformPositionOffset);
+    PrintResult("handle", RunBest([&]() {
+      for (unsigned int i = 0; i < kDrawCount; ++i) {
+        shader.SetUniform_Float3(position_scale_uniform, scale.x, scale.y, scale.z);
+        shader.SetUniform_Float3(position_offset_uniform, offset.x, offset.y, offset.z);
+        shader.SetUniform_Matrix(model_uniform, model);
+      }
+    }));
+  }
+  glad_glGetUniformLocation = get_uniform_location;
+  glad_glUniform3f = uniform_3f;
+  glad_glUniformMatrix4fv = uniform_matrix_4fv;
+  glad_glDeleteProgram = delete_program;
+}
\ No newline at end of file
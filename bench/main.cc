@@ -0,0 +1,69 @@
+#include <plog/Log.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "Bench.h"
+
+//Headless benchmarks, run all of them or only the ones named on the command line
+//e.g. Project-Rune-Bench jobs physics
+
+struct BenchEntry {
+  const char* name_;
+  void (*run_)(void);
+};
+
+static const BenchEntry kBenchmarks[] = {
+  { "jobs", RunJobSystemBench },
+  { "physics", RunPhysicsBench },
+  { "queries", RunQueryBench },
+  { "bvh", RunBvhBench },
+  { "uniforms", RunUniformBench },
+  { "models", RunModelLoadBench },
+  { "textures", RunTextureCookBench },
+};
+
+std::vector<unsigned int> GetBenchThreadCounts() {
+  unsigned int hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < hardware_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(hardware_threads);
+  return thread_counts;
+}
+
+static bool IsSelected(const char* name, int argc, char** argv) {
+  if (argc < 2) {
+    return true;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  static plog::ConsoleAppender<plog::TxtFormatter> console_appender;
+  plog::init(plog::warning, &console_appender);
+
+  for (const BenchEntry& bench : kBenchmarks) {
+    if (!IsSelected(bench.name_, argc, argv)) {
+      continue;
+    }
+
+    std::printf("== %s\n", bench.name_);
+    bench.run_();
+    std::printf("\n");
+  }
+
+  return 0;
+}
\ No newline at end of file
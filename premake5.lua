@@ -1,3 +1,10 @@
+--Bullet built with BT_THREADSAFE=1 is only needed for the parallel physics
+--backend, everyone else can keep the default libraries
+newoption {
+  trigger = "bullet-threadsafe",
+  description = "Link against Bullet built with BT_THREADSAFE=1 and enable parallel physics",
+}
+
 workspace "Project Rune"
   configurations { "Debug", "Release" }
   location "bin"
@@ -42,9 +49,59 @@ project "Project-Rune"
     "src/**.cc" 
   }
 
-  defines { 
+  --Must match how the Bullet libraries in libs were built
+  filter "options:bullet-threadsafe"
+  defines { "BT_THREADSAFE=1" }
+  filter {}
+
+  filter "configurations:Debug"
+  defines { "DEBUG" }
+  optimize "Debug"
+  symbols "On"
+
+  filter "configurations:Release"
+  defines { "RELEASE" }
+  optimize "Speed"
+  filter {}
+
+--Headless benchmarks, run with the names of the ones you want or nothing for all
+project "Project-Rune-Bench"
+  kind "ConsoleApp"
+  language "C++"
+  cppdialect "C++17"
+  targetdir "bin/%{cfg.buildcfg}"
+  toolset "gcc"
+
+  --Same sources and libraries as the engine so benchmarks can use any system,
+  --nothing runs that needs a window
+  libdirs "libs"
+  links { 
+    "glfw3",
+    "gdi32",
+    "BulletDynamics",
+    "BulletCollision",
+    "LinearMath",
+    "Bullet3Common",
   }
 
+  files { 
+    "vendor/tinygltf/tiny_gltf.cc",
+    "vendor/imgui/*.cpp",
+    "vendor/imgui/backends/imgui_impl_opengl3.cpp",
+    "vendor/imgui/backends/imgui_impl_glfw.cpp",
+    "vendor/imgui/misc/cpp/*.cpp",
+    "vendor/glad/src/*.cc",
+    "vendor/stb/*.cc",
+    "src/**.cc",
+    "bench/**.cc" 
+  }
+  removefiles { "src/main.cc" }
+
+  --Must match how the Bullet libraries in libs were built
+  filter "options:bullet-threadsafe"
+  defines { "BT_THREADSAFE=1" }
+  filter {}
+
   filter "configurations:Debug"
   defines { "DEBUG" }
   optimize "Debug"
@@ -53,3 +110,31 @@ project "Project-Rune"
   filter "configurations:Release"
   defines { "RELEASE" }
   optimize "Speed"
+  filter {}
+
+--Headless unit tests, GL entry points are replaced by the tests that need them
+project "Project-Rune-Tests"
+  kind "ConsoleApp"
+  language "C++"
+  cppdialect "C++17"
+  targetdir "bin/%{cfg.buildcfg}"
+  toolset "gcc"
+
+  files { 
+    "vendor/glad/src/*.cc",
+    "vendor/stb/*.cc",
+    "src/Graphics/MeshOptimizer.cc",
+    "src/Graphics/MeshSimplifier.cc",
+    "src/Graphics/RenderState.cc",
+    "src/Graphics/TextureCooker.cc",
+    "tests/**.cc" 
+  }
+
+  filter "configurations:Debug"
+  defines { "DEBUG" }
+  optimize "Debug"
+  symbols "On"
+
+  filter "configurations:Release"
+  defines { "RELEASE" }
+  optimize "Speed"
\ No newline at end of file
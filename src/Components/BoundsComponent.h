@@ -0,0 +1,28 @@
+#ifndef BOUNDS_COMPONENT_H_
+#define BOUNDS_COMPONENT_H_
+
+#include "../Graphics/Bvh.h"
+#include "../Graphics/FrustumCulling.h"
+#include "TransformComponent.h"
+
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+
+//World space state for every mesh of a model, in the order of the asset's
+//mesh handles. Only rebuilt when the entity's transform changes.
+struct BoundsComponent {
+  //Transform the cache was built from
+  TransformComponent transform_;
+  bool valid_ = false;
+
+  std::vector<glm::mat4> model_matrices_;
+  BoundingBoxes world_boxes_;
+  //Over world_boxes_, only built for models with many meshes. Query results
+  //index mesh_handles_ like everything else here.
+  Bvh bvh_;
+  //Result of the last culling pass
+  std::vector<unsigned char> visible_;
+};
+
+#endif
\ No newline at end of file
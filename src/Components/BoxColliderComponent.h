@@ -11,8 +11,7 @@
 struct BoxColliderComponent {
   BoxColliderComponent() = default;
   BoxColliderComponent(PhysicsWorld& world, const glm::vec3& scale) : scale_(scale) {
-    box_shape_ = std::make_shared<btBoxShape>(GLM_To_BT_Vec3(scale_));
-    world.AddCollisionShape(box_shape_);
+    box_shape_ = world.AcquireBoxShape(scale_);
   }
 
   glm::vec3 scale_;
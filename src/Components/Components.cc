@@ -2,10 +2,13 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <chrono>
+
 #include <glad/glad.h>
 #include <plog/Log.h>
 
 #include "BoxColliderComponent.h"
+#include "SphereColliderComponent.h"
 #include "RigidBodyComponent.h"
 #include "CameraComponent.h"
 #include "MeshComponent.h"
@@ -14,16 +17,112 @@
 #include "ShaderComponent.h"
 #include "TransformComponent.h"
 #include "InputComponent.h"
+#include "BoundsComponent.h"
 
 #include "../Physics/PhysicsMath.h"
 
+#include "../Graphics/RenderQueue.h"
+#include "../Graphics/FrustumCulling.h"
+
 #include "../Core/Time.h"
 #include "../Core/Input.h"
+#include "../Core/JobSystem.h"
 
 struct {
   glm::mat4 current_view_projection_ = glm::mat4(1.0);
+  glm::vec3 current_camera_position_ = glm::vec3(0.0);
+  float current_camera_far_ = 1.f;
+  //Pixels covered by one world unit at distance one
+  float current_lod_projection_ = 0.f;
+
+  MeshCullingStats culling_stats_;
 } Global;
 
+//Largest screen space error a level of detail may have, in pixels
+constexpr float kLodPixelError = 1.f;
+
+//Below this a flat pass over the boxes beats walking a tree
+constexpr size_t kMinBvhMeshes = 32;
+
+static size_t GetIndexSize(const int& index_type) {
+  switch (index_type) {
+    case GL_UNSIGNED_BYTE:
+      return 1;
+    case GL_UNSIGNED_SHORT:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+//Coarsest level whose error projects to less than kLodPixelError
+static const MeshLod& SelectMeshLod(const MeshComponent& mesh, const glm::mat4& transform) {
+  if (mesh.lods_.size() == 1 || Global.current_lod_projection_ <= 0.f) {
+    return mesh.lods_.front();
+  }
+
+  glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.bounds_center_, 1.f));
+  float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+  float distance = glm::length(center - Global.current_camera_position_) - mesh.bounds_radius_ * scale;
+  if (distance <= 0.f) {
+    return mesh.lods_.front();
+  }
+
+  const float pixels_per_unit = Global.current_lod_projection_ / distance;
+  for (size_t i = mesh.lods_.size() - 1; i > 0; --i) {
+    if (mesh.lods_[i].error_ * scale * pixels_per_unit <= kLodPixelError) {
+      return mesh.lods_[i];
+    }
+  }
+  return mesh.lods_.front();
+}
+
+static glm::mat4 TransformToMatrix(const TransformComponent& transform) {
+  glm::mat4 matrix(1.0);
+  matrix = glm::translate(matrix, transform.position_);
+  matrix = matrix * glm::mat4(transform.rotation_);
+  matrix = glm::scale(matrix, transform.scale_);
+  return matrix;
+}
+
+static bool IsSameTransform(const TransformComponent& a, const TransformComponent& b) {
+  return a.position_ == b.position_ && a.rotation_ == b.rotation_ && a.scale_ == b.scale_;
+}
+
+//Rebuilds the model matrix and world box of every mesh in the model
+static void UpdateBounds(BoundsComponent& bounds, const TransformComponent& transform, const ModelAsset& asset, ResourceManager& resource) {
+  const glm::mat4 global_transform_matrix = TransformToMatrix(transform);
+  const size_t mesh_count = asset.mesh_handles_.size();
+
+  bounds.model_matrices_.resize(mesh_count);
+  bounds.world_boxes_.Resize(mesh_count);
+
+  for (size_t i = 0; i < mesh_count; ++i) {
+    const entt::entity& mesh_handle = asset.mesh_handles_[i];
+    const MeshComponent& mesh_component = resource.GetMeshFromHandle(mesh_handle);
+    TransformComponent local_transform = resource.GetLocalTransformFromMeshHandle(mesh_handle);
+
+    bounds.model_matrices_[i] = global_transform_matrix * TransformToMatrix(local_transform);
+
+    glm::vec3 center, extents;
+    TransformBounds(bounds.model_matrices_[i], mesh_component.bounds_center_, mesh_component.bounds_extents_, center, extents);
+    bounds.world_boxes_.Set(i, center, extents);
+  }
+
+  //Moving the whole model keeps the tree's shape, only new meshes need a rebuild
+  if (mesh_count < kMinBvhMeshes) {
+    bounds.bvh_.Clear();
+  } else if (bounds.bvh_.GetPrimitiveCount() == mesh_count) {
+    bounds.bvh_.Refit(bounds.world_boxes_);
+  } else {
+    bounds.bvh_.Build(bounds.world_boxes_);
+  }
+
+  bounds.transform_ = transform;
+  bounds.valid_ = true;
+}
+
 void UpdateCameraComponents(entt::registry& registry, const glm::vec2& aspect_ratio) {
   auto view = registry.view<CameraComponent>();
 
@@ -35,6 +134,9 @@ void UpdateCameraComponents(entt::registry& registry, const glm::vec2& aspect_ra
     camera.projection_ = glm::perspectiveFov(glm::radians(camera.fov_), camera.aspect_ratio_.x, camera.aspect_ratio_.y, camera.near_, camera.far_);   
 
     Global.current_view_projection_ = camera.projection_ * camera.view_;
+    Global.current_camera_position_ = camera.position_;
+    Global.current_camera_far_ = camera.far_;
+    Global.current_lod_projection_ = camera.aspect_ratio_.y / (2.f * glm::tan(glm::radians(camera.fov_) * 0.5f));
   }
 
   auto fly_camera_view = registry.view<CameraComponent, FlyCameraComponent, InputComponent>();
@@ -80,65 +182,130 @@ void UpdateCameraComponents(entt::registry& registry, const glm::vec2& aspect_ra
 }
 
 void UpdateMeshComponents(entt::registry& registry, ResourceManager& resource) {
+  MeshCullingStats stats;
+  auto cull_start = std::chrono::steady_clock::now();
+
+  const Frustum frustum = ExtractFrustum(Global.current_view_projection_);
   auto model_view = registry.view<ModelComponent, ShaderComponent>();
 
   for (auto [entity, model, shader] : model_view.each()) {
-    for (const entt::entity& mesh_handle : model.model_resource.mesh_handles_) {
-      MeshComponent mesh_component = resource.GetMeshFromHandle(mesh_handle);
-      MaterialComponent material_component = resource.GetMaterialFromHandle(mesh_handle);
-      TextureComponent* texture_component = resource.GetTextureFromMaterialHandle(material_component.texture_handle_);
+    //Still loading (or failed), nothing to draw yet
+    const ModelAsset& asset = *model.model_resource.asset_;
+    if (asset.state_.load(std::memory_order_acquire) != AssetState::kAssetReady) {
+      continue;
+    }
 
-      TransformComponent local_transform = resource.GetLocalTransformFromMeshHandle(mesh_handle);
+    TransformComponent transform;
+    TransformComponent* global_transform = registry.try_get<TransformComponent>(entity);
+    if (global_transform != nullptr) {
+      transform = *global_transform;
+    }
 
-      glm::mat4 local_transform_matrix(1.0);
-      local_transform_matrix = glm::translate(local_transform_matrix, local_transform.position_);
-      local_transform_matrix = local_transform_matrix * glm::mat4(local_transform.rotation_);
-      local_transform_matrix = glm::scale(local_transform_matrix, local_transform.scale_);
+    BoundsComponent& bounds = registry.get_or_emplace<BoundsComponent>(entity);
+    if (!bounds.valid_ || bounds.model_matrices_.size() != asset.mesh_handles_.size() || !IsSameTransform(bounds.transform_, transform)) {
+      UpdateBounds(bounds, transform, asset, resource);
+    }
 
-      glm::mat4 global_transform_matrix(1.0);
+    if (bounds.bvh_.IsEmpty()) {
+      CullBoxes(frustum, bounds.world_boxes_, bounds.visible_);
+    } else {
+      bounds.bvh_.CullFrustum(frustum, bounds.visible_);
+    }
+  }
+
+  stats.cull_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cull_start).count();
 
-      TransformComponent* global_transform = registry.try_get<TransformComponent>(entity);
-      if (global_transform != nullptr)  {
-        global_transform_matrix = glm::translate(global_transform_matrix, global_transform->position_);
-        global_transform_matrix = global_transform_matrix * glm::mat4(global_transform->rotation_);
-        global_transform_matrix = glm::scale(global_transform_matrix, global_transform->scale_); 
+  auto bounds_view = registry.view<ModelComponent, ShaderComponent, BoundsComponent>();
+
+  for (auto [entity, model, shader, bounds] : bounds_view.each()) {
+    const ModelAsset& asset = *model.model_resource.asset_;
+    if (asset.state_.load(std::memory_order_acquire) != AssetState::kAssetReady) {
+      continue;
+    }
+
+    for (size_t i = 0; i < asset.mesh_handles_.size(); ++i) {
+      if (!bounds.visible_[i]) {
+        ++stats.culled_;
+        continue;
       }
+      ++stats.visible_;
 
-      mesh_component.vertex_array_->Bind();
-      shader.shader_->Bind();
+      const entt::entity& mesh_handle = asset.mesh_handles_[i];
+      const MeshComponent& mesh_component = resource.GetMeshFromHandle(mesh_handle);
+      const MaterialComponent& material_component = resource.GetMaterialFromHandle(mesh_handle);
+      TextureComponent* texture_component = resource.GetTextureFromMaterialHandle(material_component.texture_handle_);
 
-      shader.shader_->SetUniform_Matrix("model", global_transform_matrix * local_transform_matrix);
-      shader.shader_->SetUniform_Matrix("viewProjection", Global.current_view_projection_);
+      const glm::mat4& model_matrix = bounds.model_matrices_[i];
+      const MeshLod& lod = SelectMeshLod(mesh_component, model_matrix);
 
-      shader.shader_->SetUniform_Float3("fragBaseColor", material_component.base_color_.x, material_component.base_color_.y, material_component.base_color_.z);
+      float depth = glm::length(bounds.world_boxes_.GetCenter(i) - Global.current_camera_position_) / Global.current_camera_far_;
 
-      if (texture_component != nullptr) {
-        texture_component->texture_->BindSlot(0); 
-      }
-        
-      glDrawElements(mesh_component.draw_mode_, mesh_component.num_indices_, mesh_component.index_type_, nullptr);
+      DrawPacket packet;
+      packet.shader_ = shader.shader_.get();
+      packet.texture_ = texture_component != nullptr ? texture_component->texture_.get() : nullptr;
+      packet.vertex_array_ = mesh_component.vertex_array_.get();
+      packet.material_uniforms_ = material_component.uniform_buffer_.get();
+      packet.instanced_shader_ = shader.instanced_shader_.get();
 
-      if (texture_component != nullptr) {
-        texture_component->texture_->Unbind();
+      packet.draw_mode_ = mesh_component.draw_mode_;
+      packet.index_type_ = mesh_component.index_type_;
+      packet.index_count_ = lod.index_count_;
+      packet.index_offset_ = lod.index_offset_ * GetIndexSize(mesh_component.index_type_);
+
+      if (packet.instanced_shader_ != nullptr) {
+        packet.sort_key_ = RenderQueue::MakeInstancedSortKey(packet.shader_, packet.texture_, packet.vertex_array_, lod.index_offset_);
+      } else {
+        packet.sort_key_ = RenderQueue::MakeSortKey(packet.shader_, packet.texture_, packet.vertex_array_, depth);
       }
 
-      shader.shader_->Unbind();
-      mesh_component.vertex_array_->Unbind();
+      packet.model_ = model_matrix;
+      packet.position_scale_ = mesh_component.position_scale_;
+      packet.position_offset_ = mesh_component.position_offset_;
+
+      RenderQueue::Submit(packet);
     }
   }
 
+  Global.culling_stats_ = stats;
+}
+
+MeshCullingStats GetMeshCullingStats() {
+  return Global.culling_stats_;
+}
+
+static void SyncBodyTransform(entt::registry& registry, const PhysicsMotionState& motion_state, const btTransform& body_transform) {
+  entt::entity entity = static_cast<entt::entity>(motion_state.GetUserIndex());
+  TransformComponent* transform = registry.valid(entity) ? registry.try_get<TransformComponent>(entity) : nullptr;
+  if (transform) {
+    *transform = BT_Transform_To_Component(body_transform, transform->scale_);
+  }
 }
 
-void UpdatePhysicsSystem(entt::registry& registry) {
-  auto physics = registry.view<const RigidBodyComponent, TransformComponent>();
+//Only touches bodies Bullet moved, resting and static bodies cost nothing.
+//Moving bodies are drawn between the last two fixed steps.
+void UpdatePhysicsSystem(entt::registry& registry, PhysicsWorld& world) {
+  for (const PhysicsMotionState* motion_state : world.GetSettledBodies()) {
+    SyncBodyTransform(registry, *motion_state, motion_state->GetTransform());
+  }
+  world.ClearSettledBodies();
+
+  const float alpha = static_cast<float>(Time::GetInterpolationAlpha());
+  const std::vector<PhysicsMotionState*>& moved = world.GetMovedBodies();
 
-  for (auto [entity, body, transform] : physics.each()) {
-    glm::vec3 scale = transform.scale_;
-    btTransform new_transform;
-    body.motion_state_->getWorldTransform(new_transform);
+  //Each body only writes its own transform so the list can be split freely
+  JobSystem::ParallelFor(moved.size(), 256, [&registry, &moved, alpha](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      SyncBodyTransform(registry, *moved[i], moved[i]->GetInterpolatedTransform(alpha));
+    }
+  });
+}
 
-    transform = BT_Transform_To_Component(new_transform, scale);
+void DestroyPhysicsComponents(entt::registry& registry, PhysicsWorld& world, const entt::entity& entity) {
+  if (RigidBodyComponent* body = registry.try_get<RigidBodyComponent>(entity)) {
+    world.RemoveRigidBody(body->rigid_body_);
   }
+
+  registry.remove<RigidBodyComponent, BoxColliderComponent, SphereColliderComponent>(entity);
 }
 
 void ReleaseMeshResources(entt::registry& registry) {
@@ -149,8 +316,14 @@ void ReleaseMeshResources(entt::registry& registry) {
     mesh.index_buffer_.reset();
   }
 
+  auto materials = registry.view<MaterialComponent>();
+  for (auto [entity, material] : materials.each()) {
+    material.uniform_buffer_.reset();
+  }
+
   auto shaders = registry.view<ShaderComponent>();
   for (auto [entity, shader] : shaders.each()) {
     shader.shader_.reset();
+    shader.instanced_shader_.reset();
   }
 }
@@ -5,11 +5,27 @@
 #include <glm/vec2.hpp>
 
 #include "../Core/ResourceManager.h"
+#include "../Physics/PhysicsWorld.h"
 
 void UpdateCameraComponents(entt::registry& registry, const glm::vec2& aspect_ratio);
-void UpdatePhysicsSystem(entt::registry& registry);
+void UpdatePhysicsSystem(entt::registry& registry, PhysicsWorld& world);
+//Takes the entity's body out of the world and drops its physics components,
+//shared shapes are freed once nothing else uses them
+void DestroyPhysicsComponents(entt::registry& registry, PhysicsWorld& world, const entt::entity& entity);
+//Submits every loaded mesh inside the camera frustum to the RenderQueue,
+//nothing is drawn until it's flushed
 void UpdateMeshComponents(entt::registry& registry, ResourceManager& resource);
 
+struct MeshCullingStats {
+  unsigned int visible_ = 0;
+  unsigned int culled_ = 0;
+  //Bounds updates and frustum tests, in milliseconds
+  double cull_time_ = 0.0;
+};
+
+//Numbers from the last UpdateMeshComponents
+MeshCullingStats GetMeshCullingStats();
+
 void ReleaseMeshResources(entt::registry& registry);
 
 #endif
\ No newline at end of file
@@ -4,9 +4,17 @@
 #include <entt/entt.hpp>
 #include <glm/vec3.hpp>
 
+#include <memory>
+
+#include "../Graphics/Buffer.h"
+
 struct MaterialComponent {
+  //Texture array shared by every material packed into it, texture_layer_ picks ours
   entt::entity texture_handle_;
+  int texture_layer_ = 0;
   glm::vec3 base_color_;
+  //MaterialUniforms, shared by every mesh using this material
+  std::shared_ptr<Buffer> uniform_buffer_;
 };
 
 
@@ -3,9 +3,11 @@
 
 #include "../Graphics/VertexArray.h"
 #include "../Graphics/Buffer.h"
+#include "../Graphics/MeshSimplifier.h"
 #include "TransformComponent.h"
 
 #include <memory>
+#include <vector>
 
 constexpr int kComponentType_UnsignedShort = 5123;
 constexpr int kDrawMode_Triangle = 4;
@@ -18,6 +20,17 @@ struct MeshComponent {
   int num_vertices_;
   int num_indices_;
 
+  //Quantized positions are rebuilt in the shader as position * scale + offset
+  glm::vec3 position_scale_ = glm::vec3(1.f);
+  glm::vec3 position_offset_ = glm::vec3(0.f);
+
+  //Ranges into index_buffer_, always at least one
+  std::vector<MeshLod> lods_;
+  //Local space, the box and sphere share the center
+  glm::vec3 bounds_center_ = glm::vec3(0.f);
+  glm::vec3 bounds_extents_ = glm::vec3(0.f);
+  float bounds_radius_ = 0.f;
+
   int index_type_ = kComponentType_UnsignedShort;  
   int draw_mode_ = kDrawMode_Triangle;
 };
@@ -2,30 +2,34 @@
 #define RIGID_BODY_COMPONENT_H_
 
 #include <bullet/BulletDynamics/Dynamics/btRigidBody.h>
-#include <bullet/LinearMath/btDefaultMotionState.h>
+#include <entt/entt.hpp>
 #include <memory>
 
 #include "../Physics/PhysicsMath.h"
+#include "../Physics/PhysicsMotionState.h"
 #include "../Physics/PhysicsWorld.h"
 
 struct RigidBodyComponent {
   RigidBodyComponent() = default;
-  RigidBodyComponent(PhysicsWorld& world, btCollisionShape* shape, const TransformComponent& transform, const float& mass) : mass_(mass) {
-    motion_state_ = std::make_shared<btDefaultMotionState>(TransformComponent_To_BT(transform));
+  //entity is the one the component goes on, physics writes its TransformComponent
+  RigidBodyComponent(PhysicsWorld& world, const entt::entity& entity, const std::shared_ptr<btCollisionShape>& shape, const TransformComponent& transform, const float& mass) : mass_(mass) {
+    motion_state_ = std::make_shared<PhysicsMotionState>(world, TransformComponent_To_BT(transform), static_cast<unsigned int>(entity));
     btVector3 inertia(0.f, 0.f, 0.f);
     if (mass > 0.f) {
       shape->calculateLocalInertia(mass_, inertia);
     }
-    btRigidBody::btRigidBodyConstructionInfo construction_info(mass_, motion_state_.get(), shape, inertia);
+    btRigidBody::btRigidBodyConstructionInfo construction_info(mass_, motion_state_.get(), shape.get(), inertia);
     rigid_body_ = std::make_shared<btRigidBody>(construction_info);
+    //Lets query results find their way back to the entity
+    rigid_body_->setUserIndex(static_cast<int>(entity));
 
     world.AddMotionState(motion_state_);
-    world.AddRigidBody(rigid_body_);
+    world.AddRigidBody(rigid_body_, shape);
   }
 
   float mass_;
   std::shared_ptr<btRigidBody> rigid_body_;
-  std::shared_ptr<btDefaultMotionState> motion_state_;
+  std::shared_ptr<PhysicsMotionState> motion_state_;
 };
 
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 struct ShaderComponent {
   std::shared_ptr<Shader> shader_;
+  //Same source compiled with INSTANCED defined, null when not requested
+  std::shared_ptr<Shader> instanced_shader_;
 };
 
 #endif
\ No newline at end of file
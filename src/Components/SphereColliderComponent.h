@@ -11,8 +11,7 @@
 struct SphereColliderComponent {
   SphereColliderComponent() = default;
   SphereColliderComponent(PhysicsWorld& world, const float& radius) : radius_(radius) {
-    sphere_shape_ = std::make_shared<btSphereShape>(radius_);
-    world.AddCollisionShape(sphere_shape_);
+    sphere_shape_ = world.AcquireSphereShape(radius_);
   }
 
   float radius_;
@@ -9,19 +9,57 @@
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 
 #include "Input.h"
 #include "Time.h"
+#include "JobSystem.h"
+
+#include "../Graphics/RenderState.h"
 
 double Application::last_time_ = 0.0;
 double Application::current_time_ = 0.0;
-double Application::update_time_ = 0.0;
-double Application::draw_time_ = 0.0;
+double Application::accumulator_ = 0.0;
+double Application::fixed_time_step_ = 1.0 / 60.0;
 
-double Application::target_fps_ = 120.0;
+double Application::target_frame_time_ = 1.0 / 120.0;
 
 static bool first_mouse_move = false;
 
+//Clamp long frames (breakpoints, window drags) so the fixed update can't spiral
+constexpr double kMaxFrameTime = 0.25;
+constexpr int kMaxFixedStepsPerFrame = 8;
+
+//Sleeps for roughly the requested time and spins only for the tail end.
+//The OS sleep overshoot is tracked as a running mean + deviation so the spin
+//window adapts to the scheduler granularity of the machine we're on.
+static void PreciseSleep(double seconds) {
+  static double estimate = 5e-3;
+  static double mean = 5e-3;
+  static double m2 = 0.0;
+  static long long count = 1;
+
+  while (seconds > estimate) {
+    double start = glfwGetTime();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double observed = glfwGetTime() - start;
+    seconds -= observed;
+
+    ++count;
+    double delta = observed - mean;
+    mean += delta / static_cast<double>(count);
+    m2 += delta * (observed - mean);
+    double stddev = std::sqrt(m2 / static_cast<double>(count - 1));
+    estimate = mean + stddev;
+  }
+
+  double destination_time = glfwGetTime() + seconds;
+  while (glfwGetTime() < destination_time) {
+    std::this_thread::yield();
+  }
+}
+
 Application::Application(const int& width, const int& height, const char* window_title) {
 
   //Clear contents of file
@@ -99,30 +137,47 @@ Application::Application(const int& width, const int& height, const char* window
   }
   
   glViewport(0, 0, width, height);
+  window_width_ = width;
+  window_height_ = height;
 
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_CULL_FACE);
+  RenderState::Initialize();
+  RenderState::SetCapability(RenderCapability::kCapabilityDepthTest, true);
+  RenderState::SetCapability(RenderCapability::kCapabilityCullFace, true);
 
   current_time_ = glfwGetTime();
 
+  //Main thread takes part in running systems, so leave it a core
+  unsigned int hardware_threads = std::thread::hardware_concurrency();
+  JobSystem::Initialize(hardware_threads > 1 ? hardware_threads - 1 : 0);
+
   PLOG_DEBUG << "Initialized successfully";
 }
 
 Application::~Application() {
+  JobSystem::Shutdown();
+
   PLOG_DEBUG << "Terminated application";
   glfwDestroyWindow(window_);
   glfwTerminate();
 }
 
 Application& Application::AddSystem(const SystemType& type, const std::function<void(void)>& system) {
+  return AddSystem(type, SystemAccess().Exclusive(), system);
+}
+
+Application& Application::AddSystem(const SystemType& type, const SystemAccess& access, const std::function<void(void)>& system) {
   switch (type) {
     case SystemType::kSystemStart:
       PLOG_DEBUG << "Start System added";
       start_functions_.push_back(system);
       break;
+    case SystemType::kSystemFixedUpdate:
+      PLOG_DEBUG << "Fixed Update System added";
+      fixed_update_scheduler_.AddSystem(access, system);
+      break;
     case SystemType::kSystemUpdate:
       PLOG_DEBUG << "Update System added";
-      update_functions_.push_back(system);
+      update_scheduler_.AddSystem(access, system);
       break;
     case SystemType::kSystemEnd:
       PLOG_DEBUG << "End System added";
@@ -137,6 +192,9 @@ void Application::Run() {
   std::for_each(start_functions_.cbegin(), start_functions_.cend(), [](const auto& fn) { fn(); });
   PLOG_DEBUG << "Start functions finished";
 
+  Time::SetFixedDeltaTime(fixed_time_step_);
+  last_time_ = glfwGetTime();
+
   while (!glfwWindowShouldClose(window_)) {
     switch (Input::GetCursorState()) {
       case Input::CursorState::kCursorStateNormal:
@@ -150,32 +208,23 @@ void Application::Run() {
         break;
     }
 
+    glfwGetWindowSize(window_, &window_width_, &window_height_);
+
     current_time_ = glfwGetTime();
-    update_time_ = current_time_ - last_time_;
+    double frame_start = current_time_;
+    double frame_time = std::min(current_time_ - last_time_, kMaxFrameTime);
     last_time_ = current_time_;
- 
-    
-    std::for_each(update_functions_.cbegin(), update_functions_.cend(), [](const auto& fn) { fn(); });
 
-    glfwSwapBuffers(window_);
+    Time::SetDeltaTime(frame_time);
+    RenderState::BeginFrame();
 
-    current_time_ = glfwGetTime();
-    draw_time_ = current_time_ - last_time_;
-    last_time_ = current_time_;
+    RunFixedUpdates(frame_time);
 
-    double delta_time = update_time_ + draw_time_;
-    Time::SetDeltaTime(delta_time);
+    update_scheduler_.Run();
 
-    if (Time::GetDeltaTime() < target_fps_) {
-      double destination_time = glfwGetTime() + (target_fps_ - Time::GetDeltaTime());
-      while (glfwGetTime() < destination_time) {}
-      current_time_ = glfwGetTime();
-      double wait_time = current_time_ - last_time_;
-      last_time_ = current_time_;
+    glfwSwapBuffers(window_);
 
-      delta_time += wait_time;
-      Time::SetDeltaTime(delta_time);
-    }
+    WaitForFrameEnd(frame_start);
 
     glfwPollEvents();
   }
@@ -185,29 +234,62 @@ void Application::Run() {
   PLOG_DEBUG << "End functions finished";
 }
 
+void Application::RunFixedUpdates(const double& frame_time) {
+  accumulator_ += frame_time;
+
+  int steps = 0;
+  while (accumulator_ >= fixed_time_step_ && steps < kMaxFixedStepsPerFrame) {
+    fixed_update_scheduler_.Run();
+    accumulator_ -= fixed_time_step_;
+    ++steps;
+  }
+
+  //Dropped steps are lost time, keep only the fractional remainder
+  if (steps == kMaxFixedStepsPerFrame && accumulator_ >= fixed_time_step_) {
+    PLOG_WARNING << "Fixed update fell behind, dropping " << static_cast<int>(accumulator_ / fixed_time_step_) << " steps";
+    accumulator_ = std::fmod(accumulator_, fixed_time_step_);
+  }
+
+  Time::SetInterpolationAlpha(accumulator_ / fixed_time_step_);
+}
+
+void Application::WaitForFrameEnd(const double& frame_start) {
+  if (target_frame_time_ <= 0.0) {
+    return;
+  }
+
+  double remaining = (frame_start + target_frame_time_) - glfwGetTime();
+  if (remaining > 0.0) {
+    PreciseSleep(remaining);
+  }
+}
+
 void Application::Quit() {
   glfwSetWindowShouldClose(window_, GLFW_TRUE);
 }
 
 
+//Cached once per frame since GLFW only allows window queries from the main thread
 int Application::GetWindowWidth() {
-  int width = 0;
-  glfwGetWindowSize(window_, &width, nullptr);
-  return width;
+  return window_width_;
 }
 
 int Application::GetWindowHeight() {
-  int height = 0;
-  glfwGetWindowSize(window_, nullptr, &height);
-  return height;
+  return window_height_;
 }
 
 void Application::SetTargetFPS(int target_fps) {
   if (target_fps == 0) {
-    target_fps_ = 0.0;
+    target_frame_time_ = 0.0;
     return;
   }
-  target_fps_ = 1.0 / static_cast<double>(target_fps);
+  target_frame_time_ = 1.0 / static_cast<double>(target_fps);
+}
+
+void Application::SetFixedUpdateRate(int updates_per_second) {
+  assert(updates_per_second > 0 && "Fixed update rate must be positive");
+  fixed_time_step_ = 1.0 / static_cast<double>(updates_per_second);
+  Time::SetFixedDeltaTime(fixed_time_step_);
 }
 
 
@@ -5,6 +5,8 @@
 #include <functional>
 #include <vector>
 
+#include "SystemScheduler.h"
+
 class Application {
 public: 
   Application() = default;
@@ -13,11 +15,14 @@ public:
 
   enum class SystemType {
     kSystemStart,
+    kSystemFixedUpdate,
     kSystemUpdate,
     kSystemEnd,
   };
 
+  //Systems added without an access description run exclusively on the main thread
   Application& AddSystem(const SystemType& type, const std::function<void(void)>& system);
+  Application& AddSystem(const SystemType& type, const SystemAccess& access, const std::function<void(void)>& system);
   void Run();
   void Quit();
 public:
@@ -25,20 +30,27 @@ public:
   int GetWindowHeight();
   
   static void SetTargetFPS(int target_fps);
+  static void SetFixedUpdateRate(int updates_per_second);
+private:
+  void RunFixedUpdates(const double& frame_time);
+  void WaitForFrameEnd(const double& frame_start);
 private:
   struct GLFWwindow* window_; 
+  int window_width_ = 0;
+  int window_height_ = 0;
 
   std::vector<std::function<void(void)>> start_functions_;
-  std::vector<std::function<void(void)>> update_functions_;
+  SystemScheduler fixed_update_scheduler_;
+  SystemScheduler update_scheduler_;
   std::vector<std::function<void(void)>> end_functions_;
 private:
   static double current_time_;
   static double last_time_;
 
-  static double update_time_;
-  static double draw_time_;
+  static double accumulator_;
+  static double fixed_time_step_;
 
-  static double target_fps_;
+  static double target_frame_time_;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "JobSystem.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+
+bool JobCounter::IsDone() {
+  if (count_.load(std::memory_order_acquire) != 0) {
+    return false;
+  }
+
+  //Wait for the job that brought us to zero to release the counter
+  std::lock_guard<std::mutex> lock(continuation_mutex_);
+  return true;
+}
+
+struct QueuedJob {
+  std::function<void(void)> job_;
+  JobCounter* counter_;
+};
+
+struct WorkQueue {
+  std::mutex mutex_;
+  std::deque<QueuedJob> jobs_;
+};
+
+static struct {
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> workers_;
+  //Shared FIFO for SubmitBackground, workers only
+  WorkQueue background_;
+
+  std::atomic<bool> stopping_ = false;
+  std::atomic<int> pending_jobs_ = 0;
+  std::atomic<int> pending_background_jobs_ = 0;
+
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_condition_;
+
+  std::atomic<unsigned long long> jobs_executed_ = 0;
+  std::atomic<unsigned long long> jobs_stolen_ = 0;
+} State;
+
+//Index of the queue owned by this thread, -1 for threads the job system doesn't know about
+static thread_local int thread_index = -1;
+
+static void Enqueue(const std::function<void(void)>& job, JobCounter* counter) {
+  unsigned int index = thread_index >= 0 ? static_cast<unsigned int>(thread_index) : 0;
+  WorkQueue& queue = *State.queues_[index];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex_);
+    queue.jobs_.push_back(QueuedJob { job, counter });
+  }
+  State.pending_jobs_.fetch_add(1, std::memory_order_release);
+
+  //Take the sleep lock so a worker can't miss the wakeup between checking and waiting
+  {
+    std::lock_guard<std::mutex> lock(State.sleep_mutex_);
+  }
+  State.sleep_condition_.notify_one();
+}
+
+void JobSystem::Initialize(const unsigned int& worker_count) {
+  assert(State.queues_.empty() && "Job system already initialized");
+
+  State.stopping_ = false;
+
+  //Queue 0 belongs to the initializing thread
+  for (unsigned int i = 0; i < worker_count + 1; ++i) {
+    State.queues_.push_back(std::make_unique<WorkQueue>());
+  }
+  thread_index = 0;
+
+  for (unsigned int i = 1; i < worker_count + 1; ++i) {
+    State.workers_.emplace_back([i]() { WorkerLoop(i); });
+  }
+
+  PLOGD << "Job system initialized with " << worker_count << " workers";
+}
+
+void JobSystem::Shutdown() {
+  State.stopping_ = true;
+  {
+    std::lock_guard<std::mutex> lock(State.sleep_mutex_);
+  }
+  State.sleep_condition_.notify_all();
+
+  for (std::thread& worker : State.workers_) {
+    worker.join();
+  }
+
+  PLOG_WARNING_IF(State.pending_jobs_ > 0 || State.pending_background_jobs_ > 0) 
+    << "Job system shut down with " << State.pending_jobs_ + State.pending_background_jobs_ << " jobs pending";
+
+  State.workers_.clear();
+  State.queues_.clear();
+  State.background_.jobs_.clear();
+  State.pending_jobs_ = 0;
+  State.pending_background_jobs_ = 0;
+  thread_index = -1;
+
+  PLOGD << "Job system shut down";
+}
+
+void JobSystem::Submit(const std::function<void(void)>& job, JobCounter* counter) {
+  if (counter != nullptr) {
+    counter->count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //Nobody else would ever pick it up
+  if (State.workers_.empty()) {
+    std::function<void(void)> inline_job = job;
+    Execute(inline_job, counter);
+    return;
+  }
+
+  Enqueue(job, counter);
+}
+
+void JobSystem::SubmitBackground(const std::function<void(void)>& job, JobCounter* counter) {
+  if (counter != nullptr) {
+    counter->count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (State.workers_.empty()) {
+    std::function<void(void)> inline_job = job;
+    Execute(inline_job, counter);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(State.background_.mutex_);
+    State.background_.jobs_.push_back(QueuedJob { job, counter });
+  }
+  State.pending_background_jobs_.fetch_add(1, std::memory_order_release);
+
+  {
+    std::lock_guard<std::mutex> lock(State.sleep_mutex_);
+  }
+  State.sleep_condition_.notify_one();
+}
+
+void JobSystem::Then(JobCounter& dependency, const std::function<void(void)>& job, JobCounter* counter) {
+  if (counter != nullptr) {
+    counter->count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(dependency.continuation_mutex_);
+    if (dependency.count_.load(std::memory_order_acquire) != 0) {
+      dependency.continuations_.push_back(JobCounter::Continuation { job, counter });
+      return;
+    }
+  }
+
+  if (State.workers_.empty()) {
+    std::function<void(void)> inline_job = job;
+    Execute(inline_job, counter);
+    return;
+  }
+
+  Enqueue(job, counter);
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+  while (!counter.IsDone()) {
+    if (!RunPendingJob()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool JobSystem::RunPendingJob() {
+  if (State.queues_.empty()) {
+    return false;
+  }
+
+  unsigned int index = thread_index >= 0 ? static_cast<unsigned int>(thread_index) : 0;
+
+  std::function<void(void)> job;
+  JobCounter* counter = nullptr;
+  if (!PopJob(index, job, counter)) {
+    return false;
+  }
+
+  Execute(job, counter);
+  return true;
+}
+
+void JobSystem::ParallelFor(const size_t& count, const size_t& grain_size, const std::function<void(size_t, size_t)>& body) {
+  if (count == 0) {
+    return;
+  }
+
+  size_t grain = std::max<size_t>(grain_size, 1);
+  if (count <= grain || State.workers_.empty()) {
+    body(0, count);
+    return;
+  }
+
+  JobCounter counter;
+  size_t begin = grain;
+  while (begin < count) {
+    size_t end = std::min(begin + grain, count);
+    Submit([&body, begin, end]() { body(begin, end); }, &counter);
+    begin = end;
+  }
+
+  //First chunk runs here instead of sitting in a queue
+  body(0, grain);
+  Wait(counter);
+}
+
+unsigned int JobSystem::GetWorkerCount() {
+  return static_cast<unsigned int>(State.workers_.size());
+}
+
+JobSystem::Stats JobSystem::GetStats() {
+  Stats stats;
+  stats.jobs_executed_ = State.jobs_executed_.load(std::memory_order_relaxed);
+  stats.jobs_stolen_ = State.jobs_stolen_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void JobSystem::WorkerLoop(const unsigned int& index) {
+  thread_index = static_cast<int>(index);
+
+  while (!State.stopping_) {
+    std::function<void(void)> job;
+    JobCounter* counter = nullptr;
+
+    //Frame work always goes before background work
+    if (PopJob(index, job, counter) || PopBackgroundJob(job, counter)) {
+      Execute(job, counter);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(State.sleep_mutex_);
+    State.sleep_condition_.wait(lock, []() { return State.stopping_ || State.pending_jobs_ > 0 || State.pending_background_jobs_ > 0; });
+  }
+}
+
+void JobSystem::Execute(std::function<void(void)>& job, JobCounter* counter) {
+  job();
+  State.jobs_executed_.fetch_add(1, std::memory_order_relaxed);
+  FinishJob(counter);
+}
+
+void JobSystem::FinishJob(JobCounter* counter) {
+  if (counter == nullptr) {
+    return;
+  }
+
+  //Decrement under the lock so a waiter that sees zero can't free the counter
+  //before we are done with it, see JobCounter::IsDone
+  std::vector<JobCounter::Continuation> continuations;
+  {
+    std::lock_guard<std::mutex> lock(counter->continuation_mutex_);
+    if (counter->count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      continuations.swap(counter->continuations_);
+    }
+  }
+
+  for (JobCounter::Continuation& continuation : continuations) {
+    if (State.workers_.empty()) {
+      Execute(continuation.job_, continuation.counter_);
+    } else {
+      Enqueue(continuation.job_, continuation.counter_);
+    }
+  }
+}
+
+bool JobSystem::PopJob(const unsigned int& index, std::function<void(void)>& job, JobCounter*& counter) {
+  if (State.pending_jobs_.load(std::memory_order_acquire) <= 0) {
+    return false;
+  }
+
+  //Own queue is LIFO for cache warmth
+  {
+    WorkQueue& queue = *State.queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex_);
+    if (!queue.jobs_.empty()) {
+      job = std::move(queue.jobs_.back().job_);
+      counter = queue.jobs_.back().counter_;
+      queue.jobs_.pop_back();
+      State.pending_jobs_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  //Steal the oldest job from someone else
+  size_t queue_count = State.queues_.size();
+  for (size_t offset = 1; offset < queue_count; ++offset) {
+    WorkQueue& victim = *State.queues_[(index + offset) % queue_count];
+    std::lock_guard<std::mutex> lock(victim.mutex_);
+    if (!victim.jobs_.empty()) {
+      job = std::move(victim.jobs_.front().job_);
+      counter = victim.jobs_.front().counter_;
+      victim.jobs_.pop_front();
+      State.pending_jobs_.fetch_sub(1, std::memory_order_relaxed);
+      State.jobs_stolen_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool JobSystem::PopBackgroundJob(std::function<void(void)>& job, JobCounter*& counter) {
+  if (State.pending_background_jobs_.load(std::memory_order_acquire) <= 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(State.background_.mutex_);
+  if (State.background_.jobs_.empty()) {
+    return false;
+  }
+
+  job = std::move(State.background_.jobs_.front().job_);
+  counter = State.background_.jobs_.front().counter_;
+  State.background_.jobs_.pop_front();
+  State.pending_background_jobs_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <type_traits>
+
+class JobSystem;
+
+//Tracks a group of jobs. Reaches zero once every job submitted against it
+//has finished, at which point any continuations attached with
+//JobSystem::Then are scheduled.
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+
+  bool IsDone();
+private:
+  struct Continuation {
+    std::function<void(void)> job_;
+    JobCounter* counter_;
+  };
+
+  std::atomic<int> count_ = 0;
+  std::mutex continuation_mutex_;
+  std::vector<Continuation> continuations_;
+
+  friend class JobSystem;
+};
+
+//Work-stealing job system. Every worker owns a deque; it pushes and pops its
+//own work from the back and steals from the front of other deques when empty.
+//The thread that calls Initialize is registered as thread 0 and runs jobs
+//while it waits on a counter. Long running work like asset loading goes
+//through SubmitBackground instead, only idle workers pick those up so a
+//waiting thread never gets stuck behind one.
+class JobSystem {
+public:
+  struct Stats {
+    unsigned long long jobs_executed_ = 0;
+    unsigned long long jobs_stolen_ = 0;
+  };
+
+  static void Initialize(const unsigned int& worker_count);
+  static void Shutdown();
+
+  static void Submit(const std::function<void(void)>& job, JobCounter* counter = nullptr);
+  //Never run by Wait or RunPendingJob, workers take them when they have
+  //nothing else to do. Without workers the job runs inline.
+  static void SubmitBackground(const std::function<void(void)>& job, JobCounter* counter = nullptr);
+  //Runs job once counter reaches zero
+  static void Then(JobCounter& dependency, const std::function<void(void)>& job, JobCounter* counter = nullptr);
+  //Helps run jobs until counter reaches zero, background jobs excluded
+  static void Wait(JobCounter& counter);
+  //Runs a single pending job if there is one, returns false otherwise
+  static bool RunPendingJob();
+
+  //Splits [0, count) into chunks of at most grain_size and blocks until all ran
+  static void ParallelFor(const size_t& count, const size_t& grain_size, const std::function<void(size_t, size_t)>& body);
+
+  //Calls function(entity) for every entity in an entt view across the workers.
+  //function must only touch components of the entity it is given.
+  template<typename View, typename Function>
+  static void ParallelForEach(const View& view, const size_t& grain_size, Function function) {
+    using Entity = std::decay_t<decltype(*view.begin())>;
+    std::vector<Entity> entities(view.begin(), view.end());
+
+    ParallelFor(entities.size(), grain_size, [&entities, &function](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        function(entities[i]);
+      }
+    });
+  }
+
+  static unsigned int GetWorkerCount();
+  static Stats GetStats();
+private:
+  static void WorkerLoop(const unsigned int& index);
+  static void Execute(std::function<void(void)>& job, JobCounter* counter);
+  static void FinishJob(JobCounter* counter);
+  static bool PopJob(const unsigned int& index, std::function<void(void)>& job, JobCounter*& counter);
+  static bool PopBackgroundJob(std::function<void(void)>& job, JobCounter*& counter);
+};
+
+#endif
\ No newline at end of file
@@ -24,7 +24,7 @@ static void LoadCollisions(std::vector<MapLoader::Collider>& colliders, const nl
         MapLoader::Collider { 
           MapLoader::CollisionType::kBoxType, 
           glm::vec3(pos[0], pos[1], pos[2]),
-          glm::quat(rotation[0], rotation[1], rotation[2], rotation[3]),
+          glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]), //Stored as xyzw, glm takes w first
           glm::vec3(size[0] * 0.5f, size[1] * 0.5f, size[2] * 0.5f) //Scale down to half extents
       });
     }
@@ -3,9 +3,16 @@
 #include <glad/glad.h>
 #include <plog/Log.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <tuple>
+
 #include "../Graphics/ModelLoader.h"
 #include "../Graphics/Texture.h"
 #include "../Graphics/Shader.h"
+#include "../Graphics/UniformBlocks.h"
 
 #include "../Components/MeshComponent.h"
 #include "../Components/ShaderComponent.h"
@@ -23,22 +30,28 @@ static MeshComponent CreateMeshComponentFromPrimitive(const PrimitiveData& primi
 
   mesh_component.vertex_buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeVertex);
 
-  mesh_component.vertex_buffer_->BufferData(
-    primitive.position_.size() + primitive.normal_.size() + primitive.texcoords_.size(), 
-    nullptr, 
-    BufferUsageType::kBufferStatic
-  );
+  const VertexLayout& layout = primitive.layout_;
+
+  mesh_component.num_vertices_ = primitive.vertex_count_;
+  mesh_component.position_scale_ = primitive.position_scale_;
+  mesh_component.position_offset_ = primitive.position_offset_;
+  mesh_component.bounds_center_ = primitive.bounds_center_;
+  mesh_component.bounds_extents_ = primitive.bounds_extents_;
+  mesh_component.bounds_radius_ = primitive.bounds_radius_;
 
-  mesh_component.vertex_buffer_->BufferSubData(0, primitive.position_.size(), &primitive.position_[0]);
-  mesh_component.vertex_buffer_->BufferSubData(primitive.position_.size(), primitive.normal_.size(), &primitive.normal_[0]);
-  mesh_component.vertex_buffer_->BufferSubData(primitive.position_.size() + primitive.normal_.size(), primitive.texcoords_.size(), &primitive.texcoords_[0]);
+  mesh_component.lods_ = primitive.lods_;
+  if (mesh_component.lods_.empty()) {
+    mesh_component.lods_.push_back(MeshLod { 0, static_cast<unsigned int>(primitive.indices_count_), 0.f });
+  }
+
+  mesh_component.vertex_buffer_->BufferData(primitive.vertices_.size_, primitive.vertices_.data_, BufferUsageType::kBufferStatic);
 
   mesh_component.index_buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeIndex);
-  mesh_component.index_buffer_->BufferData(primitive.indices_.size(), &primitive.indices_[0], BufferUsageType::kBufferStatic);
+  mesh_component.index_buffer_->BufferData(primitive.indices_.size_, primitive.indices_.data_, BufferUsageType::kBufferStatic);
     
-  mesh_component.vertex_array_->VertexAttribute(0, VertexFormat::kVertexFormatFloat3, sizeof(float) * 3, 0);
-  mesh_component.vertex_array_->VertexAttribute(1, VertexFormat::kVertexFormatFloat3, sizeof(float) * 3, (void*)(primitive.position_.size()));
-  mesh_component.vertex_array_->VertexAttribute(2, VertexFormat::kVertexFormatFloat3, sizeof(float) * 2, (void*)(primitive.position_.size() + primitive.normal_.size()));
+  mesh_component.vertex_array_->VertexAttribute(0, layout.position_format_, layout.stride_, (void*)(static_cast<size_t>(layout.position_offset_)));
+  mesh_component.vertex_array_->VertexAttribute(1, layout.normal_format_, layout.stride_, (void*)(static_cast<size_t>(layout.normal_offset_)));
+  mesh_component.vertex_array_->VertexAttribute(2, layout.texcoord_format_, layout.stride_, (void*)(static_cast<size_t>(layout.texcoord_offset_)));
 
   mesh_component.vertex_array_->Unbind();
   mesh_component.vertex_buffer_->Unbind();
@@ -49,47 +62,90 @@ static MeshComponent CreateMeshComponentFromPrimitive(const PrimitiveData& primi
   return mesh_component;
 }
 
-static TextureComponent CreateTextureComponentFromMaterial(const MaterialData& material) {
+//GL_MAX_ARRAY_TEXTURE_LAYERS is at least this much on every GL 3.3 driver
+constexpr size_t kMaxTextureArrayLayers = 256;
+
+static GLenum TextureFormatFromComponents(const int& components) {
+  if (components == 1) 
+    return GL_RED;
+  if (components == 2) 
+    return GL_RG;
+  if (components == 3)
+    return GL_RGB;
+  if (components == 4) 
+    return GL_RGBA;
+
+  PLOGD << "Unknown component: " << components;
+  return GL_RGB;
+}
+
+static GLenum TextureTypeFromBits(const int& bits) {
+  if (bits == 16)
+    return GL_UNSIGNED_SHORT;
+  if (bits == 8)
+    return GL_UNSIGNED_BYTE;
+
+  PLOGD << "UNKNOWN BITS: " << bits;
+  return GL_UNSIGNED_BYTE;
+}
+
+//Every material has to match the first one in size, format, wrapping and mip count
+static TextureComponent CreateTextureArrayFromMaterials(const std::vector<const MaterialData*>& materials) {
+  const MaterialData& first = *materials.front();
+
   TextureComponent texture_component;
   texture_component.texture_ = std::make_shared<Texture>();
-  texture_component.texture_->Create();
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, material.wrap_s_);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, material.wrap_t_);
-
-  GLenum format = GL_RGB;
-  if (material.component_ == 1) 
-    format = GL_RED;
-  else if (material.component_ == 2) 
-    format = GL_RG;
-  else if (material.component_ == 3)
-    format = GL_RGB;
-  else if (material.component_ == 4) 
-    format = GL_RGBA;
-  else
-    PLOGD << "Unknown component: " << material.component_;
-      
-  GLenum bits = GL_UNSIGNED_BYTE;
-  if (material.bits_ == 16)
-    bits = GL_UNSIGNED_SHORT;
-  else if (material.bits_ == 8)
-    bits = GL_UNSIGNED_BYTE;
-  else 
-    PLOGD << "UNKNOWN BITS: " << material.bits_;
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, material.texture_width_, material.texture_height_, 0, format, bits, &material.texture_data_.at(0));
-  glGenerateMipmap(GL_TEXTURE_2D); 
+  texture_component.texture_->Create(TextureType::kTextureType2DArray);
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, first.wrap_s_);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, first.wrap_t_);
+
+  const GLsizei layer_count = static_cast<GLsizei>(materials.size());
+
+  if (!first.texture_mips_.empty()) {
+    //Cooked mips go up as they are, one level of every layer at a time
+    const GLenum internal_format = TextureFormatToGL(first.texture_format_);
+    const bool compressed = IsCompressedFormat(first.texture_format_);
+    std::vector<unsigned char> level_data;
+
+    for (size_t level = 0; level < first.texture_mips_.size(); ++level) {
+      const GLsizei width = std::max(first.texture_width_ >> level, 1);
+      const GLsizei height = std::max(first.texture_height_ >> level, 1);
+      const size_t layer_size = first.texture_mips_[level].size_;
+
+      level_data.resize(layer_size * materials.size());
+      for (size_t layer = 0; layer < materials.size(); ++layer) {
+        std::memcpy(level_data.data() + layer * layer_size, materials[layer]->texture_mips_[level].data_, layer_size);
+      }
+
+      if (compressed) {
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), internal_format, width, height, layer_count, 0, static_cast<GLsizei>(level_data.size()), level_data.data());
+      } else {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), internal_format, width, height, layer_count, 0, GL_RGBA, GL_UNSIGNED_BYTE, level_data.data());
+      }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(first.texture_mips_.size() - 1));
+  } else {
+    const GLenum format = TextureFormatFromComponents(first.component_);
+    const GLenum bits = TextureTypeFromBits(first.bits_);
+
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, first.texture_width_, first.texture_height_, layer_count, 0, format, bits, nullptr);
+    for (size_t layer = 0; layer < materials.size(); ++layer) {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), first.texture_width_, first.texture_height_, 1, format, bits, materials[layer]->texture_data_.data_);
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY); 
+  }
 
   texture_component.texture_->Unbind(); 
 
-  PLOGD << "Created new texture component";
+  PLOGD << "Created texture array with " << materials.size() << " layers";
 
   return texture_component;
 }
 
-static entt::entity CreateMeshHandle(entt::registry& registry, std::map<std::string, MaterialComponent>& material_map, const PrimitiveData& primitive) {
+static entt::entity CreateMeshHandle(entt::registry& registry, std::map<std::string, MaterialComponent>& material_map, const std::map<std::string, TextureLayer>& texture_layers, const PrimitiveData& primitive) {
 
   entt::entity handle = registry.create();
 
@@ -103,9 +159,20 @@ static entt::entity CreateMeshHandle(entt::registry& registry, std::map<std::str
   } else {
     material.base_color_ = primitive.material_.base_color_;
 
+    auto texture_layer = texture_layers.find(primitive.material_.name_);
+    if (primitive.material_.use_texture_ && texture_layer != texture_layers.cend()) {
+      material.texture_handle_ = texture_layer->second.texture_handle_;
+      material.texture_layer_ = texture_layer->second.layer_;
+    }
+
+    MaterialUniforms uniforms;
+    uniforms.base_color_ = glm::vec4(material.base_color_, 1.f);
+    uniforms.texture_layer_ = material.texture_layer_;
+    material.uniform_buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeUniform);
+    material.uniform_buffer_->BufferData(sizeof(uniforms), &uniforms, BufferUsageType::kBufferStatic);
+    material.uniform_buffer_->Unbind();
+
     if (primitive.material_.use_texture_) {
-      material.texture_handle_ = registry.create();
-      registry.emplace<TextureComponent>(material.texture_handle_, CreateTextureComponentFromMaterial(primitive.material_));  
       material_map.insert(std::make_pair(primitive.material_.name_, material));
     } 
   }
@@ -115,29 +182,169 @@ static entt::entity CreateMeshHandle(entt::registry& registry, std::map<std::str
   return handle;
 }
 
-void ResourceManager::LoadModelAsset(const std::string& model_path) {
-  Model model;
-  model.LoadModel(model_path);
+//Cooking is switched off up front when the driver can't sample the result,
+//which also keeps a compressed mesh cache from being used
+static ModelLoadOptions ResolveLoadOptions(const ModelLoadOptions& options) {
+  ModelLoadOptions resolved = options;
+  if (resolved.texture_cook_.enabled_ && !IsTextureFormatSupported(TextureFormat::kTextureFormatBC1)) {
+    resolved.texture_cook_.enabled_ = false;
+  }
+  return resolved;
+}
+
+ResourceManager::ResourceManager() {
+}
+
+void ResourceManager::LoadModelAsset(const std::string& model_path, const ModelLoadOptions& options) {
+  PendingUpload upload;
+  upload.asset_ = std::make_shared<ModelAsset>();
+  upload.model_ = std::make_unique<Model>();
+  upload.path_ = model_path;
+
+  model_map_.insert_or_assign(model_path, ModelResource { upload.asset_ });
+
+  if (!upload.model_->LoadModel(model_path, ResolveLoadOptions(options))) {
+    upload.asset_->state_ = AssetState::kAssetFailed;
+    PLOG_ERROR << "Failed to load model asset: " << model_path;
+    return;
+  }
+
+  while (UploadNextPrimitive(upload)) {}
+}
+
+ModelResource ResourceManager::LoadModelAssetAsync(const std::string& model_path, const ModelLoadOptions& options) {
+  auto existing = model_map_.find(model_path);
+  if (existing != model_map_.cend()) {
+    return existing->second;
+  }
+
+  std::shared_ptr<ModelAsset> asset = std::make_shared<ModelAsset>();
+  model_map_.insert_or_assign(model_path, ModelResource { asset });
+
+  JobSystem::SubmitBackground([this, asset, model_path, options = ResolveLoadOptions(options)]() {
+    PendingUpload upload;
+    upload.asset_ = asset;
+    upload.model_ = std::make_unique<Model>();
+    upload.path_ = model_path;
+
+    if (!upload.model_->LoadModel(model_path, options)) {
+      asset->state_ = AssetState::kAssetFailed;
+      PLOG_ERROR << "Failed to load model asset: " << model_path;
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(upload_mutex_);
+    parsed_models_.push_back(std::move(upload));
+  }, &load_jobs_);
+
+  PLOGD << "Queued model asset: " << model_path;
+  return ModelResource { asset };
+}
+
+void ResourceManager::ProcessUploads(const double& budget_seconds) {
+  {
+    std::lock_guard<std::mutex> lock(upload_mutex_);
+    while (!parsed_models_.empty()) {
+      uploading_models_.push_back(std::move(parsed_models_.front()));
+      parsed_models_.pop_front();
+    }
+  }
+
+  if (uploading_models_.empty()) {
+    return;
+  }
 
-  ModelResource model_resource;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> budget(budget_seconds);
+
+  //Always upload at least one primitive so a tiny budget still makes progress
+  do {
+    if (!UploadNextPrimitive(uploading_models_.front())) {
+      uploading_models_.pop_front();
+    }
+  } while (!uploading_models_.empty() && std::chrono::steady_clock::now() - start < budget);
+}
+
+//Returns false once the model has no primitives left and is marked ready
+bool ResourceManager::UploadNextPrimitive(PendingUpload& upload) {
+  std::vector<Mesh>& meshes = upload.model_->GetMeshes();
+
+  while (upload.mesh_index_ < meshes.size() && upload.primitive_index_ >= meshes[upload.mesh_index_].primitives_.size()) {
+    ++upload.mesh_index_;
+    upload.primitive_index_ = 0;
+  }
+
+  if (upload.mesh_index_ >= meshes.size()) {
+    upload.model_.reset();
+    upload.asset_->state_ = AssetState::kAssetReady;
+    PLOGD << "Loaded model asset: " << upload.path_ << " successfully";
+    return false;
+  }
 
-  for (const Mesh& mesh : model.GetMeshes()) {
+  if (!upload.textures_created_) {
+    CreateTextureArrays(upload);
+    upload.textures_created_ = true;
+  }
+
+  const Mesh& mesh = meshes[upload.mesh_index_];
+  const PrimitiveData& primitive = mesh.primitives_[upload.primitive_index_];
+
+  entt::entity mesh_handle = CreateMeshHandle(registry_, material_map_, upload.texture_layers_, primitive);
+  registry_.emplace<TransformComponent>(mesh_handle, mesh.local_transform_);
+  upload.asset_->mesh_handles_.push_back(mesh_handle);
+
+  ++upload.primitive_index_;
+  return true;
+}
+
+//Runs before the model's first primitive is uploaded, so every texture it
+//uses is known. Materials cached from earlier models keep their textures.
+void ResourceManager::CreateTextureArrays(PendingUpload& upload) {
+  using TextureKey = std::tuple<int, int, int, int, int, int, TextureFormat, size_t, size_t>;
+  std::map<TextureKey, std::vector<const MaterialData*>> groups;
+  std::set<std::string> seen;
+
+  const bool pack = upload.model_->GetOptions().pack_texture_arrays_;
+
+  for (const Mesh& mesh : upload.model_->GetMeshes()) {
     for (const PrimitiveData& primitive : mesh.primitives_) {
-      entt::entity mesh_handle = CreateMeshHandle(registry_, material_map_, primitive);
-      registry_.emplace<TransformComponent>(mesh_handle, mesh.local_transform_);
-      model_resource.mesh_handles_.push_back(mesh_handle);
+      const MaterialData& material = primitive.material_;
+      if (!material.use_texture_ || material_map_.find(material.name_) != material_map_.cend() || !seen.insert(material.name_).second) {
+        continue;
+      }
+
+      //Unpacked textures get a key of their own
+      TextureKey key { material.texture_width_, material.texture_height_, material.component_, material.bits_, material.wrap_s_, material.wrap_t_,
+        material.texture_format_, material.texture_mips_.size(), pack ? 0 : seen.size() };
+      groups[key].push_back(&material);
     }
   }
 
-  model_map_.insert_or_assign(model_path, model_resource);
-  PLOGD << "Loaded model asset: " << model_path << " successfully";
+  for (const auto& [key, materials] : groups) {
+    for (size_t first = 0; first < materials.size(); first += kMaxTextureArrayLayers) {
+      std::vector<const MaterialData*> layers(materials.begin() + first, materials.begin() + std::min(materials.size(), first + kMaxTextureArrayLayers));
+
+      entt::entity texture_handle = registry_.create();
+      registry_.emplace<TextureComponent>(texture_handle, CreateTextureArrayFromMaterials(layers));
+
+      for (size_t layer = 0; layer < layers.size(); ++layer) {
+        upload.texture_layers_[layers[layer]->name_] = TextureLayer { texture_handle, static_cast<int>(layer) };
+      }
+    }
+  }
+
+  PLOGD << "Packed " << seen.size() << " textures into " << groups.size() << " texture array groups";
 }
 
-void ResourceManager::LoadShaderAsset(const std::string& shader_path) {
+void ResourceManager::LoadShaderAsset(const std::string& shader_path, const bool& instanced_variant) {
   std::shared_ptr<Shader> shader = std::make_shared<Shader>(shader_path.c_str());
+  std::shared_ptr<Shader> instanced_shader;
+  if (instanced_variant) {
+    instanced_shader = std::make_shared<Shader>(shader_path.c_str(), std::vector<std::string> { "INSTANCED" });
+  }
 
   entt::entity shader_handle = registry_.create(); 
-  registry_.emplace<ShaderComponent>(shader_handle, shader);
+  registry_.emplace<ShaderComponent>(shader_handle, shader, instanced_shader);
 
   ShaderResource shader_resource { shader_handle };
 
@@ -182,8 +389,12 @@ TransformComponent& ResourceManager::GetLocalTransformFromMeshHandle(const entt:
 }
 
 ResourceManager::~ResourceManager() {
+  //Parsing jobs write into our queues
+  JobSystem::Wait(load_jobs_);
+
   auto mesh_view = registry_.view<MeshComponent>();
   auto texture_view = registry_.view<TextureComponent>();
+  auto material_view = registry_.view<MaterialComponent>();
   auto shader_view = registry_.view<ShaderComponent>();
 
   for (auto [entity, mesh] : mesh_view.each()) {
@@ -193,12 +404,16 @@ ResourceManager::~ResourceManager() {
 
     PLOGD << "Deleted mesh";
   }
+  for (auto [entity, material] : material_view.each()) {
+    material.uniform_buffer_.reset();
+  }
   for (auto [entity, texture] : texture_view.each()) {
     texture.texture_.reset();
     PLOGD << "Deletd texture";
   }
   for (auto [entity, shader] : shader_view.each()) {
     shader.shader_.reset();
+    shader.instanced_shader_.reset();
     PLOGD << "Deleted shader";
   }
 } 
\ No newline at end of file
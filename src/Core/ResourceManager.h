@@ -3,6 +3,11 @@
 
 #include <entt/entt.hpp>
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
 #include "../Components/MeshComponent.h"
 #include "../Components/ShaderComponent.h"
 #include "../Components/TextureComponent.h"
@@ -10,10 +15,27 @@
 #include "../Components/MaterialComponent.h"
 #include "../Components/TransformComponent.h"
 
-struct ModelResource {
+#include "JobSystem.h"
+
+#include "../Graphics/ModelLoader.h"
+
+enum class AssetState {
+  kAssetPending,
+  kAssetReady,
+  kAssetFailed,
+};
+
+//Shared between every ModelResource handed out for the same path. mesh_handles_
+//is only filled in on the main thread, once state_ flips to kAssetReady.
+struct ModelAsset {
+  std::atomic<AssetState> state_ = AssetState::kAssetPending;
   std::vector<entt::entity> mesh_handles_;
 };
 
+struct ModelResource {
+  std::shared_ptr<ModelAsset> asset_;
+};
+
 struct ShaderResource {
   entt::entity shader_handle_;
 };
@@ -22,13 +44,24 @@ struct TextureResource {
   entt::entity texture_handle_;
 };
 
+//Where a material's texture was packed, see ResourceManager::CreateTextureArrays
+struct TextureLayer {
+  entt::entity texture_handle_;
+  int layer_ = 0;
+};
+
 class ResourceManager {
 public:
-  ResourceManager() = default;
+  ResourceManager();
   ~ResourceManager(); 
 
-  void LoadModelAsset(const std::string& model_path);
-  void LoadShaderAsset(const std::string& shader_path);
+  void LoadModelAsset(const std::string& model_path, const ModelLoadOptions& options = ModelLoadOptions());
+  //Returns immediately, parsing happens on the job system and GPU upload in ProcessUploads
+  ModelResource LoadModelAssetAsync(const std::string& model_path, const ModelLoadOptions& options = ModelLoadOptions());
+  void LoadShaderAsset(const std::string& shader_path, const bool& instanced_variant = false);
+
+  //Main thread only. Uploads parsed primitives until budget_seconds is used up.
+  void ProcessUploads(const double& budget_seconds);
 
   ModelResource GetModelResource(const std::string& path);
   ShaderResource GetShaderResource(const std::string& path);
@@ -39,9 +72,29 @@ public:
   ShaderComponent& GetShaderFromHandle(const entt::entity& handle);
 
   TextureComponent* GetTextureFromMaterialHandle(const entt::entity& handle);
+private:
+  struct PendingUpload {
+    std::shared_ptr<ModelAsset> asset_;
+    std::unique_ptr<Model> model_;
+    std::string path_;
+    size_t mesh_index_ = 0;
+    size_t primitive_index_ = 0;
+
+    bool textures_created_ = false;
+    //Keyed by material name
+    std::map<std::string, TextureLayer> texture_layers_;
+  };
+
+  bool UploadNextPrimitive(PendingUpload& upload);
+  void CreateTextureArrays(PendingUpload& upload);
 private:
   entt::registry registry_;
 
+  JobCounter load_jobs_;
+  std::mutex upload_mutex_;
+  std::deque<PendingUpload> parsed_models_;
+  std::deque<PendingUpload> uploading_models_;
+
   std::map<std::string, MaterialComponent> material_map_;
   std::map<std::string, ModelResource> model_map_;
   std::map<std::string, ShaderResource> shader_map_;
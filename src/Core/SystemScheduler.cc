@@ -0,0 +1,126 @@
+#include "SystemScheduler.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+
+#include "JobSystem.h"
+
+static bool Intersects(const std::vector<entt::id_type>& lhs, const std::vector<entt::id_type>& rhs) {
+  for (const entt::id_type& id : lhs) {
+    if (std::find(rhs.cbegin(), rhs.cend(), id) != rhs.cend()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SystemAccess::ConflictsWith(const SystemAccess& other) const {
+  if (exclusive_ || other.exclusive_) {
+    return true;
+  }
+
+  return Intersects(writes_, other.writes_) || Intersects(writes_, other.reads_) || Intersects(reads_, other.writes_);
+}
+
+void SystemScheduler::AddSystem(const SystemAccess& access, const std::function<void(void)>& system) {
+  System new_system;
+  new_system.function_ = system;
+  new_system.access_ = access;
+  systems_.push_back(new_system);
+
+  graph_dirty_ = true;
+}
+
+bool SystemScheduler::Empty() const {
+  return systems_.empty();
+}
+
+void SystemScheduler::BuildGraph() {
+  for (System& system : systems_) {
+    system.dependents_.clear();
+    system.dependency_count_ = 0;
+  }
+
+  //A system depends on every earlier system it conflicts with, so the result
+  //is identical to running them one after another in registration order
+  for (size_t i = 0; i < systems_.size(); ++i) {
+    for (size_t j = i + 1; j < systems_.size(); ++j) {
+      if (systems_[i].access_.ConflictsWith(systems_[j].access_)) {
+        systems_[i].dependents_.push_back(j);
+        ++systems_[j].dependency_count_;
+      }
+    }
+  }
+
+  pending_dependencies_.resize(systems_.size());
+  graph_dirty_ = false;
+
+  PLOGD << "Built system graph for " << systems_.size() << " systems";
+}
+
+void SystemScheduler::Run() {
+  if (graph_dirty_) {
+    BuildGraph();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_ = 0;
+    for (size_t i = 0; i < systems_.size(); ++i) {
+      pending_dependencies_[i] = systems_[i].dependency_count_;
+    }
+
+    for (size_t i = 0; i < systems_.size(); ++i) {
+      if (pending_dependencies_[i] == 0) {
+        Dispatch(i);
+      }
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (completed_ < systems_.size()) {
+    condition_.wait(lock, [this]() { return !main_thread_queue_.empty() || completed_ == systems_.size(); });
+
+    while (!main_thread_queue_.empty()) {
+      size_t index = main_thread_queue_.front();
+      main_thread_queue_.pop_front();
+
+      lock.unlock();
+      systems_[index].function_();
+      lock.lock();
+
+      Complete(index);
+    }
+  }
+}
+
+//Expects mutex_ to be held
+void SystemScheduler::Dispatch(const size_t& index) {
+  if (JobSystem::GetWorkerCount() == 0 || systems_[index].access_.IsMainThread()) {
+    main_thread_queue_.push_back(index);
+    condition_.notify_one();
+    return;
+  }
+
+  JobSystem::Submit([this, index]() {
+    systems_[index].function_();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Complete(index);
+  });
+}
+
+//Expects mutex_ to be held
+void SystemScheduler::Complete(const size_t& index) {
+  ++completed_;
+  for (const size_t& dependent : systems_[index].dependents_) {
+    if (--pending_dependencies_[dependent] == 0) {
+      Dispatch(dependent);
+    }
+  }
+
+  if (completed_ == systems_.size()) {
+    condition_.notify_all();
+  }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef SYSTEM_SCHEDULER_H_
+#define SYSTEM_SCHEDULER_H_
+
+#include <entt/entt.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <deque>
+#include <vector>
+
+//Describes which components a system touches. Systems whose access sets
+//don't conflict may run at the same time on worker threads. Anything that
+//talks to GL or changes the registry's structure must be pinned with MainThread().
+class SystemAccess {
+public:
+  SystemAccess() = default;
+  //Passing the registry makes sure the component pools exist up front, so
+  //workers never race to create a pool from inside a view
+  SystemAccess(entt::registry& registry) : registry_(&registry) {}
+
+  template<typename... Components>
+  SystemAccess& Read() {
+    (reads_.push_back(entt::type_hash<Components>::value()), ...);
+    if (registry_ != nullptr) {
+      (registry_->view<Components>(), ...);
+    }
+    return *this;
+  }
+
+  template<typename... Components>
+  SystemAccess& Write() {
+    (writes_.push_back(entt::type_hash<Components>::value()), ...);
+    if (registry_ != nullptr) {
+      (registry_->view<Components>(), ...);
+    }
+    return *this;
+  }
+
+  SystemAccess& MainThread() {
+    main_thread_ = true;
+    return *this;
+  }
+
+  //Runs alone, after everything before it and before everything after it
+  SystemAccess& Exclusive() {
+    exclusive_ = true;
+    main_thread_ = true;
+    return *this;
+  }
+
+  bool ConflictsWith(const SystemAccess& other) const;
+  bool IsMainThread() const { return main_thread_; }
+private:
+  entt::registry* registry_ = nullptr;
+
+  std::vector<entt::id_type> reads_;
+  std::vector<entt::id_type> writes_;
+
+  bool main_thread_ = false;
+  bool exclusive_ = false;
+};
+
+class SystemScheduler {
+public:
+  SystemScheduler() = default;
+
+  void AddSystem(const SystemAccess& access, const std::function<void(void)>& system);
+
+  //Runs every system once, respecting registration order between conflicting
+  //systems. Worker systems go to the JobSystem, returns once all have finished.
+  void Run();
+
+  bool Empty() const;
+private:
+  struct System {
+    std::function<void(void)> function_;
+    SystemAccess access_;
+
+    std::vector<size_t> dependents_;
+    int dependency_count_ = 0;
+  };
+
+  void BuildGraph();
+  void Dispatch(const size_t& index);
+  void Complete(const size_t& index);
+private:
+  std::vector<System> systems_;
+  bool graph_dirty_ = true;
+
+  std::vector<int> pending_dependencies_;
+  std::deque<size_t> main_thread_queue_;
+  size_t completed_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+#endif
\ No newline at end of file
@@ -3,15 +3,33 @@
 #include <GLFW/glfw3.h>
 
 double Time::delta_time_;
+double Time::fixed_delta_time_ = 1.0 / 60.0;
+double Time::interpolation_alpha_ = 0.0;
 
 void Time::SetDeltaTime(const double& delta_time) {
   delta_time_ = delta_time;
 }
 
+void Time::SetFixedDeltaTime(const double& fixed_delta_time) {
+  fixed_delta_time_ = fixed_delta_time;
+}
+
+void Time::SetInterpolationAlpha(const double& alpha) {
+  interpolation_alpha_ = alpha;
+}
+
 double Time::GetDeltaTime() {
   return delta_time_;
 }
 
+double Time::GetFixedDeltaTime() {
+  return fixed_delta_time_;
+}
+
+double Time::GetInterpolationAlpha() {
+  return interpolation_alpha_;
+}
+
 double Time::GetElapsedTime() {
   return glfwGetTime();
 }
\ No newline at end of file
@@ -4,10 +4,19 @@
 class Time {
 public:
   static double GetDeltaTime();
+  static double GetFixedDeltaTime();
   static double GetElapsedTime();
+
+  //How far between the last two fixed updates the current frame is [0, 1)
+  static double GetInterpolationAlpha();
 private:
   static void SetDeltaTime(const double& delta_time);
+  static void SetFixedDeltaTime(const double& fixed_delta_time);
+  static void SetInterpolationAlpha(const double& alpha);
+
   static double delta_time_;
+  static double fixed_delta_time_;
+  static double interpolation_alpha_;
 
   friend class Application;
 };
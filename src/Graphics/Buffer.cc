@@ -3,30 +3,43 @@
 #include <glad/glad.h>
 #include <plog/Log.h>
 
+#include "RenderState.h"
+
 static GLenum BufferTypeToGL(const BufferType& type) {
   if (type == BufferType::kBufferTypeIndex)
     return GL_ELEMENT_ARRAY_BUFFER;
+  if (type == BufferType::kBufferTypeUniform)
+    return GL_UNIFORM_BUFFER;
   return GL_ARRAY_BUFFER;
 }
 
+static const char* BufferTypeName(const BufferType& type) {
+  if (type == BufferType::kBufferTypeIndex)
+    return "Index Buffer";
+  if (type == BufferType::kBufferTypeUniform)
+    return "Uniform Buffer";
+  return "Vertex Buffer";
+}
+
 Buffer::Buffer(const BufferType& type) : type_(type) {
   glGenBuffers(1, &id_);
-  glBindBuffer(BufferTypeToGL(type), id_);
+  RenderState::BindBuffer(BufferTypeToGL(type), id_);
 
-  PLOGV << "Created buffer: " << (type == BufferType::kBufferTypeVertex ? " Vertex Buffer" : " Index Buffer"); 
+  PLOGV << "Created buffer: " << BufferTypeName(type); 
 }
 
 Buffer::~Buffer() {
-  PLOGV << "Deleted buffer: " << (type_ == BufferType::kBufferTypeVertex ? " Vertex Buffer" : " Index Buffer"); 
+  PLOGV << "Deleted buffer: " << BufferTypeName(type_); 
+  RenderState::ForgetBuffer(id_);
   glDeleteBuffers(1, &id_);
 }
 
 void Buffer::Bind() {
-  glBindBuffer(BufferTypeToGL(type_), id_);
+  RenderState::BindBuffer(BufferTypeToGL(type_), id_);
 }
 
 void Buffer::Unbind() {
- glBindBuffer(BufferTypeToGL(type_), 0); 
+ RenderState::BindBuffer(BufferTypeToGL(type_), 0); 
 }
 
 void Buffer::BufferData(const unsigned long long& size, const void* data, const BufferUsageType& usage) {
@@ -36,3 +49,24 @@ void Buffer::BufferData(const unsigned long long& size, const void* data, const
 void Buffer::BufferSubData(const unsigned long long& offset, const unsigned int& size, const void* data) {
   glBufferSubData(BufferTypeToGL(type_), offset, size, data);
 }
+
+void* Buffer::MapRange(const unsigned long long& offset, const unsigned long long& size, const bool& unsynchronized) {
+  GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+  if (unsynchronized) {
+    access |= GL_MAP_UNSYNCHRONIZED_BIT;
+  }
+
+  void* data = glMapBufferRange(BufferTypeToGL(type_), offset, size, access);
+  PLOG_ERROR_IF(data == nullptr) << "Unable to map " << BufferTypeName(type_);
+  assert(data && "Unable to map buffer");
+  return data;
+}
+
+void Buffer::Unmap() {
+  glUnmapBuffer(BufferTypeToGL(type_));
+}
+
+void Buffer::BindBase(const unsigned int& binding) {
+  assert(type_ == BufferType::kBufferTypeUniform && "Only uniform buffers have binding points!");
+  RenderState::BindUniformBufferBase(binding, id_);
+}
\ No newline at end of file
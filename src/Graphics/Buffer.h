@@ -4,6 +4,7 @@
 enum class BufferType {
   kBufferTypeVertex,
   kBufferTypeIndex,
+  kBufferTypeUniform,
 };
 
 enum class BufferUsageType {
@@ -22,6 +23,14 @@ public:
 
   void BufferData(const unsigned long long& size, const void* data, const BufferUsageType& usage = BufferUsageType::kBufferStatic);
   void BufferSubData(const unsigned long long& offset, const unsigned int& size, const void* data);
+
+  //Write only mapping of a range of the bound buffer. Unsynchronized skips the
+  //driver's wait on draws still reading the range, the caller has to fence.
+  void* MapRange(const unsigned long long& offset, const unsigned long long& size, const bool& unsynchronized);
+  void Unmap();
+
+  //Uniform buffers only, attaches the buffer to a uniform block binding point
+  void BindBase(const unsigned int& binding);
 private:
   unsigned int id_;
   BufferType type_;
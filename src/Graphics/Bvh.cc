@@ -0,0 +1,411 @@
+#include "Bvh.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+//Centroid bins per axis for the SAH split search
+constexpr int kSahBins = 8;
+
+static float SurfaceArea(const glm::vec3& min, const glm::vec3& max) {
+  glm::vec3 size = max - min;
+  return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static bool IsOverlapping(const glm::vec3& min_a, const glm::vec3& max_a, const glm::vec3& min_b, const glm::vec3& max_b) {
+  return min_a.x <= max_b.x && max_a.x >= min_b.x
+    && min_a.y <= max_b.y && max_a.y >= min_b.y
+    && min_a.z <= max_b.z && max_a.z >= min_b.z;
+}
+
+//Entry distance of the ray into the box, FLT_MAX when it misses within max_distance
+static float IntersectBox(const glm::vec3& origin, const glm::vec3& inverse_direction, const glm::vec3& min, const glm::vec3& max, const float& max_distance) {
+  float near_distance = 0.f;
+  float far_distance = max_distance;
+  for (int axis = 0; axis < 3; ++axis) {
+    float t0 = (min[axis] - origin[axis]) * inverse_direction[axis];
+    float t1 = (max[axis] - origin[axis]) * inverse_direction[axis];
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    near_distance = std::max(near_distance, t0);
+    far_distance = std::min(far_distance, t1);
+    if (near_distance > far_distance) {
+      return FLT_MAX;
+    }
+  }
+  return near_distance;
+}
+
+static float DistanceSquared(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max) {
+  float distance = 0.f;
+  for (int axis = 0; axis < 3; ++axis) {
+    float outside = std::max(std::max(min[axis] - point[axis], 0.f), point[axis] - max[axis]);
+    distance += outside * outside;
+  }
+  return distance;
+}
+
+//Bit i of the returned mask is set while the box still straddles plane i
+static bool ClassifyBox(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max, unsigned int& plane_mask) {
+  glm::vec3 center = (min + max) * 0.5f;
+  glm::vec3 extents = (max - min) * 0.5f;
+
+  for (unsigned int i = 0; i < 6; ++i) {
+    if ((plane_mask & (1u << i)) == 0) {
+      continue;
+    }
+    const glm::vec4& plane = frustum.planes_[i];
+    float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+    float radius = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+    if (distance + radius < 0.f) {
+      return false;
+    }
+    if (distance - radius >= 0.f) {
+      plane_mask &= ~(1u << i);
+    }
+  }
+  return true;
+}
+
+void Bvh::Clear() {
+  nodes_.clear();
+  indices_.clear();
+  primitive_min_.clear();
+  primitive_max_.clear();
+}
+
+void Bvh::UpdateNodeBounds(BvhNode& node) const {
+  node.min_ = glm::vec3(FLT_MAX);
+  node.max_ = glm::vec3(-FLT_MAX);
+  for (unsigned int i = node.left_first_; i < node.left_first_ + node.count_; ++i) {
+    node.min_ = glm::min(node.min_, primitive_min_[indices_[i]]);
+    node.max_ = glm::max(node.max_, primitive_max_[indices_[i]]);
+  }
+}
+
+void Bvh::Build(const BoundingBoxes& boxes) {
+  Clear();
+
+  const size_t count = boxes.Size();
+  if (count == 0) {
+    return;
+  }
+
+  primitive_min_.resize(count);
+  primitive_max_.resize(count);
+  std::vector<glm::vec3> centroids(count);
+  indices_.resize(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec3 center = boxes.GetCenter(i);
+    glm::vec3 extents(boxes.extent_x_[i], boxes.extent_y_[i], boxes.extent_z_[i]);
+    primitive_min_[i] = center - extents;
+    primitive_max_[i] = center + extents;
+    centroids[i] = center;
+    indices_[i] = static_cast<unsigned int>(i);
+  }
+
+  nodes_.reserve(count * 2 - 1);
+  nodes_.push_back(BvhNode { glm::vec3(0.f), 0, glm::vec3(0.f), static_cast<unsigned int>(count) });
+  UpdateNodeBounds(nodes_[0]);
+
+  Subdivide(0, centroids);
+}
+
+void Bvh::Subdivide(const unsigned int& root, std::vector<glm::vec3>& centroids) {
+  struct Bin {
+    glm::vec3 min_ = glm::vec3(FLT_MAX);
+    glm::vec3 max_ = glm::vec3(-FLT_MAX);
+    unsigned int count_ = 0;
+  };
+
+  std::vector<unsigned int> stack = { root };
+
+  while (!stack.empty()) {
+    const unsigned int node_index = stack.back();
+    stack.pop_back();
+
+    const unsigned int first = nodes_[node_index].left_first_;
+    const unsigned int count = nodes_[node_index].count_;
+    if (count <= kMaxLeafSize) {
+      continue;
+    }
+
+    glm::vec3 centroid_min(FLT_MAX);
+    glm::vec3 centroid_max(-FLT_MAX);
+    for (unsigned int i = first; i < first + count; ++i) {
+      centroid_min = glm::min(centroid_min, centroids[indices_[i]]);
+      centroid_max = glm::max(centroid_max, centroids[indices_[i]]);
+    }
+
+    float best_cost = FLT_MAX;
+    int best_axis = -1;
+    int best_split = 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+      const float extent = centroid_max[axis] - centroid_min[axis];
+      if (extent <= 0.f) {
+        continue;
+      }
+
+      Bin bins[kSahBins];
+      const float scale = kSahBins / extent;
+      for (unsigned int i = first; i < first + count; ++i) {
+        const unsigned int primitive = indices_[i];
+        int bin = std::min(kSahBins - 1, static_cast<int>((centroids[primitive][axis] - centroid_min[axis]) * scale));
+        bins[bin].count_++;
+        bins[bin].min_ = glm::min(bins[bin].min_, primitive_min_[primitive]);
+        bins[bin].max_ = glm::max(bins[bin].max_, primitive_max_[primitive]);
+      }
+
+      //Sweep from both ends so every split plane costs O(1)
+      float left_area[kSahBins - 1], right_area[kSahBins - 1];
+      unsigned int left_count[kSahBins - 1], right_count[kSahBins - 1];
+      Bin left, right;
+      for (int i = 0; i < kSahBins - 1; ++i) {
+        left.count_ += bins[i].count_;
+        left.min_ = glm::min(left.min_, bins[i].min_);
+        left.max_ = glm::max(left.max_, bins[i].max_);
+        left_count[i] = left.count_;
+        left_area[i] = left.count_ > 0 ? SurfaceArea(left.min_, left.max_) : 0.f;
+
+        const int j = kSahBins - 1 - i;
+        right.count_ += bins[j].count_;
+        right.min_ = glm::min(right.min_, bins[j].min_);
+        right.max_ = glm::max(right.max_, bins[j].max_);
+        right_count[j - 1] = right.count_;
+        right_area[j - 1] = right.count_ > 0 ? SurfaceArea(right.min_, right.max_) : 0.f;
+      }
+
+      for (int i = 0; i < kSahBins - 1; ++i) {
+        if (left_count[i] == 0 || right_count[i] == 0) {
+          continue;
+        }
+        float cost = left_count[i] * left_area[i] + right_count[i] * right_area[i];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_split = i;
+        }
+      }
+    }
+
+    //Every centroid in the same spot, nothing to split on
+    if (best_axis == -1) {
+      continue;
+    }
+
+    const float scale = kSahBins / (centroid_max[best_axis] - centroid_min[best_axis]);
+    unsigned int* middle = std::partition(indices_.data() + first, indices_.data() + first + count, [&](const unsigned int& primitive) {
+      int bin = std::min(kSahBins - 1, static_cast<int>((centroids[primitive][best_axis] - centroid_min[best_axis]) * scale));
+      return bin <= best_split;
+    });
+    const unsigned int left_count = static_cast<unsigned int>(middle - indices_.data()) - first;
+    assert(left_count > 0 && left_count < count && "SAH split left a side empty");
+
+    const unsigned int left_index = static_cast<unsigned int>(nodes_.size());
+    nodes_.push_back(BvhNode { glm::vec3(0.f), first, glm::vec3(0.f), left_count });
+    nodes_.push_back(BvhNode { glm::vec3(0.f), first + left_count, glm::vec3(0.f), count - left_count });
+    UpdateNodeBounds(nodes_[left_index]);
+    UpdateNodeBounds(nodes_[left_index + 1]);
+
+    nodes_[node_index].left_first_ = left_index;
+    nodes_[node_index].count_ = 0;
+
+    stack.push_back(left_index);
+    stack.push_back(left_index + 1);
+  }
+}
+
+void Bvh::Refit(const BoundingBoxes& boxes) {
+  assert(boxes.Size() == GetPrimitiveCount() && "Refit needs the boxes the tree was built from");
+
+  for (size_t i = 0; i < boxes.Size(); ++i) {
+    glm::vec3 center = boxes.GetCenter(i);
+    glm::vec3 extents(boxes.extent_x_[i], boxes.extent_y_[i], boxes.extent_z_[i]);
+    primitive_min_[i] = center - extents;
+    primitive_max_[i] = center + extents;
+  }
+
+  //Children are always created after their parent, so walking backwards
+  //visits both children before the node itself
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    BvhNode& node = nodes_[i];
+    if (node.count_ > 0) {
+      UpdateNodeBounds(node);
+    } else {
+      const BvhNode& left = nodes_[node.left_first_];
+      const BvhNode& right = nodes_[node.left_first_ + 1];
+      node.min_ = glm::min(left.min_, right.min_);
+      node.max_ = glm::max(left.max_, right.max_);
+    }
+  }
+}
+
+void Bvh::CullFrustum(const Frustum& frustum, std::vector<unsigned char>& visible) const {
+  visible.assign(GetPrimitiveCount(), 0);
+  if (nodes_.empty()) {
+    return;
+  }
+
+  //Planes a subtree already lies fully inside of are dropped from the mask
+  std::vector<std::pair<unsigned int, unsigned int>> stack = { { 0u, 0x3Fu } };
+
+  while (!stack.empty()) {
+    auto [node_index, plane_mask] = stack.back();
+    stack.pop_back();
+
+    const BvhNode& node = nodes_[node_index];
+    if (plane_mask != 0 && !ClassifyBox(frustum, node.min_, node.max_, plane_mask)) {
+      continue;
+    }
+
+    if (node.count_ == 0) {
+      stack.push_back({ node.left_first_, plane_mask });
+      stack.push_back({ node.left_first_ + 1, plane_mask });
+      continue;
+    }
+
+    for (unsigned int i = node.left_first_; i < node.left_first_ + node.count_; ++i) {
+      const unsigned int primitive = indices_[i];
+      unsigned int primitive_mask = plane_mask;
+      if (primitive_mask == 0 || ClassifyBox(frustum, primitive_min_[primitive], primitive_max_[primitive], primitive_mask)) {
+        visible[primitive] = 1;
+      }
+    }
+  }
+}
+
+void Bvh::QueryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& results) const {
+  if (nodes_.empty()) {
+    return;
+  }
+
+  std::vector<unsigned int> stack = { 0u };
+  while (!stack.empty()) {
+    const BvhNode& node = nodes_[stack.back()];
+    stack.pop_back();
+
+    if (!IsOverlapping(node.min_, node.max_, min, max)) {
+      continue;
+    }
+
+    if (node.count_ == 0) {
+      stack.push_back(node.left_first_);
+      stack.push_back(node.left_first_ + 1);
+      continue;
+    }
+
+    for (unsigned int i = node.left_first_; i < node.left_first_ + node.count_; ++i) {
+      if (IsOverlapping(primitive_min_[indices_[i]], primitive_max_[indices_[i]], min, max)) {
+        results.push_back(indices_[i]);
+      }
+    }
+  }
+}
+
+bool Bvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, const float& max_distance, unsigned int& primitive, float& distance) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  //Division by zero gives infinities, which the slab test handles
+  const glm::vec3 inverse_direction(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+  float closest = max_distance;
+  bool hit = false;
+
+  std::vector<std::pair<unsigned int, float>> stack = { { 0u, IntersectBox(origin, inverse_direction, nodes_[0].min_, nodes_[0].max_, closest) } };
+  while (!stack.empty()) {
+    auto [node_index, entry] = stack.back();
+    stack.pop_back();
+
+    if (entry == FLT_MAX || (hit && entry >= closest)) {
+      continue;
+    }
+
+    const BvhNode& node = nodes_[node_index];
+    if (node.count_ == 0) {
+      float left = IntersectBox(origin, inverse_direction, nodes_[node.left_first_].min_, nodes_[node.left_first_].max_, closest);
+      float right = IntersectBox(origin, inverse_direction, nodes_[node.left_first_ + 1].min_, nodes_[node.left_first_ + 1].max_, closest);
+
+      //Nearer child goes on top so it's searched first and shrinks closest sooner
+      if (left <= right) {
+        if (right != FLT_MAX) stack.push_back({ node.left_first_ + 1, right });
+        if (left != FLT_MAX) stack.push_back({ node.left_first_, left });
+      } else {
+        if (left != FLT_MAX) stack.push_back({ node.left_first_, left });
+        if (right != FLT_MAX) stack.push_back({ node.left_first_ + 1, right });
+      }
+      continue;
+    }
+
+    for (unsigned int i = node.left_first_; i < node.left_first_ + node.count_; ++i) {
+      float primitive_distance = IntersectBox(origin, inverse_direction, primitive_min_[indices_[i]], primitive_max_[indices_[i]], closest);
+      if (primitive_distance != FLT_MAX && (!hit || primitive_distance < closest)) {
+        closest = primitive_distance;
+        primitive = indices_[i];
+        hit = true;
+      }
+    }
+  }
+
+  distance = closest;
+  return hit;
+}
+
+void Bvh::QueryNearest(const glm::vec3& point, const size_t& k, std::vector<unsigned int>& results) const {
+  if (nodes_.empty() || k == 0) {
+    return;
+  }
+
+  //Max heap on distance, the root is the worst of the best k so far
+  std::vector<std::pair<float, unsigned int>> nearest;
+  nearest.reserve(k + 1);
+
+  std::vector<std::pair<unsigned int, float>> stack = { { 0u, DistanceSquared(point, nodes_[0].min_, nodes_[0].max_) } };
+  while (!stack.empty()) {
+    auto [node_index, node_distance] = stack.back();
+    stack.pop_back();
+
+    if (nearest.size() == k && node_distance > nearest.front().first) {
+      continue;
+    }
+
+    const BvhNode& node = nodes_[node_index];
+    if (node.count_ == 0) {
+      float left = DistanceSquared(point, nodes_[node.left_first_].min_, nodes_[node.left_first_].max_);
+      float right = DistanceSquared(point, nodes_[node.left_first_ + 1].min_, nodes_[node.left_first_ + 1].max_);
+      if (left <= right) {
+        stack.push_back({ node.left_first_ + 1, right });
+        stack.push_back({ node.left_first_, left });
+      } else {
+        stack.push_back({ node.left_first_, left });
+        stack.push_back({ node.left_first_ + 1, right });
+      }
+      continue;
+    }
+
+    for (unsigned int i = node.left_first_; i < node.left_first_ + node.count_; ++i) {
+      const unsigned int primitive = indices_[i];
+      float distance = DistanceSquared(point, primitive_min_[primitive], primitive_max_[primitive]);
+      if (nearest.size() < k) {
+        nearest.push_back({ distance, primitive });
+        std::push_heap(nearest.begin(), nearest.end());
+      } else if (distance < nearest.front().first) {
+        std::pop_heap(nearest.begin(), nearest.end());
+        nearest.back() = { distance, primitive };
+        std::push_heap(nearest.begin(), nearest.end());
+      }
+    }
+  }
+
+  std::sort_heap(nearest.begin(), nearest.end());
+  for (const auto& [distance, primitive] : nearest) {
+    results.push_back(primitive);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+//Interior nodes have count_ == 0 and their children at left_first_ and
+//left_first_ + 1. Leaves hold count_ primitives starting at left_first_ in
+//the index array.
+struct BvhNode {
+  glm::vec3 min_;
+  unsigned int left_first_;
+  glm::vec3 max_;
+  unsigned int count_;
+};
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode should stay two per cache line");
+
+//Bounding volume hierarchy over axis aligned boxes, stored as one flat node
+//array. Build once, then Refit when the boxes move without the tree changing
+//much. Doesn't touch GL, so it can be built and queried anywhere.
+class Bvh {
+public:
+  static constexpr unsigned int kMaxLeafSize = 4;
+
+  void Build(const BoundingBoxes& boxes);
+  //Boxes must be the same ones Build saw, just moved
+  void Refit(const BoundingBoxes& boxes);
+  void Clear();
+
+  size_t GetPrimitiveCount() const { return primitive_min_.size(); }
+  size_t GetNodeCount() const { return nodes_.size(); }
+  bool IsEmpty() const { return nodes_.empty(); }
+
+  //Same contract as CullBoxes, but whole subtrees are accepted or rejected at once
+  void CullFrustum(const Frustum& frustum, std::vector<unsigned char>& visible) const;
+
+  //Appends every primitive whose box overlaps [min, max]
+  void QueryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& results) const;
+  //Nearest primitive box hit along the ray, direction doesn't need to be normalized.
+  //distance is in units of direction.
+  bool Raycast(const glm::vec3& origin, const glm::vec3& direction, const float& max_distance, unsigned int& primitive, float& distance) const;
+  //Up to k primitives ordered by distance from point to their box, nearest first
+  void QueryNearest(const glm::vec3& point, const size_t& k, std::vector<unsigned int>& results) const;
+private:
+  void UpdateNodeBounds(BvhNode& node) const;
+  void Subdivide(const unsigned int& node_index, std::vector<glm::vec3>& centroids);
+private:
+  std::vector<BvhNode> nodes_;
+  std::vector<unsigned int> indices_;
+  std::vector<glm::vec3> primitive_min_;
+  std::vector<glm::vec3> primitive_max_;
+};
+
+#endif
\ No newline at end of file
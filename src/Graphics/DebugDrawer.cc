@@ -5,19 +5,35 @@
 #include <glad/glad.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
 #include "../Core/Time.h"
+#include "RenderState.h"
 
 
-int DebugDrawer::current_line_batch_ = 0;
-std::vector<DebugDrawer::LineBatch> DebugDrawer::line_batches_;
+std::vector<DebugDrawer::LineVertex> DebugDrawer::line_vertices_;
+std::shared_ptr<VertexArray> DebugDrawer::line_vertex_array_;
+std::shared_ptr<StreamBuffer> DebugDrawer::line_stream_;
 
-std::vector<DebugDrawer::Square> DebugDrawer::squares_;
+DebugDrawer::ShapeBatch DebugDrawer::shapes_[static_cast<int>(DebugDrawer::Shape::kShapeCount)];
+std::shared_ptr<Shader> DebugDrawer::shape_shader_;
+std::shared_ptr<StreamBuffer> DebugDrawer::shape_stream_;
 
-DebugDrawer::Mesh DebugDrawer::square_;
 std::shared_ptr<Shader> DebugDrawer::shader_;
 
-constexpr int kMaxLineVertices = 20000 * 2;
+//Starting size of each stream region, it grows when a frame needs more
+constexpr int kInitialLineVertices = 20000 * 2;
+constexpr int kInitialShapeInstances = 4096;
+
+//Per instance model matrix takes locations 2 to 5 in the shape shader
+constexpr unsigned int kShapeColorLocation = 1;
+constexpr unsigned int kShapeMatrixLocation = 2;
+
+constexpr int kSphereSegments = 24;
+constexpr float kArrowHeadLength = 0.2f;
+constexpr float kArrowHeadWidth = 0.1f;
 
 void DebugDrawer::InitializeDebugDrawer(void) {
  const char* glsl_source = {
@@ -46,103 +62,298 @@ void DebugDrawer::InitializeDebugDrawer(void) {
   shader_->LoadSource(glsl_source);
   shader_->LoadUniform("viewProjection").LoadUniform("model");
 
-  std::shared_ptr<VertexArray> line_vertex_array = std::make_shared<VertexArray>();
-  line_vertex_array->Create();
+  line_vertex_array_ = std::make_shared<VertexArray>();
+  line_vertex_array_->Create();
 
-  std::shared_ptr<Buffer> line_vertex_buffer = std::make_shared<Buffer>(BufferType::kBufferTypeVertex);
-  line_vertex_buffer->BufferData(sizeof(DebugDrawer::LineVertex) * kMaxLineVertices, nullptr, BufferUsageType::kBufferDynamic);
+  line_stream_ = std::make_shared<StreamBuffer>(sizeof(DebugDrawer::LineVertex) * kInitialLineVertices);
 
-  line_vertex_array->VertexAttribute(0, VertexFormat::kVertexFormatFloat3, sizeof(DebugDrawer::LineVertex), (void*)offsetof(DebugDrawer::LineVertex, position_));
-  line_vertex_array->VertexAttribute(1, VertexFormat::kVertexFormatFloat3, sizeof(DebugDrawer::LineVertex), (void*)offsetof(DebugDrawer::LineVertex, color_));
+  line_vertex_array_->VertexAttribute(0, VertexFormat::kVertexFormatFloat3, sizeof(DebugDrawer::LineVertex), (void*)offsetof(DebugDrawer::LineVertex, position_));
+  line_vertex_array_->VertexAttribute(1, VertexFormat::kVertexFormatFloat3, sizeof(DebugDrawer::LineVertex), (void*)offsetof(DebugDrawer::LineVertex, color_));
 
-  line_vertex_array->Unbind();
-  line_vertex_buffer->Unbind();
+  line_vertex_array_->Unbind();
+  line_stream_->GetBuffer().Unbind();
 
-  line_batches_.push_back(LineBatch { line_vertex_array, line_vertex_buffer });
+  line_vertices_.reserve(kInitialLineVertices);
+
+  const char* shape_glsl_source = {
+    "#vertex\n" 
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec3 aColor;\n"
+    "layout (location = 2) in mat4 aModel;\n"
+    "uniform mat4 viewProjection;\n"
+    "out vec3 color;\n"
+    "void main() {\n"
+    "color = aColor;\n"
+    "gl_Position = viewProjection * aModel * vec4(aPos, 1.0);\n"
+    "}\n"
+    "\n"
+    "#fragment\n"
+    "#version 330 core\n"
+    "out vec4 fragColor;\n"
+    "in vec3 color;\n"
+    "void main() {\n"
+    "fragColor = vec4(color, 1.0);\n"
+    "}\n"
+  };
+
+  shape_shader_ = std::make_shared<Shader>();
+  shape_shader_->LoadSource(shape_glsl_source);
+  shape_shader_->LoadUniform("viewProjection");
+
+  shape_stream_ = std::make_shared<StreamBuffer>((sizeof(glm::mat4) + sizeof(glm::vec3)) * kInitialShapeInstances);
+  shape_stream_->GetBuffer().Unbind();
+
+  //Unit square on the ground plane
+  CreateShapeMesh(Shape::kShapeSquare, 
+    { glm::vec3(-0.5f, 0.f, -0.5f), glm::vec3(0.5f, 0.f, -0.5f), glm::vec3(0.5f, 0.f, 0.5f), glm::vec3(-0.5f, 0.f, 0.5f) },
+    { 0, 1, 2, 0, 2, 3 },
+    GL_TRIANGLES);
+
+  //Corners of [-1, 1]^3, scaled by the extents
+  std::vector<glm::vec3> box_vertices;
+  for (int i = 0; i < 8; ++i) {
+    box_vertices.push_back(glm::vec3((i & 1) ? 1.f : -1.f, (i & 2) ? 1.f : -1.f, (i & 4) ? 1.f : -1.f));
+  }
+  CreateShapeMesh(Shape::kShapeBox, box_vertices,
+    { 0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7 },
+    GL_LINES);
+
+  //One circle around each axis of the unit sphere
+  std::vector<glm::vec3> sphere_vertices;
+  std::vector<unsigned short> sphere_indices;
+  for (int axis = 0; axis < 3; ++axis) {
+    const unsigned short first = static_cast<unsigned short>(sphere_vertices.size());
+    for (int i = 0; i < kSphereSegments; ++i) {
+      float angle = glm::radians(360.f * i / kSphereSegments);
+      glm::vec3 vertex(0.f);
+      vertex[(axis + 1) % 3] = std::cos(angle);
+      vertex[(axis + 2) % 3] = std::sin(angle);
+      sphere_vertices.push_back(vertex);
+      sphere_indices.push_back(first + i);
+      sphere_indices.push_back(first + (i + 1) % kSphereSegments);
+    }
+  }
+  CreateShapeMesh(Shape::kShapeSphere, sphere_vertices, sphere_indices, GL_LINES);
+
+  //Unit length along +z, with a four line head
+  const float head_start = 1.f - kArrowHeadLength;
+  CreateShapeMesh(Shape::kShapeArrow,
+    { glm::vec3(0.f), glm::vec3(0.f, 0.f, 1.f),
+      glm::vec3(kArrowHeadWidth, 0.f, head_start), glm::vec3(-kArrowHeadWidth, 0.f, head_start),
+      glm::vec3(0.f, kArrowHeadWidth, head_start), glm::vec3(0.f, -kArrowHeadWidth, head_start) },
+    { 0, 1, 1, 2, 1, 3, 1, 4, 1, 5 },
+    GL_LINES);
 
   PLOGD << "Initialized Debug Drawer";
 }
 
 void DebugDrawer::CreateLine(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color) {
-  if (line_batches_[current_line_batch_].line_vertices_.size() >= kMaxLineVertices) {
-    std::shared_ptr<VertexArray> line_vertex_array = std::make_shared<VertexArray>();
-    line_vertex_array->Create();
+  line_vertices_.push_back(DebugDrawer::LineVertex { from, color });  
+  line_vertices_.push_back(DebugDrawer::LineVertex { to, color });  
+}
 
-    std::shared_ptr<Buffer> line_vertex_buffer = std::make_shared<Buffer>(BufferType::kBufferTypeVertex);
-    line_vertex_buffer->BufferData(sizeof(DebugDrawer::LineVertex) * kMaxLineVertices, nullptr, BufferUsageType::kBufferDynamic);
+void DebugDrawer::DrawLines(const glm::mat4& view_projection) { 
+  if (line_vertices_.size() < 2) {
+    return;
+  }
 
-    line_vertex_array->VertexAttribute(0, VertexFormat::kVertexFormatFloat3, sizeof(DebugDrawer::LineVertex), (void*)offsetof(DebugDrawer::LineVertex, position_));
-    line_vertex_array->VertexAttribute(1, VertexFormat::kVertexFormatFloat3, sizeof(DebugDrawer::LineVertex), (void*)offsetof(DebugDrawer::LineVertex, color_));
+  const unsigned long long size = sizeof(LineVertex) * line_vertices_.size();
+  unsigned long long offset = 0;
+  void* data = line_stream_->Map(size, offset);
+  std::memcpy(data, line_vertices_.data(), size);
+  line_stream_->Unmap();
 
-    line_batches_.push_back(LineBatch { line_vertex_array, line_vertex_buffer });
-    ++current_line_batch_;
-  }
-  LineBatch& current_batch = line_batches_[current_line_batch_];
-  current_batch.line_vertices_.push_back(DebugDrawer::LineVertex { from, color });  
-  current_batch.line_vertices_.push_back(DebugDrawer::LineVertex { to, color });  
+  line_vertex_array_->Bind();
+  shader_->Bind();  
+
+  shader_->SetUniform_Matrix("model", glm::mat4(1.f));
+  shader_->SetUniform_Matrix("viewProjection", view_projection);
+
+  //Regions start on a whole vertex, so first picks the region without touching the attributes
+  glDrawArrays(GL_LINES, static_cast<GLint>(offset / sizeof(LineVertex)), static_cast<GLsizei>(line_vertices_.size()));
+  line_stream_->Fence();
+
+  RenderState::BindVertexArray(0);
 }
 
-void DebugDrawer::DrawLines(const glm::mat4& view_projection) { 
-  for (LineBatch& current_batch : line_batches_) {
-    current_batch.vertex_buffer_->Bind();
+void DebugDrawer::CreateShapeMesh(const Shape& shape, const std::vector<glm::vec3>& vertices, const std::vector<unsigned short>& indices, const int& draw_mode) {
+  ShapeBatch& batch = shapes_[static_cast<int>(shape)];
 
-    if (current_batch.line_vertices_.size() >= 2) {
-      current_batch.vertex_buffer_->BufferSubData(0, sizeof(LineVertex) * current_batch.line_vertices_.size(), &current_batch.line_vertices_[0]);
-    } else {
-      continue;
-    }
+  batch.vertex_array_ = std::make_shared<VertexArray>();
+  batch.vertex_array_->Create();
+
+  batch.vertex_buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeVertex);
+  batch.vertex_buffer_->BufferData(sizeof(glm::vec3) * vertices.size(), vertices.data());
 
-    current_batch.vertex_buffer_->Unbind();
+  batch.index_buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeIndex);
+  batch.index_buffer_->BufferData(sizeof(unsigned short) * indices.size(), indices.data());
 
-    current_batch.vertex_array_->Bind();
-    shader_->Bind();  
+  batch.vertex_array_->VertexAttribute(0, VertexFormat::kVertexFormatFloat3, sizeof(glm::vec3), (void*)0);
 
-    shader_->SetUniform_Matrix("model", glm::translate(glm::mat4(1.f), glm::vec3(0.f)));
-    shader_->SetUniform_Matrix("viewProjection", view_projection);
+  batch.vertex_array_->Unbind();
+  batch.vertex_buffer_->Unbind();
+  batch.index_buffer_->Unbind();
 
-    glDrawArrays(GL_LINES, 0, current_batch.line_vertices_.size());
+  batch.draw_mode_ = draw_mode;
+  batch.index_count_ = static_cast<int>(indices.size());
+}
 
-    shader_->Unbind();
-    current_batch.vertex_array_->Unbind();
+void DebugDrawer::AddShape(const Shape& shape, const glm::mat4& model, const glm::vec3& color, const float& lifetime) {
+  ShapeBatch& batch = shapes_[static_cast<int>(shape)];
+  batch.models_.push_back(model);
+  batch.colors_.push_back(color);
+  batch.time_left_.push_back(lifetime < 0.f ? std::numeric_limits<float>::infinity() : lifetime);
+}
+
+void DebugDrawer::CreateSquare(const glm::vec3& position, const glm::vec3& color, const float& lifetime) {
+  AddShape(Shape::kShapeSquare, glm::translate(glm::mat4(1.f), position), color, lifetime);
+}
+
+void DebugDrawer::CreateBox(const glm::vec3& center, const glm::vec3& extents, const glm::vec3& color, const float& lifetime) {
+  AddShape(Shape::kShapeBox, glm::scale(glm::translate(glm::mat4(1.f), center), extents), color, lifetime);
+}
+
+void DebugDrawer::CreateSphere(const glm::vec3& center, const float& radius, const glm::vec3& color, const float& lifetime) {
+  AddShape(Shape::kShapeSphere, glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(radius)), color, lifetime);
+}
+
+void DebugDrawer::CreateArrow(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color, const float& lifetime) {
+  const glm::vec3 direction = to - from;
+  const float length = glm::length(direction);
+  if (length <= 0.f) {
+    return;
   }
+
+  //Any basis with +z along the arrow will do
+  const glm::vec3 z = direction / length;
+  const glm::vec3 up = std::fabs(z.y) < 0.99f ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(1.f, 0.f, 0.f);
+  const glm::vec3 x = glm::normalize(glm::cross(up, z));
+  const glm::vec3 y = glm::cross(z, x);
+
+  glm::mat4 model(1.f);
+  model[0] = glm::vec4(x * length, 0.f);
+  model[1] = glm::vec4(y * length, 0.f);
+  model[2] = glm::vec4(direction, 0.f);
+  model[3] = glm::vec4(from, 1.f);
+  AddShape(Shape::kShapeArrow, model, color, lifetime);
 }
 
-void DebugDrawer::DrawSquares(const glm::mat4& view_projection) {
-  for (Square& square : squares_) {
-    square_.vertex_array_->Bind();
-    shader_->Bind();
+void DebugDrawer::DrawShapes(const glm::mat4& view_projection) {
+  constexpr int kShapeCount = static_cast<int>(Shape::kShapeCount);
 
-    shader_->SetUniform_Float3("color", square.color_.x, square.color_.y, square.color_.z);
-    shader_->SetUniform_Matrix("viewProjection", view_projection);
-    shader_->SetUniform_Matrix("model", glm::translate(glm::mat4(1.0), square.position_));
+  size_t instance_count = 0;
+  for (const ShapeBatch& batch : shapes_) {
+    instance_count += batch.models_.size();
+  }
+
+  if (instance_count > 0) {
+    //Each shape's matrices, then its colors, packed one shape after another
+    unsigned long long matrix_offsets[kShapeCount];
+    unsigned long long color_offsets[kShapeCount];
 
-    glDisable(GL_CULL_FACE);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-    glEnable(GL_CULL_FACE);
+    unsigned long long region_offset = 0;
+    unsigned char* data = static_cast<unsigned char*>(shape_stream_->Map(instance_count * (sizeof(glm::mat4) + sizeof(glm::vec3)), region_offset));
+    unsigned long long written = 0;
 
-    shader_->Unbind();
-    square_.vertex_array_->Unbind();
+    for (int i = 0; i < kShapeCount; ++i) {
+      const ShapeBatch& batch = shapes_[i];
+      if (batch.models_.empty()) {
+        continue;
+      }
 
-    if (square.life_time_ != -1) {
-      square.timer_ += Time::GetDeltaTime();
+      matrix_offsets[i] = region_offset + written;
+      std::memcpy(data + written, batch.models_.data(), sizeof(glm::mat4) * batch.models_.size());
+      written += sizeof(glm::mat4) * batch.models_.size();
+
+      color_offsets[i] = region_offset + written;
+      std::memcpy(data + written, batch.colors_.data(), sizeof(glm::vec3) * batch.colors_.size());
+      written += sizeof(glm::vec3) * batch.colors_.size();
+    }
+    shape_stream_->Unmap();
+
+    shape_shader_->Bind();
+    shape_shader_->SetUniform_Matrix("viewProjection", view_projection);
+
+    for (int i = 0; i < kShapeCount; ++i) {
+      ShapeBatch& batch = shapes_[i];
+      if (batch.models_.empty()) {
+        continue;
+      }
+
+      //Squares are visible from both sides
+      const bool two_sided = static_cast<Shape>(i) == Shape::kShapeSquare;
+      if (two_sided) {
+        RenderState::SetCapability(RenderCapability::kCapabilityCullFace, false);
+      }
+
+      //No base instance in GL 3.3, the instance attributes are pointed at this frame's data instead
+      batch.vertex_array_->Bind();
+      shape_stream_->GetBuffer().Bind();
+      batch.vertex_array_->InstanceAttribute(kShapeColorLocation, VertexFormat::kVertexFormatFloat3, sizeof(glm::vec3), color_offsets[i]);
+      batch.vertex_array_->InstanceMatrixAttribute(kShapeMatrixLocation, matrix_offsets[i]);
+
+      glDrawElementsInstanced(batch.draw_mode_, batch.index_count_, GL_UNSIGNED_SHORT, 0, static_cast<GLsizei>(batch.models_.size()));
+
+      if (two_sided) {
+        RenderState::SetCapability(RenderCapability::kCapabilityCullFace, true);
+      }
     }
+
+    shape_stream_->Fence();
+    RenderState::BindVertexArray(0);
   }
 
-  std::remove_if(squares_.begin(), squares_.end(), [](const Square& square) {
-    return (square.timer_ >= square.life_time_) && square.life_time_ != -1;
-  });
+  const float delta_time = static_cast<float>(Time::GetDeltaTime());
+  for (ShapeBatch& batch : shapes_) {
+    AgeShapes(batch, delta_time);
+  }
 }
 
-void DebugDrawer::CreateSquare(const glm::vec3& position, const glm::vec3& color, const int& lifetime) {
+void DebugDrawer::AgeShapes(ShapeBatch& batch, const float& delta_time) {
+  for (size_t i = 0; i < batch.time_left_.size();) {
+    batch.time_left_[i] -= delta_time;
+    if (batch.time_left_[i] >= 0.f) {
+      ++i;
+      continue;
+    }
+
+    batch.models_[i] = batch.models_.back();
+    batch.colors_[i] = batch.colors_.back();
+    batch.time_left_[i] = batch.time_left_.back();
+    batch.models_.pop_back();
+    batch.colors_.pop_back();
+    batch.time_left_.pop_back();
+  }
 }
 
 void DebugDrawer::FlushLines() {
-  current_line_batch_ = 0;
-  for (LineBatch& batch : line_batches_) {
-    batch.line_vertices_.clear();
+  line_vertices_.clear();
+}
+
+void DebugDrawer::FlushShapes() {
+  for (int i = 0; i < static_cast<int>(Shape::kShapeCount); ++i) {
+    FlushShapes(static_cast<Shape>(i));
   }
 }
 
-void DebugDrawer::FlushSquares() {
-  squares_.clear();
+void DebugDrawer::FlushShapes(const Shape& shape) {
+  ShapeBatch& batch = shapes_[static_cast<int>(shape)];
+  batch.models_.clear();
+  batch.colors_.clear();
+  batch.time_left_.clear();
+}
+
+void DebugDrawer::Release() {
+  for (ShapeBatch& batch : shapes_) {
+    batch.vertex_array_.reset();
+    batch.vertex_buffer_.reset();
+    batch.index_buffer_.reset();
+  }
+  shape_stream_.reset();
+  shape_shader_.reset();
+
+  line_stream_.reset();
+  line_vertex_array_.reset();
+  shader_.reset();
 }
\ No newline at end of file
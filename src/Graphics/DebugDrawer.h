@@ -10,49 +10,74 @@
 #include "VertexArray.h"
 #include "Buffer.h"
 #include "Shader.h"
+#include "StreamBuffer.h"
+
+//Lifetime that keeps a shape around until FlushShapes
+constexpr float kDebugLifetimeForever = -1.f;
 
 class DebugDrawer {
 public:
-  struct Mesh { 
-    std::shared_ptr<VertexArray> vertex_array_;
-    std::shared_ptr<Buffer> index_buffer_;
-    std::shared_ptr<Buffer> vertex_buffer_;
-    glm::vec3 color_;
-  }; 
-
-  struct LineVertex {
-    glm::vec3 position_;
-    glm::vec3 color_;
+  enum class Shape {
+    kShapeSquare,
+    kShapeBox,
+    kShapeSphere,
+    kShapeArrow,
+    kShapeCount,
   };
 
-  struct LineBatch {
-    std::shared_ptr<VertexArray> vertex_array_;
-    std::shared_ptr<Buffer> vertex_buffer_;
-    std::vector<LineVertex> line_vertices_;
-  };
-
-  struct Square {
+  struct LineVertex {
     glm::vec3 position_;
     glm::vec3 color_;
-    int life_time_;
-    double timer_ = 0.0;
   };
 
   static void InitializeDebugDrawer(void);
 
   static void CreateLine(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color);
-  static void CreateSquare(const glm::vec3& position, const glm::vec3& color, const int& lifetime);
-  static void DrawSquares(const glm::mat4& view_projection);
+
+  //Lifetimes are in seconds, 0 draws the shape for a single frame
+  static void CreateSquare(const glm::vec3& position, const glm::vec3& color, const float& lifetime = 0.f);
+  static void CreateBox(const glm::vec3& center, const glm::vec3& extents, const glm::vec3& color, const float& lifetime = 0.f);
+  static void CreateSphere(const glm::vec3& center, const float& radius, const glm::vec3& color, const float& lifetime = 0.f);
+  static void CreateArrow(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color, const float& lifetime = 0.f);
+
+  //One instanced draw per shape type, then ages every shape
+  static void DrawShapes(const glm::mat4& view_projection);
   static void DrawLines(const glm::mat4& view_projection);
   static void FlushLines();
-  static void FlushSquares();
+  static void FlushShapes();
+  //Removes every instance of one shape, whatever its lifetime
+  static void FlushShapes(const Shape& shape);
+
+  //Frees GL resources, call before the context goes away
+  static void Release();
 private: 
-  static std::vector<Square> squares_;
+  //A unit mesh and every live instance of it. Expired instances are swapped
+  //with the last one, so the arrays stay packed and upload in one copy each.
+  struct ShapeBatch {
+    std::shared_ptr<VertexArray> vertex_array_;
+    std::shared_ptr<Buffer> vertex_buffer_;
+    std::shared_ptr<Buffer> index_buffer_;
+    int draw_mode_ = 0;
+    int index_count_ = 0;
+
+    std::vector<glm::mat4> models_;
+    std::vector<glm::vec3> colors_;
+    std::vector<float> time_left_;
+  };
+
+  static void CreateShapeMesh(const Shape& shape, const std::vector<glm::vec3>& vertices, const std::vector<unsigned short>& indices, const int& draw_mode);
+  static void AddShape(const Shape& shape, const glm::mat4& model, const glm::vec3& color, const float& lifetime);
+  static void AgeShapes(ShapeBatch& batch, const float& delta_time);
+private:
+  static ShapeBatch shapes_[static_cast<int>(Shape::kShapeCount)];
+  static std::shared_ptr<Shader> shape_shader_;
+  static std::shared_ptr<StreamBuffer> shape_stream_;
 
-  static int current_line_batch_;
-  static std::vector<LineBatch> line_batches_;
+  //Kept on the CPU until the next flush, lines are redrawn every frame until then
+  static std::vector<LineVertex> line_vertices_;
+  static std::shared_ptr<VertexArray> line_vertex_array_;
+  static std::shared_ptr<StreamBuffer> line_stream_;
 
-  static Mesh square_;
   static std::shared_ptr<Shader> shader_;
 };
 
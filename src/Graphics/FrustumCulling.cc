@@ -0,0 +1,114 @@
+#include "FrustumCulling.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+//SSE2 is part of every x86-64 target, other architectures take the scalar path
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+void BoundingBoxes::Resize(const size_t& count) {
+  center_x_.resize(count);
+  center_y_.resize(count);
+  center_z_.resize(count);
+  extent_x_.resize(count);
+  extent_y_.resize(count);
+  extent_z_.resize(count);
+}
+
+void BoundingBoxes::Set(const size_t& index, const glm::vec3& center, const glm::vec3& extents) {
+  center_x_[index] = center.x;
+  center_y_[index] = center.y;
+  center_z_[index] = center.z;
+  extent_x_[index] = extents.x;
+  extent_y_[index] = extents.y;
+  extent_z_[index] = extents.z;
+}
+
+glm::vec3 BoundingBoxes::GetCenter(const size_t& index) const {
+  return glm::vec3(center_x_[index], center_y_[index], center_z_[index]);
+}
+
+Frustum ExtractFrustum(const glm::mat4& view_projection) {
+  //glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+  }
+
+  Frustum frustum;
+  frustum.planes_[0] = rows[3] + rows[0];
+  frustum.planes_[1] = rows[3] - rows[0];
+  frustum.planes_[2] = rows[3] + rows[1];
+  frustum.planes_[3] = rows[3] - rows[1];
+  frustum.planes_[4] = rows[3] + rows[2];
+  frustum.planes_[5] = rows[3] - rows[2];
+
+  for (glm::vec4& plane : frustum.planes_) {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.f) {
+      plane /= length;
+    }
+  }
+  return frustum;
+}
+
+void TransformBounds(const glm::mat4& transform, const glm::vec3& center, const glm::vec3& extents, glm::vec3& out_center, glm::vec3& out_extents) {
+  out_center = glm::vec3(transform * glm::vec4(center, 1.f));
+  for (int row = 0; row < 3; ++row) {
+    out_extents[row] = std::fabs(transform[0][row]) * extents.x + std::fabs(transform[1][row]) * extents.y + std::fabs(transform[2][row]) * extents.z;
+  }
+}
+
+//A box is outside once its corner furthest along a plane normal is behind that plane
+static bool IsBoxVisible(const Frustum& frustum, const BoundingBoxes& boxes, const size_t& index) {
+  for (const glm::vec4& plane : frustum.planes_) {
+    float distance = plane.x * boxes.center_x_[index] + plane.y * boxes.center_y_[index] + plane.z * boxes.center_z_[index] + plane.w
+      + std::fabs(plane.x) * boxes.extent_x_[index] + std::fabs(plane.y) * boxes.extent_y_[index] + std::fabs(plane.z) * boxes.extent_z_[index];
+    if (distance < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<unsigned char>& visible) {
+  const size_t count = boxes.Size();
+  visible.resize(count);
+
+  size_t i = 0;
+#ifdef FRUSTUM_CULLING_SSE
+  for (; i + 4 <= count; i += 4) {
+    __m128 center_x = _mm_loadu_ps(&boxes.center_x_[i]);
+    __m128 center_y = _mm_loadu_ps(&boxes.center_y_[i]);
+    __m128 center_z = _mm_loadu_ps(&boxes.center_z_[i]);
+    __m128 extent_x = _mm_loadu_ps(&boxes.extent_x_[i]);
+    __m128 extent_y = _mm_loadu_ps(&boxes.extent_y_[i]);
+    __m128 extent_z = _mm_loadu_ps(&boxes.extent_z_[i]);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (const glm::vec4& plane : frustum.planes_) {
+      __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), center_x), _mm_mul_ps(_mm_set1_ps(plane.y), center_y)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), center_z), _mm_set1_ps(plane.w)));
+      __m128 radius = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), extent_x), _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), extent_y)),
+        _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), extent_z));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+
+    int mask = _mm_movemask_ps(inside);
+    visible[i] = mask & 1;
+    visible[i + 1] = (mask >> 1) & 1;
+    visible[i + 2] = (mask >> 2) & 1;
+    visible[i + 3] = (mask >> 3) & 1;
+  }
+#endif
+
+  for (; i < count; ++i) {
+    visible[i] = IsBoxVisible(frustum, boxes, i) ? 1 : 0;
+  }
+}
\ No newline at end of file
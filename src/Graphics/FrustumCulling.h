@@ -0,0 +1,43 @@
+#ifndef FRUSTUM_CULLING_H_
+#define FRUSTUM_CULLING_H_
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+//Planes face inwards, a point is inside when dot(plane.xyz, point) + plane.w >= 0.
+//Order is left, right, bottom, top, near, far.
+struct Frustum {
+  glm::vec4 planes_[6];
+};
+
+//Axis aligned boxes with one array per component, so four boxes fill one
+//SSE register per component
+struct BoundingBoxes {
+  std::vector<float> center_x_;
+  std::vector<float> center_y_;
+  std::vector<float> center_z_;
+  std::vector<float> extent_x_;
+  std::vector<float> extent_y_;
+  std::vector<float> extent_z_;
+
+  void Resize(const size_t& count);
+  void Set(const size_t& index, const glm::vec3& center, const glm::vec3& extents);
+  glm::vec3 GetCenter(const size_t& index) const;
+  size_t Size() const { return center_x_.size(); }
+};
+
+//Gribb and Hartmann, works for any GL style projection
+Frustum ExtractFrustum(const glm::mat4& view_projection);
+
+//Smallest axis aligned box holding the transformed box, transform has to be affine
+void TransformBounds(const glm::mat4& transform, const glm::vec3& center, const glm::vec3& extents, glm::vec3& out_center, glm::vec3& out_extents);
+
+//visible[i] is 1 when box i is at least partly inside. Conservative, a box
+//near a corner of the frustum can pass while lying outside.
+void CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<unsigned char>& visible);
+
+#endif
\ No newline at end of file
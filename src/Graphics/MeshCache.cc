@@ -0,0 +1,399 @@
+#include "MeshCache.h"
+
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+constexpr unsigned int kMeshCacheMagic = 0x48534D52; //"RMSH"
+constexpr unsigned int kMeshCacheVersion = 6;
+//Sanity limits so a corrupt count can't trigger a huge allocation
+constexpr unsigned int kMaxCachedMeshes = 65536;
+constexpr unsigned int kMaxCachedPrimitives = 65536;
+constexpr unsigned int kMaxCachedLods = 32;
+constexpr unsigned int kMaxCachedMips = 32;
+constexpr int kMaxCachedTextureSize = 16384;
+
+unsigned long long HashBytes(const unsigned char* data, const size_t& size) {
+  unsigned long long hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static bool ReadFile(const std::string& filename, std::vector<unsigned char>& contents) {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+
+  std::streamsize size = file.tellg();
+  file.seekg(0, std::ios::beg);
+
+  contents.resize(static_cast<size_t>(size));
+  return static_cast<bool>(file.read(reinterpret_cast<char*>(contents.data()), size));
+}
+
+class CacheWriter {
+public:
+  template<typename T>
+  void Write(const T& value) {
+    WriteBytes(&value, sizeof(T));
+  }
+
+  void WriteBytes(const void* data, const size_t& size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    bytes_.insert(bytes_.end(), bytes, bytes + size);
+  }
+
+  void WriteBlob(const ByteSpan& blob) {
+    Write<unsigned long long>(blob.size_);
+    WriteBytes(blob.data_, blob.size_);
+  }
+
+  void WriteString(const std::string& string) {
+    Write<unsigned int>(static_cast<unsigned int>(string.size()));
+    WriteBytes(string.data(), string.size());
+  }
+
+  const std::vector<unsigned char>& GetBytes() const { return bytes_; }
+private:
+  std::vector<unsigned char> bytes_;
+};
+
+//Every read is bounds checked, a truncated or corrupt cache just fails the load
+class CacheReader {
+public:
+  CacheReader(const std::vector<unsigned char>& bytes) : bytes_(bytes) {}
+
+  template<typename T>
+  bool Read(T& value) {
+    return ReadBytes(&value, sizeof(T));
+  }
+
+  bool ReadBytes(void* data, const size_t& size) {
+    if (size > bytes_.size() - offset_) {
+      return false;
+    }
+    std::memcpy(data, bytes_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  //Hands out a view into the cache contents instead of a copy
+  bool ReadBlob(ByteSpan& blob) {
+    unsigned long long size = 0;
+    if (!Read(size) || size > bytes_.size() - offset_) {
+      return false;
+    }
+    blob = ByteSpan { bytes_.data() + offset_, static_cast<size_t>(size) };
+    offset_ += size;
+    return true;
+  }
+
+  bool ReadString(std::string& string) {
+    unsigned int size = 0;
+    if (!Read(size) || size > bytes_.size() - offset_) {
+      return false;
+    }
+    string.assign(reinterpret_cast<const char*>(bytes_.data() + offset_), size);
+    offset_ += size;
+    return true;
+  }
+private:
+  const std::vector<unsigned char>& bytes_;
+  size_t offset_ = 0;
+};
+
+unsigned long long HashFileContents(const std::string& filename) {
+  std::vector<unsigned char> contents;
+  if (!ReadFile(filename, contents)) {
+    return 0;
+  }
+  return HashBytes(contents.data(), contents.size());
+}
+
+//Anything that changes the cooked output has to show up here
+static unsigned long long GetOptionsKey(const ModelLoadOptions& options) {
+  CacheWriter key;
+  key.Write<unsigned char>(options.vertex_packing_.quantize_positions_ ? 1 : 0);
+  key.Write<unsigned char>(options.mesh_optimize_.enabled_ ? 1 : 0);
+  key.Write<unsigned char>(options.mesh_optimize_.optimize_overdraw_ ? 1 : 0);
+  key.Write(options.mesh_optimize_.overdraw_threshold_);
+  key.Write(options.lod_.max_lods_);
+  key.Write(options.lod_.reduction_);
+  key.Write(options.lod_.max_error_);
+  key.Write<unsigned char>(options.texture_cook_.enabled_ ? 1 : 0);
+  key.Write<unsigned char>(options.texture_cook_.srgb_ ? 1 : 0);
+  return HashBytes(key.GetBytes().data(), key.GetBytes().size());
+}
+
+static void WriteMaterial(CacheWriter& writer, const MaterialData& material) {
+  writer.Write<unsigned char>(material.use_texture_ ? 1 : 0);
+  writer.Write(material.wrap_s_);
+  writer.Write(material.wrap_t_);
+  writer.Write(material.component_);
+  writer.Write(material.bits_);
+  writer.Write(material.texture_width_);
+  writer.Write(material.texture_height_);
+  writer.Write(material.base_color_);
+  writer.WriteString(material.name_);
+  writer.WriteBlob(material.texture_data_);
+  writer.Write(static_cast<unsigned int>(material.texture_format_));
+  writer.Write<unsigned int>(static_cast<unsigned int>(material.texture_mips_.size()));
+  for (const ByteSpan& mip : material.texture_mips_) {
+    writer.WriteBlob(mip);
+  }
+}
+
+static bool ReadMips(CacheReader& reader, MaterialData& material) {
+  unsigned int format = 0;
+  unsigned int mip_count = 0;
+  if (!reader.Read(format) || format > static_cast<unsigned int>(TextureFormat::kTextureFormatBC5) || !reader.Read(mip_count) || mip_count > kMaxCachedMips) {
+    return false;
+  }
+
+  material.texture_format_ = static_cast<TextureFormat>(format);
+  material.texture_mips_.resize(mip_count);
+  for (size_t level = 0; level < mip_count; ++level) {
+    ByteSpan& mip = material.texture_mips_[level];
+    const int width = std::max(material.texture_width_ >> level, 1);
+    const int height = std::max(material.texture_height_ >> level, 1);
+    if (!reader.ReadBlob(mip) || mip.size_ != GetMipSize(material.texture_format_, width, height)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool IsValidTextureSize(const int& width, const int& height) {
+  return width > 0 && height > 0 && width <= kMaxCachedTextureSize && height <= kMaxCachedTextureSize;
+}
+
+//Raw pixels are uploaded straight from the cache, so they have to cover the whole image
+static bool ValidateTexture(const MaterialData& material) {
+  if (!material.texture_mips_.empty() && !IsValidTextureSize(material.texture_width_, material.texture_height_)) {
+    return false;
+  }
+
+  if (material.texture_data_.Empty()) {
+    return true;
+  }
+
+  if (!IsValidTextureSize(material.texture_width_, material.texture_height_) || material.component_ < 1 || material.component_ > 4 || (material.bits_ != 8 && material.bits_ != 16)) {
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(material.texture_width_) * material.texture_height_ * material.component_ * material.bits_ / 8;
+  return material.texture_data_.size_ == size;
+}
+
+static bool ReadMaterial(CacheReader& reader, MaterialData& material) {
+  unsigned char use_texture = 0;
+  bool result = reader.Read(use_texture) 
+    && reader.Read(material.wrap_s_)
+    && reader.Read(material.wrap_t_)
+    && reader.Read(material.component_)
+    && reader.Read(material.bits_)
+    && reader.Read(material.texture_width_)
+    && reader.Read(material.texture_height_)
+    && reader.Read(material.base_color_)
+    && reader.ReadString(material.name_)
+    && reader.ReadBlob(material.texture_data_)
+    && ReadMips(reader, material)
+    && ValidateTexture(material);
+
+  material.use_texture_ = use_texture != 0;
+  return result;
+}
+
+static bool ReadLods(CacheReader& reader, std::vector<MeshLod>& lods) {
+  unsigned int lod_count = 0;
+  if (!reader.Read(lod_count) || lod_count > kMaxCachedLods) {
+    return false;
+  }
+
+  lods.resize(lod_count);
+  for (MeshLod& lod : lods) {
+    if (!reader.Read(lod)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t GetIndexSize(const int& component_type) {
+  switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      return 1;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      return 2;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+//The reader only bounds checks the blobs themselves. The counts, ranges and
+//indices that drive draws and CPU reads into them are checked here.
+static bool ValidatePrimitive(const PrimitiveData& primitive) {
+  const size_t index_size = GetIndexSize(primitive.component_type_);
+  if (index_size == 0 || primitive.indices_count_ < 0 || primitive.vertex_count_ < 0) {
+    return false;
+  }
+
+  const size_t index_count = static_cast<size_t>(primitive.indices_count_);
+  if (index_count > primitive.indices_.size_ / index_size) {
+    return false;
+  }
+
+  if (primitive.layout_.stride_ == 0 || static_cast<size_t>(primitive.vertex_count_) > primitive.vertices_.size_ / primitive.layout_.stride_) {
+    return false;
+  }
+
+  for (const MeshLod& lod : primitive.lods_) {
+    if (static_cast<size_t>(lod.index_offset_) + lod.index_count_ > index_count) {
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < index_count; ++i) {
+    unsigned int index = 0;
+    std::memcpy(&index, primitive.indices_.data_ + i * index_size, index_size);
+    if (index >= static_cast<unsigned int>(primitive.vertex_count_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool WriteMeshCache(const std::string& cache_path, const unsigned long long& source_hash, const ModelLoadOptions& options, const std::vector<Mesh>& meshes) {
+  CacheWriter writer;
+  writer.Write(kMeshCacheMagic);
+  writer.Write(kMeshCacheVersion);
+  writer.Write(source_hash);
+  writer.Write(GetOptionsKey(options));
+  writer.Write<unsigned int>(static_cast<unsigned int>(meshes.size()));
+
+  for (const Mesh& mesh : meshes) {
+    writer.Write(mesh.local_transform_.position_);
+    writer.Write(mesh.local_transform_.rotation_);
+    writer.Write(mesh.local_transform_.scale_);
+    writer.Write<unsigned int>(static_cast<unsigned int>(mesh.primitives_.size()));
+
+    for (const PrimitiveData& primitive : mesh.primitives_) {
+      writer.Write(primitive.indices_count_);
+      writer.Write(primitive.draw_mode_);
+      writer.Write(primitive.component_type_);
+      writer.Write(primitive.vertex_count_);
+      writer.Write(primitive.layout_);
+      writer.Write(primitive.position_scale_);
+      writer.Write(primitive.position_offset_);
+      writer.WriteBlob(primitive.vertices_);
+      writer.WriteBlob(primitive.indices_);
+      writer.Write<unsigned int>(static_cast<unsigned int>(primitive.lods_.size()));
+      for (const MeshLod& lod : primitive.lods_) {
+        writer.Write(lod);
+      }
+      writer.Write(primitive.bounds_center_);
+      writer.Write(primitive.bounds_extents_);
+      writer.Write(primitive.bounds_radius_);
+      WriteMaterial(writer, primitive.material_);
+    }
+  }
+
+  //Write to a temporary first so a crash mid-write never leaves a half cache behind
+  std::string temporary_path = cache_path + ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(writer.GetBytes().data()), writer.GetBytes().size())) {
+      PLOG_WARNING << "Unable to write mesh cache: " << cache_path;
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_path, cache_path, error);
+  PLOG_WARNING_IF(error) << "Unable to write mesh cache: " << cache_path << " " << error.message();
+
+  PLOGD << "Wrote mesh cache: " << cache_path << " (" << writer.GetBytes().size() << " bytes)";
+  return !error;
+}
+
+bool ReadMeshCache(const std::string& cache_path, const unsigned long long& source_hash, const ModelLoadOptions& options, std::vector<unsigned char>& contents, std::vector<Mesh>& meshes) {
+  if (!ReadFile(cache_path, contents)) {
+    return false;
+  }
+
+  CacheReader reader(contents);
+
+  unsigned int magic = 0;
+  unsigned int version = 0;
+  unsigned long long hash = 0;
+  unsigned long long options_key = 0;
+  unsigned int mesh_count = 0;
+
+  if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(hash) || !reader.Read(options_key) || !reader.Read(mesh_count)) {
+    return false;
+  }
+
+  if (magic != kMeshCacheMagic || version != kMeshCacheVersion) {
+    PLOGD << "Mesh cache format changed: " << cache_path;
+    return false;
+  }
+
+  if (hash != source_hash || options_key != GetOptionsKey(options)) {
+    PLOGD << "Mesh cache out of date: " << cache_path;
+    return false;
+  }
+
+  if (mesh_count > kMaxCachedMeshes) {
+    PLOG_WARNING << "Corrupt mesh cache: " << cache_path;
+    return false;
+  }
+
+  std::vector<Mesh> cached_meshes(mesh_count);
+  for (Mesh& mesh : cached_meshes) {
+    unsigned int primitive_count = 0;
+    if (!reader.Read(mesh.local_transform_.position_) 
+      || !reader.Read(mesh.local_transform_.rotation_) 
+      || !reader.Read(mesh.local_transform_.scale_)
+      || !reader.Read(primitive_count)
+      || primitive_count > kMaxCachedPrimitives) {
+      PLOG_WARNING << "Corrupt mesh cache: " << cache_path;
+      return false;
+    }
+
+    mesh.primitives_.resize(primitive_count);
+    for (PrimitiveData& primitive : mesh.primitives_) {
+      bool result = reader.Read(primitive.indices_count_)
+        && reader.Read(primitive.draw_mode_)
+        && reader.Read(primitive.component_type_)
+        && reader.Read(primitive.vertex_count_)
+        && reader.Read(primitive.layout_)
+        && reader.Read(primitive.position_scale_)
+        && reader.Read(primitive.position_offset_)
+        && reader.ReadBlob(primitive.vertices_)
+        && reader.ReadBlob(primitive.indices_)
+        && ReadLods(reader, primitive.lods_)
+        && reader.Read(primitive.bounds_center_)
+        && reader.Read(primitive.bounds_extents_)
+        && reader.Read(primitive.bounds_radius_)
+        && ReadMaterial(reader, primitive.material_)
+        && ValidatePrimitive(primitive);
+
+      if (!result) {
+        PLOG_WARNING << "Corrupt mesh cache: " << cache_path;
+        return false;
+      }
+    }
+  }
+
+  meshes = std::move(cached_meshes);
+  return true;
+}
\ No newline at end of file
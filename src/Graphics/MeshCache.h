@@ -0,0 +1,28 @@
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "ModelLoader.h"
+
+//Cooked binary copy of a processed glTF, written next to the source as
+//<source>.rmesh the first time a model is loaded. Stores everything Model
+//produces (interleaved vertices, indices, decoded or block compressed material
+//textures, node transforms) so later loads skip JSON, base64, image decoding,
+//texture compression and vertex packing entirely.
+//The cache is keyed on a hash of the source file and is rewritten whenever
+//the source changes. Caches cooked with different load options are rejected.
+//Only the .gltf itself is hashed, external .bin/.png files are not tracked.
+
+constexpr const char* kMeshCacheExtension = ".rmesh";
+
+//FNV-1a
+unsigned long long HashBytes(const unsigned char* data, const size_t& size);
+unsigned long long HashFileContents(const std::string& filename);
+
+//Primitive and texture spans in meshes point into contents, which the caller keeps alive
+bool ReadMeshCache(const std::string& cache_path, const unsigned long long& source_hash, const ModelLoadOptions& options, std::vector<unsigned char>& contents, std::vector<Mesh>& meshes);
+bool WriteMeshCache(const std::string& cache_path, const unsigned long long& source_hash, const ModelLoadOptions& options, const std::vector<Mesh>& meshes);
+
+#endif
\ No newline at end of file
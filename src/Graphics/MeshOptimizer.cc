@@ -0,0 +1,416 @@
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+constexpr unsigned int kUnusedIndex = ~0u;
+
+//Forsyth's scoring constants, tuned for a 32 entry LRU model of the cache
+constexpr unsigned int kForsythCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.f;
+constexpr float kValenceBoostPower = 0.5f;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, const size_t& vertex_count, const unsigned int& cache_size) {
+  VertexCacheStats stats;
+  if (indices.empty()) {
+    return stats;
+  }
+
+  //A vertex is cached while fewer than cache_size misses happened since it was loaded
+  std::vector<unsigned int> cache_time(vertex_count, 0);
+  std::vector<bool> referenced(vertex_count, false);
+  unsigned int timestamp = cache_size + 1;
+  size_t unique_vertices = 0;
+
+  for (const unsigned int& index : indices) {
+    assert(index < vertex_count && "Index out of range!");
+    if (timestamp - cache_time[index] > cache_size) {
+      cache_time[index] = timestamp++;
+      ++stats.vertices_transformed_;
+    }
+    if (!referenced[index]) {
+      referenced[index] = true;
+      ++unique_vertices;
+    }
+  }
+
+  stats.acmr_ = static_cast<float>(stats.vertices_transformed_) / static_cast<float>(indices.size() / 3);
+  stats.atvr_ = static_cast<float>(stats.vertices_transformed_) / static_cast<float>(unique_vertices);
+  return stats;
+}
+
+static size_t HashVertex(const unsigned char* bytes, const size_t& size) {
+  //FNV-1a
+  size_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+size_t GenerateVertexRemap(std::vector<unsigned int>& remap, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats) {
+  remap.assign(vertex_count, kUnusedIndex);
+
+  size_t table_size = 16;
+  while (table_size < vertex_count * 2) {
+    table_size *= 2;
+  }
+  std::vector<unsigned int> table(table_size, kUnusedIndex);
+
+  const size_t vertex_bytes = vertex_floats * sizeof(float);
+  const unsigned char* data = reinterpret_cast<const unsigned char*>(vertices);
+  size_t unique = 0;
+
+  for (size_t i = 0; i < vertex_count; ++i) {
+    const unsigned char* vertex = data + i * vertex_bytes;
+    size_t bucket = HashVertex(vertex, vertex_bytes) & (table_size - 1);
+
+    //Linear probing, the table is at most half full
+    while (table[bucket] != kUnusedIndex && std::memcmp(data + table[bucket] * vertex_bytes, vertex, vertex_bytes) != 0) {
+      bucket = (bucket + 1) & (table_size - 1);
+    }
+
+    if (table[bucket] == kUnusedIndex) {
+      table[bucket] = static_cast<unsigned int>(i);
+      remap[i] = static_cast<unsigned int>(unique++);
+    } else {
+      remap[i] = remap[table[bucket]];
+    }
+  }
+
+  return unique;
+}
+
+void RemapIndices(std::vector<unsigned int>& indices, const std::vector<unsigned int>& remap) {
+  for (unsigned int& index : indices) {
+    assert(remap[index] != kUnusedIndex && "Remapped an unreferenced vertex!");
+    index = remap[index];
+  }
+}
+
+void RemapVertices(std::vector<float>& vertices, const std::vector<unsigned int>& remap, const size_t& new_vertex_count, const size_t& vertex_floats) {
+  std::vector<float> remapped(new_vertex_count * vertex_floats);
+
+  for (size_t i = 0; i < remap.size(); ++i) {
+    if (remap[i] != kUnusedIndex) {
+      std::memcpy(&remapped[remap[i] * vertex_floats], &vertices[i * vertex_floats], vertex_floats * sizeof(float));
+    }
+  }
+
+  vertices.swap(remapped);
+}
+
+static float VertexScore(const int& cache_position, const unsigned int& live_triangles) {
+  //No triangles left to draw, never pick this vertex again
+  if (live_triangles == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (cache_position >= 0) {
+    //The last triangle's vertices get a fixed score so its neighbours are not
+    //favoured over triangles further back in the cache
+    if (cache_position < 3) {
+      score = kLastTriangleScore;
+    } else {
+      float scaler = 1.f / static_cast<float>(kForsythCacheSize - 3);
+      score = std::pow(1.f - static_cast<float>(cache_position - 3) * scaler, kCacheDecayPower);
+    }
+  }
+
+  //Boost vertices with few triangles left so they get finished off
+  score += kValenceBoostScale * std::pow(static_cast<float>(live_triangles), -kValenceBoostPower);
+  return score;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, const size_t& vertex_count) {
+  const size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  //Triangles using each vertex, the live ones are kept at the front of each range
+  std::vector<unsigned int> live_triangles(vertex_count, 0);
+  for (const unsigned int& index : indices) {
+    ++live_triangles[index];
+  }
+
+  std::vector<unsigned int> adjacency_offsets(vertex_count + 1, 0);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    adjacency_offsets[i + 1] = adjacency_offsets[i] + live_triangles[i];
+  }
+
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    vertex_score[i] = VertexScore(-1, live_triangles[i]);
+  }
+
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<bool> emitted(triangle_count, false);
+
+  size_t best_triangle = 0;
+  for (size_t i = 0; i < triangle_count; ++i) {
+    triangle_score[i] = vertex_score[indices[i * 3]] + vertex_score[indices[i * 3 + 1]] + vertex_score[indices[i * 3 + 2]];
+    if (triangle_score[i] > triangle_score[best_triangle]) {
+      best_triangle = i;
+    }
+  }
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+
+  unsigned int cache[kForsythCacheSize + 3];
+  unsigned int new_cache[kForsythCacheSize + 3];
+  size_t cache_count = 0;
+  size_t input_cursor = 0;
+  bool has_best = true;
+
+  while (result.size() < indices.size()) {
+    //Nothing in the cache has triangles left, restart from the next unused one
+    if (!has_best) {
+      while (emitted[input_cursor]) {
+        ++input_cursor;
+      }
+      best_triangle = input_cursor;
+    }
+
+    emitted[best_triangle] = true;
+    const unsigned int* triangle = &indices[best_triangle * 3];
+
+    size_t new_cache_count = 0;
+    for (size_t k = 0; k < 3; ++k) {
+      unsigned int vertex = triangle[k];
+      result.push_back(vertex);
+
+      //Move the triangle past the end of the vertex's live range
+      unsigned int* begin = &adjacency[adjacency_offsets[vertex]];
+      unsigned int* end = begin + live_triangles[vertex];
+      unsigned int* found = std::find(begin, end, static_cast<unsigned int>(best_triangle));
+      assert(found != end && "Triangle missing from adjacency!");
+      std::swap(*found, *(end - 1));
+      --live_triangles[vertex];
+
+      if (std::find(new_cache, new_cache + new_cache_count, vertex) == new_cache + new_cache_count) {
+        new_cache[new_cache_count++] = vertex;
+      }
+    }
+
+    const size_t triangle_vertices = new_cache_count;
+    for (size_t i = 0; i < cache_count; ++i) {
+      if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3) {
+        new_cache[new_cache_count++] = cache[i];
+      }
+    }
+    assert(triangle_vertices <= 3 && new_cache_count <= kForsythCacheSize + 3);
+
+    //Everything past kForsythCacheSize was just evicted
+    for (size_t i = 0; i < new_cache_count; ++i) {
+      unsigned int vertex = new_cache[i];
+      cache_position[vertex] = i < kForsythCacheSize ? static_cast<int>(i) : -1;
+      vertex_score[vertex] = VertexScore(cache_position[vertex], live_triangles[vertex]);
+    }
+
+    //Only triangles touching the cache changed score, pick the next best among them
+    has_best = false;
+    float best_score = -1.f;
+    for (size_t i = 0; i < new_cache_count; ++i) {
+      unsigned int vertex = new_cache[i];
+      const unsigned int* begin = &adjacency[adjacency_offsets[vertex]];
+      for (const unsigned int* t = begin; t != begin + live_triangles[vertex]; ++t) {
+        const unsigned int* other = &indices[*t * 3];
+        triangle_score[*t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+        if (triangle_score[*t] > best_score) {
+          best_score = triangle_score[*t];
+          best_triangle = *t;
+          has_best = true;
+        }
+      }
+    }
+
+    cache_count = std::min<size_t>(new_cache_count, kForsythCacheSize);
+    std::copy(new_cache, new_cache + cache_count, cache);
+  }
+
+  indices.swap(result);
+}
+
+struct TriangleCluster {
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  float sort_key_ = 0.f;
+};
+
+static glm::vec3 GetPosition(const float* vertices, const size_t& vertex_floats, const unsigned int& index) {
+  const float* position = vertices + index * vertex_floats;
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats, const float& threshold) {
+  const size_t triangle_count = indices.size() / 3;
+  if (triangle_count < 2) {
+    return;
+  }
+
+  //Hard boundaries are triangles that miss the cache on every vertex, the
+  //cache order already restarted there so splitting is free
+  std::vector<size_t> hard_boundaries;
+  std::vector<unsigned int> triangle_misses(triangle_count);
+  {
+    std::vector<unsigned int> cache_time(vertex_count, 0);
+    unsigned int timestamp = kVertexCacheSize + 1;
+    for (size_t i = 0; i < triangle_count; ++i) {
+      unsigned int misses = 0;
+      for (size_t k = 0; k < 3; ++k) {
+        unsigned int index = indices[i * 3 + k];
+        if (timestamp - cache_time[index] > kVertexCacheSize) {
+          cache_time[index] = timestamp++;
+          ++misses;
+        }
+      }
+      triangle_misses[i] = misses;
+      if (i == 0 || misses == 3) {
+        hard_boundaries.push_back(i);
+      }
+    }
+    hard_boundaries.push_back(triangle_count);
+  }
+
+  //Soft boundaries split a hard cluster as soon as a cold cache has caught up
+  //to within threshold of the cluster's ACMR
+  std::vector<TriangleCluster> clusters;
+  {
+    std::vector<unsigned int> cache_time(vertex_count, 0);
+    unsigned int timestamp = kVertexCacheSize + 1;
+
+    for (size_t c = 0; c + 1 < hard_boundaries.size(); ++c) {
+      size_t begin = hard_boundaries[c];
+      size_t end = hard_boundaries[c + 1];
+
+      unsigned int hard_misses = 0;
+      for (size_t i = begin; i < end; ++i) {
+        hard_misses += triangle_misses[i];
+      }
+      float target_acmr = static_cast<float>(hard_misses) / static_cast<float>(end - begin) * threshold;
+
+      size_t cluster_begin = begin;
+      unsigned int cluster_misses = 0;
+      //Flush the simulated cache
+      timestamp += kVertexCacheSize + 1;
+
+      for (size_t i = begin; i < end; ++i) {
+        for (size_t k = 0; k < 3; ++k) {
+          unsigned int index = indices[i * 3 + k];
+          if (timestamp - cache_time[index] > kVertexCacheSize) {
+            cache_time[index] = timestamp++;
+            ++cluster_misses;
+          }
+        }
+
+        float cluster_acmr = static_cast<float>(cluster_misses) / static_cast<float>(i + 1 - cluster_begin);
+        if (cluster_acmr <= target_acmr && i + 1 < end) {
+          clusters.push_back(TriangleCluster { cluster_begin, i + 1 });
+          cluster_begin = i + 1;
+          cluster_misses = 0;
+          timestamp += kVertexCacheSize + 1;
+        }
+      }
+      clusters.push_back(TriangleCluster { cluster_begin, end });
+    }
+  }
+
+  //Area weighted centroid of the whole mesh
+  glm::vec3 mesh_centroid(0.f);
+  float mesh_area = 0.f;
+  for (size_t i = 0; i < triangle_count; ++i) {
+    glm::vec3 a = GetPosition(vertices, vertex_floats, indices[i * 3]);
+    glm::vec3 b = GetPosition(vertices, vertex_floats, indices[i * 3 + 1]);
+    glm::vec3 c = GetPosition(vertices, vertex_floats, indices[i * 3 + 2]);
+    float area = glm::length(glm::cross(b - a, c - a));
+    mesh_centroid += (a + b + c) * (area / 3.f);
+    mesh_area += area;
+  }
+  mesh_centroid = mesh_area > 0.f ? mesh_centroid / mesh_area : glm::vec3(0.f);
+
+  //Clusters far out along their own normal are drawn first
+  for (TriangleCluster& cluster : clusters) {
+    glm::vec3 centroid(0.f);
+    glm::vec3 normal(0.f);
+    float area = 0.f;
+    for (size_t i = cluster.begin_; i < cluster.end_; ++i) {
+      glm::vec3 a = GetPosition(vertices, vertex_floats, indices[i * 3]);
+      glm::vec3 b = GetPosition(vertices, vertex_floats, indices[i * 3 + 1]);
+      glm::vec3 c = GetPosition(vertices, vertex_floats, indices[i * 3 + 2]);
+      glm::vec3 weighted_normal = glm::cross(b - a, c - a);
+      float triangle_area = glm::length(weighted_normal);
+      centroid += (a + b + c) * (triangle_area / 3.f);
+      normal += weighted_normal;
+      area += triangle_area;
+    }
+
+    float normal_length = glm::length(normal);
+    if (area > 0.f && normal_length > 0.f) {
+      cluster.sort_key_ = glm::dot(centroid / area - mesh_centroid, normal / normal_length);
+    }
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b) {
+    return a.sort_key_ > b.sort_key_;
+  });
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+  for (const TriangleCluster& cluster : clusters) {
+    result.insert(result.end(), indices.begin() + cluster.begin_ * 3, indices.begin() + cluster.end_ * 3);
+  }
+
+  indices.swap(result);
+}
+
+size_t GenerateVertexFetchRemap(std::vector<unsigned int>& remap, const std::vector<unsigned int>& indices, const size_t& vertex_count) {
+  remap.assign(vertex_count, kUnusedIndex);
+
+  unsigned int next_vertex = 0;
+  for (const unsigned int& index : indices) {
+    if (remap[index] == kUnusedIndex) {
+      remap[index] = next_vertex++;
+    }
+  }
+
+  return next_vertex;
+}
+
+void OptimizeMesh(std::vector<float>& vertices, const size_t& vertex_floats, std::vector<unsigned int>& indices, const MeshOptimizeOptions& options) {
+  assert(vertex_floats >= 3 && "Vertices need at least a position!");
+  assert(indices.size() % 3 == 0 && "Expected a triangle list!");
+
+  size_t vertex_count = vertices.size() / vertex_floats;
+  std::vector<unsigned int> remap;
+
+  vertex_count = GenerateVertexRemap(remap, vertices.data(), vertex_count, vertex_floats);
+  RemapIndices(indices, remap);
+  RemapVertices(vertices, remap, vertex_count, vertex_floats);
+
+  OptimizeVertexCache(indices, vertex_count);
+
+  if (options.optimize_overdraw_) {
+    OptimizeOverdraw(indices, vertices.data(), vertex_count, vertex_floats, options.overdraw_threshold_);
+  }
+
+  vertex_count = GenerateVertexFetchRemap(remap, indices, vertex_count);
+  RemapIndices(indices, remap);
+  RemapVertices(vertices, remap, vertex_count, vertex_floats);
+}
\ No newline at end of file
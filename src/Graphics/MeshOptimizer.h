@@ -0,0 +1,50 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <cstddef>
+#include <vector>
+
+//Import time index and vertex reordering. Every pass works on triangle lists
+//with 32 bit indices and plain float vertices, before they are packed.
+
+constexpr unsigned int kVertexCacheSize = 16;
+
+struct MeshOptimizeOptions {
+  bool enabled_ = true;
+  //Reorders clusters of triangles front to back after the cache pass
+  bool optimize_overdraw_ = false;
+  //How much ACMR the overdraw pass is allowed to give up, 1.05 = 5%
+  float overdraw_threshold_ = 1.05f;
+};
+
+//ACMR: vertex shader invocations per triangle. ATVR: invocations per unique vertex.
+struct VertexCacheStats {
+  unsigned int vertices_transformed_ = 0;
+  float acmr_ = 0.f;
+  float atvr_ = 0.f;
+};
+
+//Simulates a FIFO post-transform cache of cache_size entries
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, const size_t& vertex_count, const unsigned int& cache_size = kVertexCacheSize);
+
+//remap[old] = new for bitwise identical vertices, returns the unique vertex count
+size_t GenerateVertexRemap(std::vector<unsigned int>& remap, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats);
+void RemapIndices(std::vector<unsigned int>& indices, const std::vector<unsigned int>& remap);
+void RemapVertices(std::vector<float>& vertices, const std::vector<unsigned int>& remap, const size_t& new_vertex_count, const size_t& vertex_floats);
+
+//Forsyth's linear speed vertex cache optimization
+void OptimizeVertexCache(std::vector<unsigned int>& indices, const size_t& vertex_count);
+
+//Splits the cache optimized order into clusters and sorts them so outward
+//facing clusters, the likely occluders, are drawn first. Positions are the
+//first three floats of every vertex.
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats, const float& threshold);
+
+//Orders vertices by first use, returns the number of referenced vertices
+size_t GenerateVertexFetchRemap(std::vector<unsigned int>& remap, const std::vector<unsigned int>& indices, const size_t& vertex_count);
+
+//Runs every pass in order: deduplication, vertex cache, overdraw, vertex fetch.
+//vertices shrinks to the unique referenced vertices.
+void OptimizeMesh(std::vector<float>& vertices, const size_t& vertex_floats, std::vector<unsigned int>& indices, const MeshOptimizeOptions& options);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "MeshSimplifier.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+//Symmetric 4x4 plane quadric, weighted by triangle area
+struct Quadric {
+  double a00_ = 0, a01_ = 0, a02_ = 0, a03_ = 0;
+  double a11_ = 0, a12_ = 0, a13_ = 0;
+  double a22_ = 0, a23_ = 0;
+  double a33_ = 0;
+  double weight_ = 0;
+
+  void AddPlane(const glm::vec3& normal, const float& distance, const float& weight) {
+    double x = normal.x, y = normal.y, z = normal.z, d = distance;
+    a00_ += weight * x * x; a01_ += weight * x * y; a02_ += weight * x * z; a03_ += weight * x * d;
+    a11_ += weight * y * y; a12_ += weight * y * z; a13_ += weight * y * d;
+    a22_ += weight * z * z; a23_ += weight * z * d;
+    a33_ += weight * d * d;
+    weight_ += weight;
+  }
+
+  void Add(const Quadric& other) {
+    a00_ += other.a00_; a01_ += other.a01_; a02_ += other.a02_; a03_ += other.a03_;
+    a11_ += other.a11_; a12_ += other.a12_; a13_ += other.a13_;
+    a22_ += other.a22_; a23_ += other.a23_;
+    a33_ += other.a33_;
+    weight_ += other.weight_;
+  }
+
+  //Area weighted mean squared distance of point to the accumulated planes
+  double Evaluate(const glm::vec3& point) const {
+    double x = point.x, y = point.y, z = point.z;
+    double error = a00_ * x * x + 2.0 * a01_ * x * y + 2.0 * a02_ * x * z + 2.0 * a03_ * x
+      + a11_ * y * y + 2.0 * a12_ * y * z + 2.0 * a13_ * y
+      + a22_ * z * z + 2.0 * a23_ * z
+      + a33_;
+    return weight_ > 0.0 ? std::max(error, 0.0) / weight_ : 0.0;
+  }
+};
+
+struct EdgeCollapse {
+  unsigned int from_ = 0;
+  unsigned int to_ = 0;
+  double error_ = 0.0;
+};
+
+static glm::vec3 GetPosition(const float* vertices, const size_t& vertex_floats, const unsigned int& index) {
+  const float* position = vertices + index * vertex_floats;
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+static unsigned long long EdgeKey(unsigned int a, unsigned int b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  return (static_cast<unsigned long long>(a) << 32) | b;
+}
+
+//Seams share a position with another vertex, borders have an edge used by
+//exactly one triangle and non-manifold vertices by more than two
+static std::vector<bool> FindLockedVertices(const std::vector<unsigned int>& indices, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats) {
+  std::vector<bool> locked(vertex_count, false);
+
+  std::vector<float> positions(vertex_count * 3);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    const float* position = vertices + i * vertex_floats;
+    positions[i * 3] = position[0];
+    positions[i * 3 + 1] = position[1];
+    positions[i * 3 + 2] = position[2];
+  }
+
+  std::vector<unsigned int> position_remap;
+  size_t position_count = GenerateVertexRemap(position_remap, positions.data(), vertex_count, 3);
+  std::vector<unsigned int> position_users(position_count, 0);
+  for (const unsigned int& position : position_remap) {
+    ++position_users[position];
+  }
+  for (size_t i = 0; i < vertex_count; ++i) {
+    locked[i] = position_users[position_remap[i]] > 1;
+  }
+
+  std::unordered_map<unsigned long long, unsigned int> edge_users;
+  edge_users.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t k = 0; k < 3; ++k) {
+      ++edge_users[EdgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+    }
+  }
+  for (const auto& [key, users] : edge_users) {
+    if (users != 2) {
+      locked[static_cast<unsigned int>(key >> 32)] = true;
+      locked[static_cast<unsigned int>(key & 0xFFFFFFFFu)] = true;
+    }
+  }
+
+  return locked;
+}
+
+//Rejects collapses that would turn any remaining triangle around from over
+static bool CollapseFlipsTriangle(const EdgeCollapse& collapse, const std::vector<unsigned int>& indices, const unsigned int* triangles, const unsigned int& triangle_count,
+    const float* vertices, const size_t& vertex_floats) {
+  glm::vec3 target = GetPosition(vertices, vertex_floats, collapse.to_);
+
+  for (unsigned int t = 0; t < triangle_count; ++t) {
+    const unsigned int* triangle = &indices[triangles[t] * 3];
+    if (triangle[0] == collapse.to_ || triangle[1] == collapse.to_ || triangle[2] == collapse.to_) {
+      continue;
+    }
+
+    glm::vec3 before[3], after[3];
+    for (size_t k = 0; k < 3; ++k) {
+      before[k] = GetPosition(vertices, vertex_floats, triangle[k]);
+      after[k] = triangle[k] == collapse.from_ ? target : before[k];
+    }
+
+    glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+    glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::dot(normal_before, normal_after) <= 0.f) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::vector<unsigned int> SimplifyMesh(const std::vector<unsigned int>& indices, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats,
+    const size_t& target_index_count, const float& target_error, float& result_error) {
+  assert(indices.size() % 3 == 0 && "Expected a triangle list!");
+
+  std::vector<unsigned int> result = indices;
+  result_error = 0.f;
+
+  std::vector<bool> locked = FindLockedVertices(indices, vertices, vertex_count, vertex_floats);
+
+  std::vector<Quadric> quadrics(vertex_count);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    glm::vec3 a = GetPosition(vertices, vertex_floats, indices[i]);
+    glm::vec3 b = GetPosition(vertices, vertex_floats, indices[i + 1]);
+    glm::vec3 c = GetPosition(vertices, vertex_floats, indices[i + 2]);
+
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    if (length <= 0.f) {
+      continue;
+    }
+    normal /= length;
+
+    float area = length * 0.5f;
+    float distance = -glm::dot(normal, a);
+    for (size_t k = 0; k < 3; ++k) {
+      quadrics[indices[i + k]].AddPlane(normal, distance, area);
+    }
+  }
+
+  const double error_limit = static_cast<double>(target_error) * static_cast<double>(target_error);
+  double max_error = 0.0;
+
+  std::vector<unsigned int> collapse_target(vertex_count);
+  std::vector<bool> touched(vertex_count);
+  std::vector<unsigned int> adjacency_offsets(vertex_count + 1);
+  std::vector<unsigned int> adjacency;
+  std::vector<EdgeCollapse> collapses;
+
+  //Each pass collapses the cheapest independent edges, then rebuilds the index list
+  while (result.size() > target_index_count) {
+    const size_t triangle_count = result.size() / 3;
+
+    std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+    for (const unsigned int& index : result) {
+      ++adjacency_offsets[index + 1];
+    }
+    for (size_t i = 0; i < vertex_count; ++i) {
+      adjacency_offsets[i + 1] += adjacency_offsets[i];
+    }
+    adjacency.resize(result.size());
+    std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t i = 0; i < result.size(); ++i) {
+      adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    //Manifold edges show up once in each direction, only look at one of them
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (size_t k = 0; k < 3; ++k) {
+        unsigned int a = result[i + k];
+        unsigned int b = result[i + (k + 1) % 3];
+        if (a > b || (locked[a] && locked[b])) {
+          continue;
+        }
+
+        Quadric combined = quadrics[a];
+        combined.Add(quadrics[b]);
+
+        double error_a = locked[a] ? -1.0 : combined.Evaluate(GetPosition(vertices, vertex_floats, b));
+        double error_b = locked[b] ? -1.0 : combined.Evaluate(GetPosition(vertices, vertex_floats, a));
+
+        if (error_b < 0.0 || (error_a >= 0.0 && error_a <= error_b)) {
+          collapses.push_back(EdgeCollapse { a, b, error_a });
+        } else {
+          collapses.push_back(EdgeCollapse { b, a, error_b });
+        }
+      }
+    }
+
+    std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& lhs, const EdgeCollapse& rhs) {
+      return lhs.error_ < rhs.error_;
+    });
+
+    for (size_t i = 0; i < vertex_count; ++i) {
+      collapse_target[i] = static_cast<unsigned int>(i);
+    }
+    std::fill(touched.begin(), touched.end(), false);
+
+    const size_t target_triangles = target_index_count / 3;
+    size_t remaining_triangles = triangle_count;
+    size_t collapsed = 0;
+
+    for (const EdgeCollapse& collapse : collapses) {
+      if (collapse.error_ > error_limit || remaining_triangles <= target_triangles) {
+        break;
+      }
+      if (touched[collapse.from_] || touched[collapse.to_]) {
+        continue;
+      }
+
+      const unsigned int* triangles = &adjacency[adjacency_offsets[collapse.from_]];
+      const unsigned int triangles_around = adjacency_offsets[collapse.from_ + 1] - adjacency_offsets[collapse.from_];
+      if (CollapseFlipsTriangle(collapse, result, triangles, triangles_around, vertices, vertex_floats)) {
+        continue;
+      }
+
+      //Freeze the whole one ring so flip checks later in this pass stay valid
+      unsigned int removed = 0;
+      for (unsigned int t = 0; t < triangles_around; ++t) {
+        const unsigned int* triangle = &result[triangles[t] * 3];
+        bool uses_target = false;
+        for (size_t k = 0; k < 3; ++k) {
+          touched[triangle[k]] = true;
+          uses_target |= triangle[k] == collapse.to_;
+        }
+        removed += uses_target ? 1 : 0;
+      }
+
+      collapse_target[collapse.from_] = collapse.to_;
+      quadrics[collapse.to_].Add(quadrics[collapse.from_]);
+      max_error = std::max(max_error, collapse.error_);
+      remaining_triangles -= std::min<size_t>(removed, remaining_triangles);
+      ++collapsed;
+    }
+
+    if (collapsed == 0) {
+      break;
+    }
+
+    //Touched vertices never collapse twice in a pass, one lookup is enough
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      unsigned int a = collapse_target[result[i]];
+      unsigned int b = collapse_target[result[i + 1]];
+      unsigned int c = collapse_target[result[i + 2]];
+      if (a == b || b == c || a == c) {
+        continue;
+      }
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  result_error = static_cast<float>(std::sqrt(max_error));
+  return result;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef MESH_SIMPLIFIER_H_
+#define MESH_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <vector>
+
+//Range of one level of detail inside a primitive's index buffer. error_ is
+//the largest deviation from the full mesh in object space units.
+struct MeshLod {
+  unsigned int index_offset_ = 0;
+  unsigned int index_count_ = 0;
+  float error_ = 0.f;
+};
+
+struct MeshLodOptions {
+  //Including the full detail mesh, 1 disables generation
+  int max_lods_ = 4;
+  //Every level aims for this fraction of the previous level's triangles
+  float reduction_ = 0.5f;
+  //Largest allowed error, relative to the primitive's bounding radius
+  float max_error_ = 0.02f;
+};
+
+//Quadric error edge collapse. Vertices only ever collapse onto other existing
+//vertices, so every level keeps using the original vertex buffer. Vertices on
+//open borders and attribute seams are locked in place. Positions are the
+//first three floats of every vertex. Stops at target_index_count or once the
+//next collapse would exceed target_error, and reports the largest error of
+//any collapse it made in result_error.
+std::vector<unsigned int> SimplifyMesh(const std::vector<unsigned int>& indices, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats,
+  const size_t& target_index_count, const float& target_error, float& result_error);
+
+#endif
\ No newline at end of file
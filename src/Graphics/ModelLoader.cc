@@ -3,6 +3,15 @@
 #include <glad/glad.h>
 #include <plog/Log.h>
 
+#include "../Core/JobSystem.h"
+
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
 static void LogPrimitiveMode(const int& mode) {
   if (mode == 0)
     PLOGD << "MODE: POINTS";
@@ -77,10 +86,82 @@ static void LogDrawTarget(const int& target) {
     PLOGD << "TARGET: ELEMENT ARRAY BUFFER";
 }
 
+//Tightly packed bytes of an accessor, without copying them out of the buffer
+static ByteSpan GetAccessorData(const tinygltf::Accessor& accessor, const tinygltf::Model& model) {
+  const tinygltf::BufferView& buffer_view = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer& buffer = model.buffers[buffer_view.buffer];
+
+  size_t element_size = tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
+  size_t offset = buffer_view.byteOffset + accessor.byteOffset;
+  size_t size = element_size * accessor.count;
+
+  assert(offset + size <= buffer.data.size() && "Accessor out of buffer bounds!");
+
+  return ByteSpan { buffer.data.data() + offset, size };
+}
+
+static std::vector<unsigned int> ReadIndices(const ByteSpan& indices, const int& component_type, const size_t& count) {
+  std::vector<unsigned int> result(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+      result[i] = indices.data_[i];
+    } else if (component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+      unsigned short index;
+      std::memcpy(&index, indices.data_ + i * sizeof(index), sizeof(index));
+      result[i] = index;
+    } else {
+      assert(component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT && "Unsupported index type!");
+      std::memcpy(&result[i], indices.data_ + i * sizeof(unsigned int), sizeof(unsigned int));
+    }
+  }
+  return result;
+}
+
+//Narrows to unsigned shorts whenever the vertex count allows it
+static std::vector<unsigned char> WriteIndices(const std::vector<unsigned int>& indices, const size_t& vertex_count, int& component_type) {
+  std::vector<unsigned char> result;
+  if (vertex_count <= 0xFFFF) {
+    component_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+    result.resize(indices.size() * sizeof(unsigned short));
+    for (size_t i = 0; i < indices.size(); ++i) {
+      unsigned short index = static_cast<unsigned short>(indices[i]);
+      std::memcpy(result.data() + i * sizeof(index), &index, sizeof(index));
+    }
+  } else {
+    component_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+    result.resize(indices.size() * sizeof(unsigned int));
+    std::memcpy(result.data(), indices.data(), result.size());
+  }
+  return result;
+}
+
+static void ComputeBounds(const float* positions, const size_t& vertex_count, glm::vec3& center, glm::vec3& extents, float& radius) {
+  if (vertex_count == 0) {
+    return;
+  }
+
+  glm::vec3 min(positions[0], positions[1], positions[2]);
+  glm::vec3 max = min;
+  for (size_t i = 1; i < vertex_count; ++i) {
+    glm::vec3 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+    min = glm::min(min, position);
+    max = glm::max(max, position);
+  }
+
+  center = (min + max) * 0.5f;
+  extents = (max - min) * 0.5f;
+  radius = 0.f;
+  for (size_t i = 0; i < vertex_count; ++i) {
+    glm::vec3 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+    radius = std::max(radius, glm::length(position - center));
+  }
+}
+
 void Model::ProcessNodes(const tinygltf::Node& node, const tinygltf::Model& model) { 
 
-  Mesh new_mesh;
-  new_mesh.primitives_ = ProcessMesh(model.meshes[node.mesh], model);
+  meshes_.emplace_back();
+  Mesh& new_mesh = meshes_.back();
+  ProcessMesh(model.meshes[node.mesh], model, new_mesh.primitives_);
  
   if (node.translation.size() != 0.f) {
     assert(node.translation.size() == 3 && "Translation size not 3!");
@@ -95,18 +176,104 @@ void Model::ProcessNodes(const tinygltf::Node& node, const tinygltf::Model& mode
     new_mesh.local_transform_.scale_ = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
   }
 
-  meshes_.push_back(new_mesh);
-
   for (const int& child : node.children) {
     ProcessNodes(model.nodes[child], model);
   }
 }
 
-std::vector<PrimitiveData> Model::ProcessMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model) {
+//Interleaves the float attributes for the optimizer, then splits them back
+//out for PackVertices. The reordered indices are owned by the Model.
+void Model::OptimizePrimitive(PrimitiveData& primitive_data, const float* positions, const float* normals, const float* texcoords,
+    std::vector<float>& optimized_positions, std::vector<float>& optimized_normals, std::vector<float>& optimized_texcoords) {
+  constexpr size_t kVertexFloats = 8;
+
+  size_t vertex_count = primitive_data.vertex_count_;
+  std::vector<float> vertices(vertex_count * kVertexFloats);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    float* vertex = &vertices[i * kVertexFloats];
+    std::memcpy(vertex, positions + i * 3, sizeof(float) * 3);
+    std::memcpy(vertex + 3, normals + i * 3, sizeof(float) * 3);
+    std::memcpy(vertex + 6, texcoords + i * 2, sizeof(float) * 2);
+  }
+
+  std::vector<unsigned int> indices = ReadIndices(primitive_data.indices_, primitive_data.component_type_, primitive_data.indices_count_);
+  VertexCacheStats before = AnalyzeVertexCache(indices, vertex_count);
+
+  OptimizeMesh(vertices, kVertexFloats, indices, options_.mesh_optimize_);
+
+  vertex_count = vertices.size() / kVertexFloats;
+  VertexCacheStats after = AnalyzeVertexCache(indices, vertex_count);
+
+  PLOGD << "OPTIMIZED: " << primitive_data.vertex_count_ << " -> " << vertex_count << " vertices, "
+        << "ACMR " << before.acmr_ << " -> " << after.acmr_ << ", ATVR " << before.atvr_ << " -> " << after.atvr_;
+
+  GenerateLods(primitive_data, vertices.data(), vertex_count, kVertexFloats, indices);
+
+  optimized_positions.resize(vertex_count * 3);
+  optimized_normals.resize(vertex_count * 3);
+  optimized_texcoords.resize(vertex_count * 2);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    const float* vertex = &vertices[i * kVertexFloats];
+    std::memcpy(&optimized_positions[i * 3], vertex, sizeof(float) * 3);
+    std::memcpy(&optimized_normals[i * 3], vertex + 3, sizeof(float) * 3);
+    std::memcpy(&optimized_texcoords[i * 2], vertex + 6, sizeof(float) * 2);
+  }
+
+  primitive_data.vertex_count_ = static_cast<int>(vertex_count);
+  primitive_data.indices_count_ = static_cast<int>(indices.size());
+
+  packed_indices_.push_back(WriteIndices(indices, vertex_count, primitive_data.component_type_));
+  primitive_data.indices_ = ByteSpan { packed_indices_.back().data(), packed_indices_.back().size() };
+}
+
+//Each level is simplified from the full mesh so its error is measured against
+//the original surface, then appended after the previous level
+void Model::GenerateLods(PrimitiveData& primitive_data, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats, std::vector<unsigned int>& indices) {
+  const MeshLodOptions& options = options_.lod_;
+  if (options.max_lods_ <= 1) {
+    return;
+  }
+
+  const std::vector<unsigned int> full_detail = indices;
+  primitive_data.lods_.push_back(MeshLod { 0, static_cast<unsigned int>(indices.size()), 0.f });
+
+  const float max_error = options.max_error_ * primitive_data.bounds_radius_;
+  size_t previous_count = full_detail.size();
+  float previous_error = 0.f;
+
+  for (int lod = 1; lod < options.max_lods_; ++lod) {
+    size_t target_count = static_cast<size_t>(previous_count * options.reduction_) / 3 * 3;
+    float error = 0.f;
+    std::vector<unsigned int> simplified = SimplifyMesh(full_detail, vertices, vertex_count, vertex_floats, target_count, max_error, error);
+
+    //Ran into the error bound, further levels would just repeat this one
+    if (simplified.empty() || simplified.size() * 10 > previous_count * 9) {
+      break;
+    }
+
+    OptimizeVertexCache(simplified, vertex_count);
+
+    previous_error = std::max(previous_error, error);
+    primitive_data.lods_.push_back(MeshLod { static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(simplified.size()), previous_error });
+    PLOGD << "LOD " << lod << ": " << simplified.size() / 3 << " triangles, error " << previous_error;
+
+    indices.insert(indices.end(), simplified.begin(), simplified.end());
+    previous_count = simplified.size();
+  }
+
+  //Nothing simplified, drawing the whole buffer is the same thing
+  if (primitive_data.lods_.size() == 1) {
+    primitive_data.lods_.clear();
+  }
+}
+
+void Model::ProcessMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model, std::vector<PrimitiveData>& primitives) {
   PLOGD << mesh.name;
-  std::vector<PrimitiveData> primitives;
+  primitives.reserve(mesh.primitives.size());
   for (const tinygltf::Primitive& primitive : mesh.primitives) {
-    PrimitiveData primitive_data;
+    primitives.emplace_back();
+    PrimitiveData& primitive_data = primitives.back();
+
     LogPrimitiveMode(primitive.mode);
     primitive_data.draw_mode_ = primitive.mode;
     const tinygltf::Accessor& index_accessor = model.accessors[primitive.indices];
@@ -118,20 +285,20 @@ std::vector<PrimitiveData> Model::ProcessMesh(const tinygltf::Mesh& mesh, const
     primitive_data.indices_count_ = index_accessor.count;
     LogType(index_accessor.type);
     
-    const tinygltf::BufferView* index_buffer_view = &model.bufferViews[index_accessor.bufferView] + index_accessor.byteOffset;
-    const tinygltf::Buffer& index_buffer = model.buffers[index_buffer_view->buffer];
+    const tinygltf::BufferView& index_buffer_view = model.bufferViews[index_accessor.bufferView];
 
-    PLOGD << "INDEX DATA SIZE: " << index_buffer_view->byteLength;
-    PLOGD << "INDEX DATA OFFSET: " << index_buffer_view->byteOffset;
+    PLOGD << "INDEX DATA SIZE: " << index_buffer_view.byteLength;
+    PLOGD << "INDEX DATA OFFSET: " << index_buffer_view.byteOffset;
 
-    PLOGD << "INDEX DATA STRIDE: " << index_buffer_view->byteStride;
+    PLOGD << "INDEX DATA STRIDE: " << index_buffer_view.byteStride;
 
-    assert(index_buffer_view->byteStride == 0 && "Byte stride of indices is not 0!");
+    assert(index_buffer_view.byteStride == 0 && "Byte stride of indices is not 0!");
 
-    auto indices_slice_begin = index_buffer.data.cbegin() + index_buffer_view->byteOffset;
-    auto indices_slice_end = indices_slice_begin + index_buffer_view->byteLength;
+    primitive_data.indices_ = GetAccessorData(index_accessor, model);
 
-    primitive_data.indices_ = std::vector<unsigned char>(indices_slice_begin, indices_slice_end);
+    ByteSpan position;
+    ByteSpan normal;
+    ByteSpan texcoords;
 
     for (const auto& attribute : primitive.attributes) {
       PLOGD << "ATTRIBUTE: " << attribute.first;
@@ -142,42 +309,66 @@ std::vector<PrimitiveData> Model::ProcessMesh(const tinygltf::Mesh& mesh, const
       PLOGD << "COUNT: " << accessor.count;
 
       PLOGD << "ACCESSOR BYTE OFFSET: " << accessor.byteOffset;
-      const tinygltf::BufferView* buffer_view = &model.bufferViews[accessor.bufferView] + accessor.byteOffset;
-      PLOGD << "ACCESSOR BYTE STRIDE: " << buffer_view->byteStride;
-      assert(buffer_view->byteStride == 0 && "Byte stride is not 0!");
-      LogDrawTarget(buffer_view->target);
-
-      const tinygltf::Buffer& buffer = model.buffers[buffer_view->buffer];
-      auto data_begin = buffer.data.cbegin() + buffer_view->byteOffset;
-      auto data_end = data_begin + buffer_view->byteLength;
+      const tinygltf::BufferView& buffer_view = model.bufferViews[accessor.bufferView];
+      PLOGD << "ACCESSOR BYTE STRIDE: " << buffer_view.byteStride;
+      assert(buffer_view.byteStride == 0 && "Byte stride is not 0!");
+      LogDrawTarget(buffer_view.target);
 
       if (attribute.first == "POSITION") {
-        primitive_data.position_ = std::vector<unsigned char>(data_begin, data_end);
+        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "Positions are not floats!");
+        position = GetAccessorData(accessor, model);
+        primitive_data.vertex_count_ = accessor.count;
       } else if (attribute.first == "TEXCOORD_0") {
-        primitive_data.texcoords_ = std::vector<unsigned char>(data_begin, data_end);
+        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "Texcoords are not floats!");
+        texcoords = GetAccessorData(accessor, model);
       } else if (attribute.first == "NORMAL") {
-        primitive_data.normal_ = std::vector<unsigned char>(data_begin, data_end);
+        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "Normals are not floats!");
+        normal = GetAccessorData(accessor, model);
       }
     }
-    assert(!primitive_data.indices_.empty() && "NO INDICES COLLECTED");
-    assert(!primitive_data.position_.empty() && "NO POSITION DATA COLLECTED");
-    assert(!primitive_data.normal_.empty() && "NO NORMAL DATA COLLECTED");
-    assert(!primitive_data.texcoords_.empty() && "NO TEXCOORD DATA COLLECTED");
+    assert(!primitive_data.indices_.Empty() && "NO INDICES COLLECTED");
+    assert(!position.Empty() && "NO POSITION DATA COLLECTED");
+    assert(!normal.Empty() && "NO NORMAL DATA COLLECTED");
+    assert(!texcoords.Empty() && "NO TEXCOORD DATA COLLECTED");
+
+    //glTF buffers are only guaranteed 4 byte aligned, which is all floats need
+    const float* positions = reinterpret_cast<const float*>(position.data_);
+    const float* normals = reinterpret_cast<const float*>(normal.data_);
+    const float* uvs = reinterpret_cast<const float*>(texcoords.data_);
+
+    ComputeBounds(positions, primitive_data.vertex_count_, primitive_data.bounds_center_, primitive_data.bounds_extents_, primitive_data.bounds_radius_);
+
+    std::vector<float> optimized_positions, optimized_normals, optimized_texcoords;
+
+    if (options_.mesh_optimize_.enabled_ && primitive_data.draw_mode_ == TINYGLTF_MODE_TRIANGLES) {
+      OptimizePrimitive(primitive_data, positions, normals, uvs, optimized_positions, optimized_normals, optimized_texcoords);
+      positions = optimized_positions.data();
+      normals = optimized_normals.data();
+      uvs = optimized_texcoords.data();
+    }
+
+    PackedVertices packed = PackVertices(positions, normals, uvs, primitive_data.vertex_count_, options_.vertex_packing_);
+
+    primitive_data.layout_ = packed.layout_;
+    primitive_data.position_scale_ = packed.position_scale_;
+    primitive_data.position_offset_ = packed.position_offset_;
+
+    packed_vertices_.push_back(std::move(packed.data_));
+    primitive_data.vertices_ = ByteSpan { packed_vertices_.back().data(), packed_vertices_.back().size() };
 
     PLOGD << "---PRIMITIVE---";
     LogComponentType(primitive_data.component_type_);
     LogPrimitiveMode(primitive_data.draw_mode_);
     PLOGD << primitive_data.indices_count_;
-    PLOGD << primitive_data.position_.size();
-    PLOGD << primitive_data.normal_.size();
-    PLOGD << primitive_data.texcoords_.size();
-    PLOGD << primitive_data.indices_.size();
+    PLOGD << primitive_data.vertex_count_ << " vertices, stride " << primitive_data.layout_.stride_;
+    PLOGD << primitive_data.vertices_.size_;
+    PLOGD << primitive_data.indices_.size_;
     PLOGD << "------END------";
 
     const tinygltf::Material& material = model.materials[primitive.material];
     PLOGD << "BASE COLOR FACTOR SIZE: " << material.pbrMetallicRoughness.baseColorFactor.size();
 
-    const std::vector<double> base_color = material.pbrMetallicRoughness.baseColorFactor;
+    const std::vector<double>& base_color = material.pbrMetallicRoughness.baseColorFactor;
   
     glm::vec3 material_base_color = glm::vec3(0.0);
 
@@ -201,31 +392,105 @@ std::vector<PrimitiveData> Model::ProcessMesh(const tinygltf::Mesh& mesh, const
         primitive_data.material_.wrap_t_ = sampler.wrapT;
         primitive_data.material_.component_ = image.component;
         primitive_data.material_.bits_ = image.bits;
-        primitive_data.material_.texture_data_ = image.image;
+        primitive_data.material_.texture_data_ = ByteSpan { image.image.data(), image.image.size() };
         primitive_data.material_.texture_width_ = image.width;
         primitive_data.material_.texture_height_ = image.height;
       } 
     }
-
-    primitives.push_back(primitive_data); 
   }
 
   assert(primitives.size() != 0 && "No mesh primitives processed!");
-  return primitives;
 }
 
-void Model::LoadModel(const std::string& filename) {
+//Materials share images, each one is only cooked once
+void Model::CookTextures() {
+  std::vector<MaterialData*> materials;
+  std::map<const unsigned char*, size_t> image_indices;
+  std::vector<const MaterialData*> images;
+
+  for (Mesh& mesh : meshes_) {
+    for (PrimitiveData& primitive : mesh.primitives_) {
+      MaterialData& material = primitive.material_;
+      if (!material.use_texture_ || material.texture_data_.Empty()) {
+        continue;
+      }
+      materials.push_back(&material);
+      if (image_indices.emplace(material.texture_data_.data_, images.size()).second) {
+        images.push_back(&material);
+      }
+    }
+  }
+
+  cooked_textures_.resize(images.size());
+  JobSystem::ParallelFor(images.size(), 1, [this, &images](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const MaterialData& image = *images[i];
+      cooked_textures_[i] = CookTexture(image.texture_data_.data_, image.texture_width_, image.texture_height_, image.component_, image.bits_, options_.texture_cook_);
+    }
+  });
+
+  for (MaterialData* material : materials) {
+    const CookedTexture& cooked = cooked_textures_[image_indices[material->texture_data_.data_]];
+    material->texture_format_ = cooked.format_;
+    material->texture_mips_.clear();
+    for (const std::vector<unsigned char>& mip : cooked.mips_) {
+      material->texture_mips_.push_back(ByteSpan { mip.data(), mip.size() });
+    }
+    material->texture_data_ = ByteSpan {};
+  }
+
+  PLOGD << "Cooked " << cooked_textures_.size() << " textures";
+}
+
+//Safe to call from any thread, touches no GL state
+bool Model::LoadModel(const std::string& filename, const ModelLoadOptions& options) {
+  options_ = options;
+
+  std::string cache_path = filename + kMeshCacheExtension;
+  //No hash means no cache, neither read nor written
+  unsigned long long source_hash = options_.use_mesh_cache_ ? HashFileContents(filename) : 0;
+
+  if (source_hash != 0 && ReadMeshCache(cache_path, source_hash, options_, cache_contents_, meshes_)) {
+    PLOGD << "Loaded " << filename << " from mesh cache";
+    return true;
+  }
+
   tinygltf::TinyGLTF loader;
-  tinygltf::Model model;
+  tinygltf::Model& model = source_;
   std::string warning, error;
-  loader.LoadASCIIFromFile(&model, &error, &warning, filename);
+  bool loaded = loader.LoadASCIIFromFile(&model, &error, &warning, filename);
 
   PLOG_WARNING_IF(!warning.empty()) << warning;
   PLOG_ERROR_IF(!error.empty()) << error;
 
-  for (const int& node : model.scenes[model.defaultScene].nodes) {
+  if (!loaded || model.scenes.empty()) {
+    return false;
+  }
+
+  int scene = model.defaultScene >= 0 ? model.defaultScene : 0;
+  for (const int& node : model.scenes[scene].nodes) {
     ProcessNodes(model.nodes[node], model);
   }
+
+  if (options_.texture_cook_.enabled_) {
+    CookTextures();
+  }
+
+  size_t vertex_bytes = 0;
+  size_t index_bytes = 0;
+  for (const Mesh& mesh : meshes_) {
+    for (const PrimitiveData& primitive : mesh.primitives_) {
+      vertex_bytes += primitive.vertices_.size_;
+      index_bytes += primitive.indices_.size_;
+    }
+  }
+  PLOGD << "Packed " << vertex_bytes << " bytes of vertices, referenced " << index_bytes << " bytes of indices from " << filename;
+
+  if (source_hash != 0) {
+    WriteMeshCache(cache_path, source_hash, options_, meshes_);
+  }
+
+  return true;
 }
 
 std::vector<Mesh>& Model::GetMeshes() {
@@ -7,25 +7,55 @@
 
 #include "../Components/TransformComponent.h"
 
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TextureCooker.h"
+#include "VertexPacking.h"
+
+//Non-owning view into bytes kept alive by the Model that produced it
+struct ByteSpan {
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+
+  bool Empty() const { return size_ == 0; }
+};
+
 struct MaterialData {
   bool use_texture_ = false;
   int wrap_s_ = 0;
   int wrap_t_ = 0;
   int component_ = 0;
   int bits_ = 0;
-  std::vector<unsigned char> texture_data_;
+  //Raw pixels when the texture wasn't cooked, empty otherwise
+  ByteSpan texture_data_;
+  //Cooked textures carry their whole mip chain
+  TextureFormat texture_format_ = TextureFormat::kTextureFormatRGBA8;
+  std::vector<ByteSpan> texture_mips_;
   int texture_width_ = 0;
   int texture_height_ = 0;
   glm::vec3 base_color_ = glm::vec3(0.f);
   std::string name_;
 };
 
+//Points straight into storage owned by the Model (the interleaved vertex
+//data it packed, the parsed glTF buffers or the mesh cache file), so a
+//primitive's bytes are only copied once, on their way to the GPU
 struct PrimitiveData {
-  std::vector<unsigned char> position_;
-  std::vector<unsigned char> normal_;
-  std::vector<unsigned char> texcoords_;
-  std::vector<unsigned char> indices_;
+  ByteSpan vertices_;
+  VertexLayout layout_;
+  int vertex_count_ = 0;
+  glm::vec3 position_scale_ = glm::vec3(1.f);
+  glm::vec3 position_offset_ = glm::vec3(0.f);
+
+  //Every level of detail lives in indices_, lods_[0] is the full mesh.
+  //Empty when no levels were generated.
+  ByteSpan indices_;
   int indices_count_;
+  std::vector<MeshLod> lods_;
+  //Bounding box and sphere share the center
+  glm::vec3 bounds_center_ = glm::vec3(0.f);
+  glm::vec3 bounds_extents_ = glm::vec3(0.f);
+  float bounds_radius_ = 0.f;
   int draw_mode_;
   int component_type_;
   MaterialData material_;
@@ -36,16 +66,49 @@ struct Mesh {
   TransformComponent local_transform_; 
 };
 
+//Owns the storage every PrimitiveData span points into. Keep the Model alive
+//until its primitives have been uploaded.
+struct ModelLoadOptions {
+  VertexPackingOptions vertex_packing_;
+  MeshOptimizeOptions mesh_optimize_;
+  //Only generated for primitives that went through the optimizer
+  MeshLodOptions lod_;
+  //Share one texture array between every texture with the same size, format
+  //and wrapping. Otherwise each texture gets an array of its own. Applied at
+  //upload, the mesh cache doesn't depend on it.
+  bool pack_texture_arrays_ = true;
+  //Block compresses base color textures on the loading thread
+  TextureCookOptions texture_cook_;
+  //Read and write the mesh cache next to the source. Tools and benchmarks
+  //that need the import itself to run turn it off.
+  bool use_mesh_cache_ = true;
+};
+
 class Model {
 public:
   Model() = default;
-  void LoadModel(const std::string& filename);
+  Model(const Model&) = delete;
+  Model& operator=(const Model&) = delete;
+
+  bool LoadModel(const std::string& filename, const ModelLoadOptions& options = ModelLoadOptions());
   std::vector<Mesh>& GetMeshes();
+  const ModelLoadOptions& GetOptions() const { return options_; }
 private:
   void ProcessNodes(const tinygltf::Node& node, const tinygltf::Model& model);
-  std::vector<PrimitiveData> ProcessMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model); 
+  void ProcessMesh(const tinygltf::Mesh& mesh, const tinygltf::Model& model, std::vector<PrimitiveData>& primitives); 
+  void OptimizePrimitive(PrimitiveData& primitive_data, const float* positions, const float* normals, const float* texcoords,
+    std::vector<float>& optimized_positions, std::vector<float>& optimized_normals, std::vector<float>& optimized_texcoords);
+  void CookTextures();
+  void GenerateLods(PrimitiveData& primitive_data, const float* vertices, const size_t& vertex_count, const size_t& vertex_floats, std::vector<unsigned int>& indices);
 private:
   std::vector<Mesh> meshes_;
+  ModelLoadOptions options_;
+
+  tinygltf::Model source_;
+  std::vector<std::vector<unsigned char>> packed_vertices_;
+  std::vector<std::vector<unsigned char>> packed_indices_;
+  std::vector<CookedTexture> cooked_textures_;
+  std::vector<unsigned char> cache_contents_;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "RenderQueue.h"
+
+#include <glad/glad.h>
+
+#include "RenderState.h"
+
+#include <algorithm>
+#include <chrono>
+
+std::vector<DrawPacket> RenderQueue::packets_;
+std::vector<RenderQueue::SortEntry> RenderQueue::sorted_;
+std::vector<RenderQueue::SortEntry> RenderQueue::scratch_;
+
+std::vector<RenderQueue::Batch> RenderQueue::batches_;
+std::vector<glm::mat4> RenderQueue::instance_matrices_;
+std::shared_ptr<Buffer> RenderQueue::instance_buffer_;
+std::shared_ptr<Buffer> RenderQueue::frame_uniforms_;
+
+RenderQueue::Stats RenderQueue::stats_;
+
+//Bits per field, most significant first
+constexpr int kShaderBits = 12;
+constexpr int kTextureBits = 16;
+constexpr int kVertexArrayBits = 16;
+constexpr int kDepthBits = 20;
+
+static_assert(kShaderBits + kTextureBits + kVertexArrayBits + kDepthBits == 64, "Sort key has to fill 64 bits");
+
+constexpr UniformName kUniformModel("model");
+constexpr UniformName kUniformPositionScale("positionScale");
+constexpr UniformName kUniformPositionOffset("positionOffset");
+
+//A single packet isn't worth an instanced draw
+constexpr size_t kMinInstances = 2;
+
+static unsigned long long KeyField(const unsigned long long& value, const int& bits) {
+  return value & ((1ull << bits) - 1ull);
+}
+
+//GL names are small and dense, so using them directly groups identical
+//objects. A masked collision only costs a redundant bind, never a wrong draw.
+static unsigned long long PackSortKey(const Shader* shader, const Texture* texture, const VertexArray* vertex_array, const unsigned long long& low_bits) {
+  unsigned long long shader_id = shader != nullptr ? shader->GetId() : 0;
+  unsigned long long texture_id = texture != nullptr ? texture->GetId() : 0;
+  unsigned long long vertex_array_id = vertex_array != nullptr ? vertex_array->GetId() : 0;
+
+  unsigned long long key = KeyField(shader_id, kShaderBits);
+  key = (key << kTextureBits) | KeyField(texture_id, kTextureBits);
+  key = (key << kVertexArrayBits) | KeyField(vertex_array_id, kVertexArrayBits);
+  key = (key << kDepthBits) | KeyField(low_bits, kDepthBits);
+  return key;
+}
+
+unsigned long long RenderQueue::MakeSortKey(const Shader* shader, const Texture* texture, const VertexArray* vertex_array, const float& depth) {
+  unsigned long long depth_bits = static_cast<unsigned long long>(std::min(std::max(depth, 0.f), 1.f) * static_cast<float>((1ull << kDepthBits) - 1ull));
+  return PackSortKey(shader, texture, vertex_array, depth_bits);
+}
+
+unsigned long long RenderQueue::MakeInstancedSortKey(const Shader* shader, const Texture* texture, const VertexArray* vertex_array, const size_t& index_offset) {
+  return PackSortKey(shader, texture, vertex_array, index_offset);
+}
+
+static bool CanShareInstancedDraw(const DrawPacket& a, const DrawPacket& b) {
+  return a.instanced_shader_ == b.instanced_shader_
+    && a.shader_ == b.shader_
+    && a.texture_ == b.texture_
+    && a.vertex_array_ == b.vertex_array_
+    && a.material_uniforms_ == b.material_uniforms_
+    && a.draw_mode_ == b.draw_mode_
+    && a.index_type_ == b.index_type_
+    && a.index_count_ == b.index_count_
+    && a.index_offset_ == b.index_offset_
+    && a.position_scale_ == b.position_scale_
+    && a.position_offset_ == b.position_offset_;
+}
+
+void RenderQueue::Submit(const DrawPacket& packet) {
+  packets_.push_back(packet);
+}
+
+//LSD radix sort, one byte per pass. Passes where every key has the same byte
+//are skipped, which is most of them since the high fields rarely vary.
+void RenderQueue::SortPackets() {
+  sorted_.resize(packets_.size());
+  scratch_.resize(packets_.size());
+  for (size_t i = 0; i < packets_.size(); ++i) {
+    sorted_[i] = SortEntry { packets_[i].sort_key_, static_cast<unsigned int>(i) };
+  }
+
+  for (int shift = 0; shift < 64; shift += 8) {
+    size_t counts[256] = {};
+    for (const SortEntry& entry : sorted_) {
+      ++counts[(entry.key_ >> shift) & 0xFF];
+    }
+
+    if (counts[(sorted_.front().key_ >> shift) & 0xFF] == sorted_.size()) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t& count : counts) {
+      size_t bucket_size = count;
+      count = offset;
+      offset += bucket_size;
+    }
+
+    for (const SortEntry& entry : sorted_) {
+      scratch_[counts[(entry.key_ >> shift) & 0xFF]++] = entry;
+    }
+    sorted_.swap(scratch_);
+  }
+}
+
+//Splits the sorted packets into draws and gathers the model matrices of every
+//instanced run into one array, uploaded once per flush
+void RenderQueue::BuildBatches() {
+  batches_.clear();
+  instance_matrices_.clear();
+
+  size_t begin = 0;
+  while (begin < sorted_.size()) {
+    const DrawPacket& first = packets_[sorted_[begin].packet_];
+
+    size_t end = begin + 1;
+    if (first.instanced_shader_ != nullptr) {
+      while (end < sorted_.size() && CanShareInstancedDraw(first, packets_[sorted_[end].packet_])) {
+        ++end;
+      }
+    }
+
+    Batch batch { begin, end - begin, 0 };
+    if (batch.count_ >= kMinInstances) {
+      batch.instance_offset_ = instance_matrices_.size() * sizeof(glm::mat4);
+      for (size_t i = begin; i < end; ++i) {
+        instance_matrices_.push_back(packets_[sorted_[i].packet_].model_);
+      }
+    }
+
+    batches_.push_back(batch);
+    begin = end;
+  }
+}
+
+void RenderQueue::Flush(const FrameUniforms& frame) {
+  if (frame_uniforms_ == nullptr) {
+    frame_uniforms_ = std::make_shared<Buffer>(BufferType::kBufferTypeUniform);
+  }
+  frame_uniforms_->Bind();
+  frame_uniforms_->BufferData(sizeof(FrameUniforms), &frame, BufferUsageType::kBufferDynamic);
+  frame_uniforms_->BindBase(kFrameUniformBinding);
+
+  stats_ = Stats();
+  stats_.packets_ = static_cast<unsigned int>(packets_.size());
+  if (packets_.empty()) {
+    return;
+  }
+
+  auto sort_start = std::chrono::steady_clock::now();
+  SortPackets();
+  stats_.sort_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sort_start).count();
+
+  BuildBatches();
+
+  if (!instance_matrices_.empty()) {
+    if (instance_buffer_ == nullptr) {
+      instance_buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeVertex);
+    }
+    //Respecifying the whole buffer every frame lets the driver orphan last
+    //frame's storage instead of waiting for the GPU to finish with it
+    instance_buffer_->Bind();
+    instance_buffer_->BufferData(instance_matrices_.size() * sizeof(glm::mat4), instance_matrices_.data(), BufferUsageType::kBufferDynamic);
+  }
+
+  Shader* bound_shader = nullptr;
+  VertexArray* bound_vertex_array = nullptr;
+  Texture* bound_texture = nullptr;
+  bool texture_bound = false;
+  Buffer* bound_material = nullptr;
+
+  UniformHandle model_uniform;
+  UniformHandle position_scale_uniform;
+  UniformHandle position_offset_uniform;
+
+  for (const Batch& batch : batches_) {
+    const DrawPacket& packet = packets_[sorted_[batch.first_].packet_];
+    const bool instanced = batch.count_ >= kMinInstances;
+    Shader* shader = instanced ? packet.instanced_shader_ : packet.shader_;
+
+    if (shader != bound_shader) {
+      bound_shader = shader;
+      bound_shader->Bind();
+      ++stats_.state_changes_;
+
+      model_uniform = bound_shader->GetUniform(kUniformModel);
+      position_scale_uniform = bound_shader->GetUniform(kUniformPositionScale);
+      position_offset_uniform = bound_shader->GetUniform(kUniformPositionOffset);
+    }
+
+    if (packet.vertex_array_ != bound_vertex_array) {
+      bound_vertex_array = packet.vertex_array_;
+      bound_vertex_array->Bind();
+      ++stats_.state_changes_;
+    }
+
+    //Untextured draws sample texture 0, which the shader treats as white.
+    //Model textures are all arrays, see ResourceManager::CreateTextureArrays.
+    if (!texture_bound || packet.texture_ != bound_texture) {
+      bound_texture = packet.texture_;
+      texture_bound = true;
+      if (bound_texture != nullptr) {
+        bound_texture->BindSlot(0);
+      } else {
+        RenderState::BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+      }
+      ++stats_.state_changes_;
+    }
+
+    if (packet.material_uniforms_ != bound_material && packet.material_uniforms_ != nullptr) {
+      bound_material = packet.material_uniforms_;
+      bound_material->BindBase(kMaterialUniformBinding);
+      ++stats_.state_changes_;
+    }
+
+    bound_shader->SetUniform_Float3(position_scale_uniform, packet.position_scale_.x, packet.position_scale_.y, packet.position_scale_.z);
+    bound_shader->SetUniform_Float3(position_offset_uniform, packet.position_offset_.x, packet.position_offset_.y, packet.position_offset_.z);
+
+    if (instanced) {
+      //No base instance in GL 3.3, point the attributes at this run instead
+      bound_vertex_array->InstanceMatrixAttribute(kInstanceMatrixLocation, batch.instance_offset_);
+      ++stats_.state_changes_;
+
+      glDrawElementsInstanced(packet.draw_mode_, packet.index_count_, packet.index_type_, (void*)(packet.index_offset_), static_cast<GLsizei>(batch.count_));
+      ++stats_.instanced_draw_calls_;
+    } else {
+      bound_shader->SetUniform_Matrix(model_uniform, packet.model_);
+      glDrawElements(packet.draw_mode_, packet.index_count_, packet.index_type_, (void*)(packet.index_offset_));
+    }
+    ++stats_.draw_calls_;
+  }
+
+  //The rest can stay bound, but a vertex array left bound would pick up the
+  //next index buffer someone binds
+  RenderState::BindVertexArray(0);
+
+  packets_.clear();
+}
+
+RenderQueue::Stats RenderQueue::GetStats() {
+  return stats_;
+}
+
+void RenderQueue::Release() {
+  packets_.clear();
+  instance_buffer_.reset();
+  frame_uniforms_.reset();
+}
\ No newline at end of file
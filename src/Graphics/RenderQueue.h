@@ -0,0 +1,99 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "Buffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "UniformBlocks.h"
+#include "VertexArray.h"
+
+//Instanced shaders read their model matrix from these four locations
+constexpr unsigned int kInstanceMatrixLocation = 3;
+
+//Everything needed for one indexed draw. The queue doesn't own any of the
+//GL objects, they have to outlive the next Flush.
+struct DrawPacket {
+  unsigned long long sort_key_ = 0;
+
+  Shader* shader_ = nullptr;
+  //Set when the shader has an INSTANCED variant. Neighbouring packets that
+  //only differ by model matrix are then merged into one instanced draw.
+  Shader* instanced_shader_ = nullptr;
+  Texture* texture_ = nullptr;
+  VertexArray* vertex_array_ = nullptr;
+  //MaterialData block, bound to kMaterialUniformBinding
+  Buffer* material_uniforms_ = nullptr;
+
+  int draw_mode_ = 0;
+  int index_type_ = 0;
+  unsigned int index_count_ = 0;
+  size_t index_offset_ = 0;
+
+  glm::mat4 model_ = glm::mat4(1.f);
+  glm::vec3 position_scale_ = glm::vec3(1.f);
+  glm::vec3 position_offset_ = glm::vec3(0.f);
+};
+
+//Collects draws for a frame, radix sorts them by key and replays them only
+//changing the GL state that differs from the previous draw. Keys sort by
+//shader, then texture, then vertex array, then front to back depth.
+class RenderQueue {
+public:
+  struct Stats {
+    unsigned int packets_ = 0;
+    unsigned int draw_calls_ = 0;
+    unsigned int instanced_draw_calls_ = 0;
+    unsigned int state_changes_ = 0;
+    double sort_time_ = 0.0;
+  };
+
+  //depth is the view distance normalized to [0, 1]
+  static unsigned long long MakeSortKey(const Shader* shader, const Texture* texture, const VertexArray* vertex_array, const float& depth);
+  //Swaps depth for the draw's first index, so instances of the same mesh and
+  //level of detail end up next to each other
+  static unsigned long long MakeInstancedSortKey(const Shader* shader, const Texture* texture, const VertexArray* vertex_array, const size_t& index_offset);
+
+  static void Submit(const DrawPacket& packet);
+  //Uploads frame to the FrameData block, then draws. Main thread only.
+  static void Flush(const FrameUniforms& frame);
+
+  //Numbers from the last Flush
+  static Stats GetStats();
+
+  //Frees GL resources, call before the context goes away
+  static void Release();
+private:
+  struct SortEntry {
+    unsigned long long key_;
+    unsigned int packet_;
+  };
+
+  //A run of sorted packets drawn with one call
+  struct Batch {
+    size_t first_ = 0;
+    size_t count_ = 0;
+    unsigned long long instance_offset_ = 0;
+  };
+
+  static void SortPackets();
+  static void BuildBatches();
+private:
+  static std::vector<DrawPacket> packets_;
+  static std::vector<SortEntry> sorted_;
+  static std::vector<SortEntry> scratch_;
+
+  static std::vector<Batch> batches_;
+  static std::vector<glm::mat4> instance_matrices_;
+  static std::shared_ptr<Buffer> instance_buffer_;
+  static std::shared_ptr<Buffer> frame_uniforms_;
+
+  static Stats stats_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "RenderState.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+
+//No real object or flag ever has this value, so the next change always goes through
+constexpr unsigned int kUnknownState = 0xFFFFFFFFu;
+
+unsigned int RenderState::program_ = kUnknownState;
+unsigned int RenderState::vertex_array_ = kUnknownState;
+unsigned int RenderState::buffers_[RenderState::kBufferSlotCount];
+unsigned int RenderState::uniform_bindings_[RenderState::kMaxUniformBindings];
+unsigned int RenderState::active_texture_unit_ = kUnknownState;
+unsigned int RenderState::textures_[RenderState::kMaxTextureUnits][RenderState::kTextureSlotCount];
+unsigned int RenderState::capabilities_[static_cast<int>(RenderCapability::kCapabilityCount)];
+
+RenderState::Stats RenderState::frame_stats_;
+RenderState::Stats RenderState::last_frame_stats_;
+
+static GLenum CapabilityToGL(const RenderCapability& capability) {
+  switch (capability) {
+    case RenderCapability::kCapabilityDepthTest:
+      return GL_DEPTH_TEST;
+    case RenderCapability::kCapabilityCullFace:
+      return GL_CULL_FACE;
+    case RenderCapability::kCapabilityBlend:
+    default:
+      return GL_BLEND;
+  }
+}
+
+template <size_t N>
+static void ResetBindings(unsigned int (&bindings)[N], const unsigned int& value) {
+  std::fill(bindings, bindings + N, value);
+}
+
+template <size_t N, size_t M>
+static void ResetBindings(unsigned int (&bindings)[N][M], const unsigned int& value) {
+  std::fill(&bindings[0][0], &bindings[0][0] + N * M, value);
+}
+
+//Deleted objects fall back to 0 everywhere they were bound
+template <size_t N>
+static void ForgetBinding(unsigned int (&bindings)[N], const unsigned int& object) {
+  std::replace(bindings, bindings + N, object, 0u);
+}
+
+template <size_t N, size_t M>
+static void ForgetBinding(unsigned int (&bindings)[N][M], const unsigned int& object) {
+  std::replace(&bindings[0][0], &bindings[0][0] + N * M, object, 0u);
+}
+
+void RenderState::Initialize() {
+  program_ = 0;
+  vertex_array_ = 0;
+  ResetBindings(buffers_, 0);
+  ResetBindings(uniform_bindings_, 0);
+  active_texture_unit_ = 0;
+  ResetBindings(textures_, 0);
+  ResetBindings(capabilities_, 0);
+}
+
+void RenderState::Invalidate() {
+  program_ = kUnknownState;
+  vertex_array_ = kUnknownState;
+  ResetBindings(buffers_, kUnknownState);
+  ResetBindings(uniform_bindings_, kUnknownState);
+  active_texture_unit_ = kUnknownState;
+  ResetBindings(textures_, kUnknownState);
+  ResetBindings(capabilities_, kUnknownState);
+}
+
+void RenderState::BeginFrame() {
+  last_frame_stats_ = frame_stats_;
+  frame_stats_ = Stats();
+}
+
+RenderState::Stats RenderState::GetStats() {
+  return last_frame_stats_;
+}
+
+bool RenderState::Changed(unsigned int& current, const unsigned int& value) {
+  if (current == value) {
+    ++frame_stats_.elided_;
+    return false;
+  }
+  current = value;
+  ++frame_stats_.issued_;
+  return true;
+}
+
+void RenderState::UseProgram(const unsigned int& program) {
+  if (Changed(program_, program)) {
+    glUseProgram(program);
+  }
+}
+
+void RenderState::BindVertexArray(const unsigned int& vertex_array) {
+  if (Changed(vertex_array_, vertex_array)) {
+    glBindVertexArray(vertex_array);
+    //The index buffer binding belongs to the vertex array
+    buffers_[kBufferSlotElementArray] = kUnknownState;
+  }
+}
+
+void RenderState::BindBuffer(const unsigned int& target, const unsigned int& buffer) {
+  BufferSlot slot = kBufferSlotCount;
+  if (target == GL_ARRAY_BUFFER)
+    slot = kBufferSlotArray;
+  else if (target == GL_ELEMENT_ARRAY_BUFFER)
+    slot = kBufferSlotElementArray;
+  else if (target == GL_UNIFORM_BUFFER)
+    slot = kBufferSlotUniform;
+
+  if (slot == kBufferSlotCount) {
+    ++frame_stats_.issued_;
+    glBindBuffer(target, buffer);
+    return;
+  }
+
+  if (Changed(buffers_[slot], buffer)) {
+    glBindBuffer(target, buffer);
+  }
+}
+
+void RenderState::BindUniformBufferBase(const unsigned int& binding, const unsigned int& buffer) {
+  assert(binding < kMaxUniformBindings && "Uniform binding point out of range");
+
+  if (Changed(uniform_bindings_[binding], buffer)) {
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    //Binding a range also binds the generic target
+    buffers_[kBufferSlotUniform] = buffer;
+  }
+}
+
+void RenderState::BindTexture(const unsigned int& unit, const unsigned int& target, const unsigned int& texture) {
+  assert(unit < kMaxTextureUnits && "Texture unit out of range");
+
+  TextureSlot slot = kTextureSlotCount;
+  if (target == GL_TEXTURE_2D)
+    slot = kTextureSlot2D;
+  else if (target == GL_TEXTURE_2D_ARRAY)
+    slot = kTextureSlot2DArray;
+
+  if (slot != kTextureSlotCount && textures_[unit][slot] == texture) {
+    ++frame_stats_.elided_;
+    return;
+  }
+
+  if (Changed(active_texture_unit_, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+
+  if (slot != kTextureSlotCount) {
+    textures_[unit][slot] = texture;
+  }
+  ++frame_stats_.issued_;
+  glBindTexture(target, texture);
+}
+
+void RenderState::BindTextureToActiveUnit(const unsigned int& target, const unsigned int& texture) {
+  if (active_texture_unit_ == kUnknownState) {
+    active_texture_unit_ = 0;
+    ++frame_stats_.issued_;
+    glActiveTexture(GL_TEXTURE0);
+  }
+  BindTexture(active_texture_unit_, target, texture);
+}
+
+void RenderState::SetCapability(const RenderCapability& capability, const bool& enabled) {
+  if (Changed(capabilities_[static_cast<int>(capability)], enabled ? 1u : 0u)) {
+    if (enabled) {
+      glEnable(CapabilityToGL(capability));
+    } else {
+      glDisable(CapabilityToGL(capability));
+    }
+  }
+}
+
+void RenderState::ForgetProgram(const unsigned int& program) {
+  //A deleted program stays in use until another one replaces it
+  if (program_ == program) {
+    program_ = kUnknownState;
+  }
+}
+
+void RenderState::ForgetVertexArray(const unsigned int& vertex_array) {
+  if (vertex_array_ == vertex_array) {
+    vertex_array_ = 0;
+    buffers_[kBufferSlotElementArray] = kUnknownState;
+  }
+}
+
+void RenderState::ForgetBuffer(const unsigned int& buffer) {
+  //The element binding is per vertex array, only the bound one is reset
+  ForgetBinding(buffers_, buffer);
+  ForgetBinding(uniform_bindings_, buffer);
+}
+
+void RenderState::ForgetTexture(const unsigned int& texture) {
+  ForgetBinding(textures_, texture);
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef RENDER_STATE_H_
+#define RENDER_STATE_H_
+
+enum class RenderCapability {
+  kCapabilityDepthTest,
+  kCapabilityCullFace,
+  kCapabilityBlend,
+  kCapabilityCount,
+};
+
+//Shadows the GL binding state so redundant binds never reach the driver.
+//Every bind in the engine has to go through here, otherwise the shadow goes
+//stale. Main thread only.
+class RenderState {
+public:
+  struct Stats {
+    unsigned int issued_ = 0;
+    unsigned int elided_ = 0;
+  };
+
+  static constexpr unsigned int kMaxTextureUnits = 16;
+  static constexpr unsigned int kMaxUniformBindings = 16;
+
+  //Call once the context is current, assumes the GL defaults
+  static void Initialize();
+  //Forgets everything, the next change of each piece of state is issued.
+  //Needed after code that calls GL directly without restoring what it changed.
+  static void Invalidate();
+
+  //Starts counting a new frame
+  static void BeginFrame();
+  //Counters from the last complete frame
+  static Stats GetStats();
+
+  static void UseProgram(const unsigned int& program);
+  static void BindVertexArray(const unsigned int& vertex_array);
+  //target is a GL buffer target enum
+  static void BindBuffer(const unsigned int& target, const unsigned int& buffer);
+  static void BindUniformBufferBase(const unsigned int& binding, const unsigned int& buffer);
+  //target is a GL texture target enum
+  static void BindTexture(const unsigned int& unit, const unsigned int& target, const unsigned int& texture);
+  //Binds on whichever unit is active, for uploads
+  static void BindTextureToActiveUnit(const unsigned int& target, const unsigned int& texture);
+  static void SetCapability(const RenderCapability& capability, const bool& enabled);
+
+  //Call right before deleting the GL object. Deleting a bound object resets
+  //its bindings to 0, and GL is free to hand the name out again.
+  static void ForgetProgram(const unsigned int& program);
+  static void ForgetVertexArray(const unsigned int& vertex_array);
+  static void ForgetBuffer(const unsigned int& buffer);
+  static void ForgetTexture(const unsigned int& texture);
+private:
+  enum BufferSlot {
+    kBufferSlotArray,
+    kBufferSlotElementArray,
+    kBufferSlotUniform,
+    kBufferSlotCount,
+  };
+
+  enum TextureSlot {
+    kTextureSlot2D,
+    kTextureSlot2DArray,
+    kTextureSlotCount,
+  };
+
+  static bool Changed(unsigned int& current, const unsigned int& value);
+private:
+  static unsigned int program_;
+  static unsigned int vertex_array_;
+  static unsigned int buffers_[kBufferSlotCount];
+  static unsigned int uniform_bindings_[kMaxUniformBindings];
+  static unsigned int active_texture_unit_;
+  static unsigned int textures_[kMaxTextureUnits][kTextureSlotCount];
+  static unsigned int capabilities_[static_cast<int>(RenderCapability::kCapabilityCount)];
+
+  static Stats frame_stats_;
+  static Stats last_frame_stats_;
+};
+
+#endif
\ No newline at end of file
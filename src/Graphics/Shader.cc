@@ -11,6 +11,8 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include "RenderState.h"
+
 static std::tuple<std::string, std::string> LoadGLSL_Source(const std::string& source) {
   std::string file_contents = source; 
 
@@ -38,6 +40,28 @@ static std::tuple<std::string, std::string> LoadGLSL(const std::string_view& fil
   return LoadGLSL_Source(file_contents);
 }
 
+static std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines) {
+  if (defines.empty()) {
+    return source;
+  }
+
+  std::string define_block;
+  for (const std::string& define : defines) {
+    define_block += "#define " + define + "\n";
+  }
+
+  //#version has to stay the first directive
+  size_t version = source.find("#version");
+  size_t insert_at = version != std::string::npos ? source.find('\n', version) : std::string::npos;
+  if (insert_at == std::string::npos) {
+    return define_block + source;
+  }
+
+  std::string result = source;
+  result.insert(insert_at + 1, define_block);
+  return result;
+}
+
 static bool CheckShaderCompileStatus(const unsigned int& shader) {
   int success = 0; 
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -65,7 +89,7 @@ static bool CheckProgramLinkStatus(const unsigned int& program) {
   return true;
 }
 
-Shader::Shader(const char* filename) {
+Shader::Shader(const char* filename, const std::vector<std::string>& defines) {
   program_id_ = glCreateProgram();
   vertex_shader_id_ = glCreateShader(GL_VERTEX_SHADER); 
   fragment_shader_id_ = glCreateShader(GL_FRAGMENT_SHADER);
@@ -75,7 +99,9 @@ Shader::Shader(const char* filename) {
   PLOG_WARNING_IF(!std::filesystem::exists(shader_path)) << "Unable to find " << filename;
   assert(std::filesystem::exists(shader_path) && "Could not find shader file");
 
-  auto [vertex_string, fragment_string] = LoadGLSL(filename); 
+  auto [vertex_source, fragment_source] = LoadGLSL(filename); 
+  std::string vertex_string = InjectDefines(vertex_source, defines);
+  std::string fragment_string = InjectDefines(fragment_source, defines);
   const char* vertex_cstr = vertex_string.c_str();
   const char* fragment_cstr = fragment_string.c_str();
 
@@ -139,40 +165,85 @@ void Shader::LoadSource(const char* glsl_source) {
 
 Shader::~Shader() {
   PLOGD << "Deleted shader";
+  RenderState::ForgetProgram(program_id_);
   glDeleteProgram(program_id_);
 }
 
 void Shader::Bind() {
-  glUseProgram(program_id_);
+  RenderState::UseProgram(program_id_);
 }
 
 void Shader::Unbind() {
-  glUseProgram(0);
+  RenderState::UseProgram(0);
 }
 
-Shader& Shader::LoadUniform(const std::string& uniform) {
-  uniforms_.emplace(std::make_pair(uniform, glGetUniformLocation(program_id_, uniform.c_str())));
-  PLOG_ERROR_IF(uniforms_[uniform] == -1) << "Unable to load: " << uniform;
-  assert(uniforms_[uniform] != -1 && "Unable to load uniform");
+Shader& Shader::LoadUniform(const UniformName& uniform) {
+  int location = glGetUniformLocation(program_id_, uniform.name_);
+  PLOG_ERROR_IF(location == -1) << "Unable to load: " << uniform.name_;
+  assert(location != -1 && "Unable to load uniform");
+
+  for (const LoadedUniform& loaded : uniforms_) {
+    PLOG_ERROR_IF(loaded.hash_ == uniform.hash_ && loaded.location_ != location) << "Uniform name hash collision: " << uniform.name_;
+    assert((loaded.hash_ != uniform.hash_ || loaded.location_ == location) && "Uniform name hash collision");
+  }
+
+  uniforms_.push_back(LoadedUniform { uniform.hash_, location });
   return *this;
 }
 
-void Shader::SetUniform_Int(const std::string& uniform, const int& value) {
-  glUniform1i(uniforms_[uniform], value);
+Shader& Shader::BindUniformBlock(const std::string& block, const unsigned int& binding) {
+  unsigned int index = glGetUniformBlockIndex(program_id_, block.c_str());
+  PLOG_ERROR_IF(index == GL_INVALID_INDEX) << "Unable to find uniform block: " << block;
+  assert(index != GL_INVALID_INDEX && "Unable to find uniform block");
+  glUniformBlockBinding(program_id_, index, binding);
+  return *this;
 }
 
-void Shader::SetUniform_Float(const std::string& uniform, const float& value) {
-  glUniform1f(uniforms_[uniform], value);
+UniformHandle Shader::GetUniform(const UniformName& uniform) const {
+  for (const LoadedUniform& loaded : uniforms_) {
+    if (loaded.hash_ == uniform.hash_) {
+      return UniformHandle { loaded.location_ };
+    }
+  }
+  return UniformHandle();
 }
 
-void Shader::SetUniform_Float2(const std::string& uniform, const float& x, const float& y) {
-  glUniform2f(uniforms_[uniform], x, y);
+void Shader::SetUniform_Int(const UniformHandle& uniform, const int& value) {
+  glUniform1i(uniform.location_, value);
 }
 
-void Shader::SetUniform_Float3(const std::string& uniform, const float& x, const float& y, const float& z) {
-  glUniform3f(uniforms_[uniform], x, y, z);
+void Shader::SetUniform_Float(const UniformHandle& uniform, const float& value) {
+  glUniform1f(uniform.location_, value);
 }
 
-void Shader::SetUniform_Matrix(const std::string& uniform,  const glm::mat4& matrix) {
-  glUniformMatrix4fv(uniforms_[uniform], 1, GL_FALSE, glm::value_ptr(matrix));
+void Shader::SetUniform_Float2(const UniformHandle& uniform, const float& x, const float& y) {
+  glUniform2f(uniform.location_, x, y);
 }
+
+void Shader::SetUniform_Float3(const UniformHandle& uniform, const float& x, const float& y, const float& z) {
+  glUniform3f(uniform.location_, x, y, z);
+}
+
+void Shader::SetUniform_Matrix(const UniformHandle& uniform, const glm::mat4& matrix) {
+  glUniformMatrix4fv(uniform.location_, 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+void Shader::SetUniform_Int(const UniformName& uniform, const int& value) {
+  SetUniform_Int(GetUniform(uniform), value);
+}
+
+void Shader::SetUniform_Float(const UniformName& uniform, const float& value) {
+  SetUniform_Float(GetUniform(uniform), value);
+}
+
+void Shader::SetUniform_Float2(const UniformName& uniform, const float& x, const float& y) {
+  SetUniform_Float2(GetUniform(uniform), x, y);
+}
+
+void Shader::SetUniform_Float3(const UniformName& uniform, const float& x, const float& y, const float& z) {
+  SetUniform_Float3(GetUniform(uniform), x, y, z);
+}
+
+void Shader::SetUniform_Matrix(const UniformName& uniform,  const glm::mat4& matrix) {
+  SetUniform_Matrix(GetUniform(uniform), matrix);
+}
\ No newline at end of file
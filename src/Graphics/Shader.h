@@ -1,14 +1,42 @@
 #ifndef SHADER_H_
 #define SHADER_H_
 
-#include <map>
 #include <glm/mat4x4.hpp>
 #include <string>
+#include <vector>
+
+//FNV-1a, usable at compile time
+constexpr unsigned int HashUniformName(const char* name) {
+  unsigned int hash = 2166136261u;
+  while (*name != '\0') {
+    hash ^= static_cast<unsigned char>(*name++);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+//Uniform name with its hash computed up front. String literals convert
+//implicitly, for hot paths declare them constexpr:
+//  constexpr UniformName kUniformModel("model");
+struct UniformName {
+  const char* name_;
+  unsigned int hash_;
+
+  constexpr UniformName(const char* name) : name_(name), hash_(HashUniformName(name)) {}
+};
+
+//Location resolved once, setters taking a handle go straight to glUniform*
+struct UniformHandle {
+  int location_ = -1;
+
+  bool IsValid() const { return location_ != -1; }
+};
 
 class Shader {
 public:
   Shader() = default;
-  Shader(const char* filename);
+  //Each define is added to both stages as #define <name> right after #version
+  Shader(const char* filename, const std::vector<std::string>& defines = {});
   ~Shader();
 
   void Bind();
@@ -16,19 +44,38 @@ public:
 
   void LoadSource(const char* glsl_source);
 
-  Shader& LoadUniform(const std::string& uniform);
+  Shader& LoadUniform(const UniformName& uniform);
+  //Points a uniform block at one of the binding points in UniformBlocks.h
+  Shader& BindUniformBlock(const std::string& block, const unsigned int& binding);
+  //Invalid when the uniform was never loaded
+  UniformHandle GetUniform(const UniformName& uniform) const;
+
+  void SetUniform_Int(const UniformHandle& uniform, const int& value);
+  void SetUniform_Float(const UniformHandle& uniform, const float& value);
+  void SetUniform_Float2(const UniformHandle& uniform, const float& x, const float& y);
+  void SetUniform_Float3(const UniformHandle& uniform, const float& x, const float& y, const float& z);
+  void SetUniform_Matrix(const UniformHandle& uniform, const glm::mat4& matrix);
 
-  void SetUniform_Int(const std::string& uniform, const int& value);
-  void SetUniform_Float(const std::string& uniform, const float& value);
-  void SetUniform_Float2(const std::string& uniform, const float& x, const float& y);
-  void SetUniform_Float3(const std::string& uniform, const float& x, const float& y, const float& z);
-  void SetUniform_Matrix(const std::string& uniform,  const glm::mat4& matrix);
+  //Convenience overloads, each one searches the loaded uniforms by hash
+  void SetUniform_Int(const UniformName& uniform, const int& value);
+  void SetUniform_Float(const UniformName& uniform, const float& value);
+  void SetUniform_Float2(const UniformName& uniform, const float& x, const float& y);
+  void SetUniform_Float3(const UniformName& uniform, const float& x, const float& y, const float& z);
+  void SetUniform_Matrix(const UniformName& uniform,  const glm::mat4& matrix);
+
+  unsigned int GetId() const { return program_id_; }
 private:
   unsigned int program_id_;
   unsigned int vertex_shader_id_;
   unsigned int fragment_shader_id_;
 
-  std::map<std::string, int> uniforms_;
+  struct LoadedUniform {
+    unsigned int hash_;
+    int location_;
+  };
+
+  //Programs only have a handful of uniforms, a flat array beats any map
+  std::vector<LoadedUniform> uniforms_;
 };
 
 
@@ -0,0 +1,66 @@
+#include "StreamBuffer.h"
+
+#include <glad/glad.h>
+#include <plog/Log.h>
+
+#include <algorithm>
+
+//A region is three frames old by the time it's reused, waiting this long means the GPU is hung
+constexpr GLuint64 kFenceTimeout = 1000000000ull;
+
+StreamBuffer::StreamBuffer(const unsigned long long& region_capacity) : region_capacity_(region_capacity) {
+  buffer_ = std::make_shared<Buffer>(BufferType::kBufferTypeVertex);
+  buffer_->BufferData(region_capacity_ * kRegions, nullptr, BufferUsageType::kBufferDynamic);
+  //Map moves to the next region first, start on the last so the first frame writes region 0
+  region_ = kRegions - 1;
+}
+
+StreamBuffer::~StreamBuffer() {
+  DeleteFences();
+}
+
+void StreamBuffer::DeleteFences() {
+  for (void*& fence : fences_) {
+    if (fence != nullptr) {
+      glDeleteSync(static_cast<GLsync>(fence));
+      fence = nullptr;
+    }
+  }
+}
+
+void* StreamBuffer::Map(const unsigned long long& size, unsigned long long& offset) {
+  buffer_->Bind();
+
+  if (size > region_capacity_) {
+    region_capacity_ = std::max(size, region_capacity_ * 2);
+    PLOGD << "Growing stream buffer to " << region_capacity_ * kRegions << " bytes";
+
+    //Respecifying orphans the old storage, nothing in flight can touch the new one
+    buffer_->BufferData(region_capacity_ * kRegions, nullptr, BufferUsageType::kBufferDynamic);
+    DeleteFences();
+  }
+
+  region_ = (region_ + 1) % kRegions;
+
+  void*& fence = fences_[region_];
+  if (fence != nullptr) {
+    GLenum result = glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeout);
+    PLOG_WARNING_IF(result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) << "Stream buffer fence wait failed";
+    glDeleteSync(static_cast<GLsync>(fence));
+    fence = nullptr;
+  }
+
+  offset = region_ * region_capacity_;
+  return buffer_->MapRange(offset, size, true);
+}
+
+void StreamBuffer::Unmap() {
+  buffer_->Unmap();
+}
+
+void StreamBuffer::Fence() {
+  if (fences_[region_] != nullptr) {
+    glDeleteSync(static_cast<GLsync>(fences_[region_]));
+  }
+  fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
\ No newline at end of file
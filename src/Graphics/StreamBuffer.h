@@ -0,0 +1,37 @@
+#ifndef STREAM_BUFFER_H_
+#define STREAM_BUFFER_H_
+
+#include <memory>
+
+#include "Buffer.h"
+
+//Vertex buffer for data rewritten every frame. It's split into kRegions
+//regions used in turn, each fenced after its draws, so writing one never
+//waits on the GPU still reading the others.
+class StreamBuffer {
+public:
+  static constexpr unsigned int kRegions = 3;
+
+  //region_capacity should be a multiple of the vertex stride
+  StreamBuffer(const unsigned long long& region_capacity);
+  ~StreamBuffer();
+
+  //Maps the next region, growing every region when size doesn't fit. offset
+  //receives where the region starts in the buffer. Leaves the buffer bound.
+  void* Map(const unsigned long long& size, unsigned long long& offset);
+  void Unmap();
+  //Call once the draws reading the mapped region are issued
+  void Fence();
+
+  Buffer& GetBuffer() { return *buffer_; }
+private:
+  void DeleteFences();
+private:
+  std::shared_ptr<Buffer> buffer_;
+  unsigned long long region_capacity_ = 0;
+  unsigned int region_ = 0;
+  //GLsync handles, kept opaque so this header doesn't need glad
+  void* fences_[kRegions] = {};
+};
+
+#endif
\ No newline at end of file
@@ -5,20 +5,42 @@
 
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include "RenderState.h"
+
+//Not in the GL 3.3 core headers, S3TC is an extension
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+static GLenum TextureTypeToGL(const TextureType& type) {
+  if (type == TextureType::kTextureType2DArray)
+    return GL_TEXTURE_2D_ARRAY;
+  return GL_TEXTURE_2D;
+}
 
 Texture::~Texture() {
   PLOGD << "Texture deleted";
+  RenderState::ForgetTexture(texture_);
   glDeleteTextures(1, &texture_);
 }
 
-Texture& Texture::Create() {
+Texture& Texture::Create(const TextureType& type) {
+  type_ = type;
+  const GLenum target = TextureTypeToGL(type_);
+
   glGenTextures(1, &texture_);
-  glBindTexture(GL_TEXTURE_2D, texture_);
+  RenderState::BindTextureToActiveUnit(target, texture_);
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
   PLOGD << "Texture created";
  
@@ -26,7 +48,8 @@ Texture& Texture::Create() {
 }
 
 void Texture::Load(const char* filename, const bool& flip) {
-  glBindTexture(GL_TEXTURE_2D, texture_);
+  assert(type_ == TextureType::kTextureType2D && "Only 2D textures load from files");
+  RenderState::BindTextureToActiveUnit(GL_TEXTURE_2D, texture_);
 
   int width = 0, height = 0, components = 0;
 
@@ -56,13 +79,48 @@ void Texture::Load(const char* filename, const bool& flip) {
   PLOG_DEBUG << "Loaded texture";
 }
 
+bool Texture::LoadCooked(const char* filename) {
+  assert(type_ == TextureType::kTextureType2D && "Only 2D textures load from files");
+
+  CookedTexture cooked;
+  if (!ReadCookedTexture(filename, cooked)) {
+    PLOG_ERROR << "Unable to load cooked texture " << filename;
+    return false;
+  }
+
+  if (!IsTextureFormatSupported(cooked.format_)) {
+    PLOG_ERROR << "Compressed format of " << filename << " is not supported by the driver";
+    return false;
+  }
+
+  RenderState::BindTextureToActiveUnit(GL_TEXTURE_2D, texture_);
+
+  const GLenum internal_format = TextureFormatToGL(cooked.format_);
+  for (size_t level = 0; level < cooked.mips_.size(); ++level) {
+    const GLsizei width = std::max(cooked.width_ >> level, 1);
+    const GLsizei height = std::max(cooked.height_ >> level, 1);
+    const std::vector<unsigned char>& mip = cooked.mips_[level];
+
+    if (IsCompressedFormat(cooked.format_)) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internal_format, width, height, 0, static_cast<GLsizei>(mip.size()), mip.data());
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.data());
+    }
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(cooked.mips_.size() - 1));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+  PLOG_DEBUG << "Loaded cooked texture with " << cooked.mips_.size() << " mips";
+  return true;
+}
+
 void Texture::BindSlot(const int& slot) {
-  glActiveTexture(GL_TEXTURE0 + slot);
-  glBindTexture(GL_TEXTURE_2D, texture_);
+  RenderState::BindTexture(slot, TextureTypeToGL(type_), texture_);
 }
 
 void Texture::Unbind() {
-  glBindTexture(GL_TEXTURE_2D, 0);
+  RenderState::BindTextureToActiveUnit(TextureTypeToGL(type_), 0);
 }
 
 Texture::Texture(const unsigned int& texture) {
@@ -74,3 +132,39 @@ Texture::Texture(const unsigned int& texture) {
 
 
 
+
+
+unsigned int TextureFormatToGL(const TextureFormat& format) {
+  switch (format) {
+    case TextureFormat::kTextureFormatBC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureFormat::kTextureFormatBC3:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureFormat::kTextureFormatBC5:
+      return GL_COMPRESSED_RG_RGTC2;
+    default:
+      return GL_RGBA8;
+  }
+}
+
+bool IsTextureFormatSupported(const TextureFormat& format) {
+  if (format != TextureFormat::kTextureFormatBC1 && format != TextureFormat::kTextureFormatBC3) {
+    return true;
+  }
+
+  //Needs a current context, the answer never changes after the first query
+  static const bool s3tc = []() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+      const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+      if (extension && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0) {
+        return true;
+      }
+    }
+    PLOG_WARNING << "GL_EXT_texture_compression_s3tc not supported, textures stay uncompressed";
+    return false;
+  }();
+
+  return s3tc;
+}
\ No newline at end of file
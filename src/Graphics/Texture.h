@@ -1,18 +1,36 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
+#include "TextureCooker.h"
+
+enum class TextureType {
+  kTextureType2D,
+  kTextureType2DArray,
+};
+
 class Texture {
 public:
   Texture() = default;
   Texture(const unsigned int& texture);
   ~Texture();
 
-  Texture& Create();
+  Texture& Create(const TextureType& type = TextureType::kTextureType2D);
   void Load(const char* filename, const bool& flip);
+  //Uploads every mip of a .rtex file as is, no driver side mip generation
+  bool LoadCooked(const char* filename);
   void BindSlot(const int& slot);
   void Unbind();
+
+  unsigned int GetId() const { return texture_; }
+  TextureType GetType() const { return type_; }
 private:
   unsigned int texture_;
+  TextureType type_ = TextureType::kTextureType2D;
 };
 
+//Internal format a cooked texture uploads as
+unsigned int TextureFormatToGL(const TextureFormat& format);
+//BC1 and BC3 need EXT_texture_compression_s3tc, BC5 is core since GL 3.0
+bool IsTextureFormatSupported(const TextureFormat& format);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,469 @@
+#include "TextureCooker.h"
+
+#include <plog/Log.h>
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+constexpr unsigned int kCookedTextureMagic = 0x58455452; //"RTEX"
+constexpr unsigned int kCookedTextureVersion = 1;
+//Enough for a 2^31 texel edge, anything beyond is a corrupt file
+constexpr unsigned int kMaxCookedMips = 32;
+//Resolution of the linear to sRGB table, finer than 8 bits so averaging doesn't band
+constexpr int kLinearTableSize = 4096;
+
+struct GammaTables {
+  float to_linear_[256];
+  unsigned char to_srgb_[kLinearTableSize];
+
+  GammaTables() {
+    for (int i = 0; i < 256; ++i) {
+      float value = i / 255.f;
+      to_linear_[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < kLinearTableSize; ++i) {
+      float value = i / static_cast<float>(kLinearTableSize - 1);
+      float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+      to_srgb_[i] = static_cast<unsigned char>(std::clamp(srgb * 255.f + 0.5f, 0.f, 255.f));
+    }
+  }
+};
+
+static const GammaTables& GetGammaTables() {
+  static const GammaTables tables;
+  return tables;
+}
+
+static unsigned int BlockBytes(const TextureFormat& format) {
+  return format == TextureFormat::kTextureFormatBC1 ? 8 : 16;
+}
+
+bool IsCompressedFormat(const TextureFormat& format) {
+  return format != TextureFormat::kTextureFormatRGBA8;
+}
+
+size_t GetMipSize(const TextureFormat& format, const int& width, const int& height) {
+  if (!IsCompressedFormat(format)) {
+    return static_cast<size_t>(width) * height * 4;
+  }
+  return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+//Missing channels are filled the way GL fills them on upload, so a cooked
+//texture samples the same as the raw one did
+static std::vector<unsigned char> ExpandToRGBA8(const unsigned char* pixels, const int& width, const int& height, const int& components, const int& bits) {
+  const size_t count = static_cast<size_t>(width) * height;
+  std::vector<unsigned char> rgba(count * 4);
+
+  for (size_t pixel = 0; pixel < count; ++pixel) {
+    unsigned char channels[4] = { 0, 0, 0, 255 };
+    for (int channel = 0; channel < components && channel < 4; ++channel) {
+      size_t index = pixel * components + channel;
+      if (bits == 16) {
+        channels[channel] = static_cast<unsigned char>(reinterpret_cast<const unsigned short*>(pixels)[index] >> 8);
+      } else {
+        channels[channel] = pixels[index];
+      }
+    }
+    std::copy(channels, channels + 4, &rgba[pixel * 4]);
+  }
+
+  return rgba;
+}
+
+//2x2 box filter, odd edges repeat their last texel
+static std::vector<unsigned char> Downsample(const std::vector<unsigned char>& source, const int& width, const int& height, const bool& srgb) {
+  const GammaTables& tables = GetGammaTables();
+  const int mip_width = std::max(width / 2, 1);
+  const int mip_height = std::max(height / 2, 1);
+  std::vector<unsigned char> mip(static_cast<size_t>(mip_width) * mip_height * 4);
+
+  for (int y = 0; y < mip_height; ++y) {
+    const int y0 = std::min(y * 2, height - 1);
+    const int y1 = std::min(y * 2 + 1, height - 1);
+    for (int x = 0; x < mip_width; ++x) {
+      const int x0 = std::min(x * 2, width - 1);
+      const int x1 = std::min(x * 2 + 1, width - 1);
+      const unsigned char* texels[4] = {
+        &source[(static_cast<size_t>(y0) * width + x0) * 4],
+        &source[(static_cast<size_t>(y0) * width + x1) * 4],
+        &source[(static_cast<size_t>(y1) * width + x0) * 4],
+        &source[(static_cast<size_t>(y1) * width + x1) * 4],
+      };
+
+      unsigned char* out = &mip[(static_cast<size_t>(y) * mip_width + x) * 4];
+      for (int channel = 0; channel < 4; ++channel) {
+        //Alpha is coverage, never gamma encoded
+        if (srgb && channel < 3) {
+          float sum = 0.f;
+          for (const unsigned char* texel : texels) {
+            sum += tables.to_linear_[texel[channel]];
+          }
+          out[channel] = tables.to_srgb_[static_cast<int>(sum * 0.25f * (kLinearTableSize - 1) + 0.5f)];
+        } else {
+          unsigned int sum = 0;
+          for (const unsigned char* texel : texels) {
+            sum += texel[channel];
+          }
+          out[channel] = static_cast<unsigned char>((sum + 2) / 4);
+        }
+      }
+    }
+  }
+
+  return mip;
+}
+
+static unsigned short PackRGB565(const float* color) {
+  unsigned int r = static_cast<unsigned int>(std::clamp(color[0], 0.f, 255.f) * 31.f / 255.f + 0.5f);
+  unsigned int g = static_cast<unsigned int>(std::clamp(color[1], 0.f, 255.f) * 63.f / 255.f + 0.5f);
+  unsigned int b = static_cast<unsigned int>(std::clamp(color[2], 0.f, 255.f) * 31.f / 255.f + 0.5f);
+  return static_cast<unsigned short>((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(const unsigned short& packed, int* color) {
+  int r = (packed >> 11) & 31;
+  int g = (packed >> 5) & 63;
+  int b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+static void WriteLittleEndian(unsigned char* out, unsigned long long value, const int& bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out[i] = static_cast<unsigned char>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+//Range fit: endpoints are the extremes of the block projected onto its
+//principal axis, found with a few power iterations on the covariance
+static void CompressBC1Block(const unsigned char* block, unsigned char* out) {
+  float mean[3] = { 0.f, 0.f, 0.f };
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      mean[c] += block[i * 4 + c];
+    }
+  }
+  for (float& value : mean) {
+    value /= 16.f;
+  }
+
+  float covariance[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+  for (int i = 0; i < 16; ++i) {
+    float r = block[i * 4] - mean[0];
+    float g = block[i * 4 + 1] - mean[1];
+    float b = block[i * 4 + 2] - mean[2];
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+
+  float axis[3] = { 1.f, 1.f, 1.f };
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[3] = {
+      covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+      covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+      covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+    };
+    float length = std::max({ std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2]) });
+    if (length < 1e-6f) {
+      break;
+    }
+    for (int c = 0; c < 3; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  float axis_length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  float min_t = 0.f;
+  float max_t = 0.f;
+  for (int i = 0; i < 16; ++i) {
+    float t = 0.f;
+    for (int c = 0; c < 3; ++c) {
+      t += (block[i * 4 + c] - mean[c]) * axis[c];
+    }
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+
+  float endpoint0[3];
+  float endpoint1[3];
+  for (int c = 0; c < 3; ++c) {
+    endpoint0[c] = mean[c] + axis[c] * max_t / axis_length;
+    endpoint1[c] = mean[c] + axis[c] * min_t / axis_length;
+  }
+
+  unsigned short color0 = PackRGB565(endpoint0);
+  unsigned short color1 = PackRGB565(endpoint1);
+  //color0 > color1 selects the four color mode, BC1's punch through alpha mode is never used
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  unsigned int indices = 0;
+  if (color0 != color1) {
+    int palette[4][3];
+    UnpackRGB565(color0, palette[0]);
+    UnpackRGB565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+      int best = 0;
+      int best_distance = 0x7FFFFFFF;
+      for (int entry = 0; entry < 4; ++entry) {
+        int distance = 0;
+        for (int c = 0; c < 3; ++c) {
+          int delta = block[i * 4 + c] - palette[entry][c];
+          distance += delta * delta;
+        }
+        if (distance < best_distance) {
+          best_distance = distance;
+          best = entry;
+        }
+      }
+      indices |= static_cast<unsigned int>(best) << (i * 2);
+    }
+  }
+
+  WriteLittleEndian(out, color0, 2);
+  WriteLittleEndian(out + 2, color1, 2);
+  WriteLittleEndian(out + 4, indices, 4);
+}
+
+//Single channel block, always in the eight value mode. Stride is the
+//distance in bytes between the block's values.
+static void CompressBC4Block(const unsigned char* values, const int& stride, unsigned char* out) {
+  int min_value = 255;
+  int max_value = 0;
+  for (int i = 0; i < 16; ++i) {
+    min_value = std::min<int>(min_value, values[i * stride]);
+    max_value = std::max<int>(max_value, values[i * stride]);
+  }
+
+  unsigned long long indices = 0;
+  if (max_value != min_value) {
+    int palette[8] = { max_value, min_value };
+    for (int entry = 1; entry < 7; ++entry) {
+      palette[entry + 1] = ((7 - entry) * max_value + entry * min_value) / 7;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+      int best = 0;
+      int best_distance = 256;
+      for (int entry = 0; entry < 8; ++entry) {
+        int distance = std::abs(values[i * stride] - palette[entry]);
+        if (distance < best_distance) {
+          best_distance = distance;
+          best = entry;
+        }
+      }
+      indices |= static_cast<unsigned long long>(best) << (i * 3);
+    }
+  }
+
+  out[0] = static_cast<unsigned char>(max_value);
+  out[1] = static_cast<unsigned char>(min_value);
+  WriteLittleEndian(out + 2, indices, 6);
+}
+
+static std::vector<unsigned char> CompressMip(const std::vector<unsigned char>& rgba, const int& width, const int& height, const TextureFormat& format) {
+  std::vector<unsigned char> compressed(GetMipSize(format, width, height));
+  unsigned char* out = compressed.data();
+
+  for (int block_y = 0; block_y < height; block_y += 4) {
+    for (int block_x = 0; block_x < width; block_x += 4) {
+      //Blocks hanging over the edge repeat the last row and column
+      unsigned char block[16 * 4];
+      for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+          size_t source = (static_cast<size_t>(std::min(block_y + y, height - 1)) * width + std::min(block_x + x, width - 1)) * 4;
+          std::copy(&rgba[source], &rgba[source] + 4, &block[(y * 4 + x) * 4]);
+        }
+      }
+
+      if (format == TextureFormat::kTextureFormatBC1) {
+        CompressBC1Block(block, out);
+      } else if (format == TextureFormat::kTextureFormatBC3) {
+        CompressBC4Block(block + 3, 4, out);
+        CompressBC1Block(block, out + 8);
+      } else if (format == TextureFormat::kTextureFormatBC5) {
+        CompressBC4Block(block, 4, out);
+        CompressBC4Block(block + 1, 4, out + 8);
+      }
+      out += BlockBytes(format);
+    }
+  }
+
+  return compressed;
+}
+
+static TextureFormat ChooseFormat(const std::vector<unsigned char>& rgba, const int& components) {
+  if (components == 2) {
+    return TextureFormat::kTextureFormatBC5;
+  }
+
+  if (components == 4) {
+    for (size_t i = 3; i < rgba.size(); i += 4) {
+      if (rgba[i] != 255) {
+        return TextureFormat::kTextureFormatBC3;
+      }
+    }
+  }
+
+  return TextureFormat::kTextureFormatBC1;
+}
+
+CookedTexture CookTexture(const unsigned char* pixels, const int& width, const int& height, const int& components, const int& bits, const TextureCookOptions& options) {
+  assert(pixels && width > 0 && height > 0 && "Nothing to cook");
+
+  std::vector<unsigned char> level = ExpandToRGBA8(pixels, width, height, components, bits);
+
+  CookedTexture texture;
+  texture.format_ = options.enabled_ ? ChooseFormat(level, components) : TextureFormat::kTextureFormatRGBA8;
+  texture.srgb_ = options.srgb_ && texture.format_ != TextureFormat::kTextureFormatBC5;
+  texture.width_ = width;
+  texture.height_ = height;
+
+  int mip_width = width;
+  int mip_height = height;
+  while (true) {
+    if (IsCompressedFormat(texture.format_)) {
+      texture.mips_.push_back(CompressMip(level, mip_width, mip_height, texture.format_));
+    } else {
+      texture.mips_.push_back(level);
+    }
+
+    if (mip_width == 1 && mip_height == 1) {
+      break;
+    }
+
+    level = Downsample(level, mip_width, mip_height, texture.srgb_);
+    mip_width = std::max(mip_width / 2, 1);
+    mip_height = std::max(mip_height / 2, 1);
+  }
+
+  return texture;
+}
+
+bool CookTextureFile(const std::string& source_path, const std::string& cooked_path, const TextureCookOptions& options) {
+  int width = 0, height = 0, components = 0;
+  stbi_set_flip_vertically_on_load(false);
+  unsigned char* data = stbi_load(source_path.c_str(), &width, &height, &components, 0);
+
+  if (!data) {
+    PLOG_ERROR << "Unable to load " << source_path << ": " << stbi_failure_reason();
+    return false;
+  }
+
+  CookedTexture texture = CookTexture(data, width, height, components, 8, options);
+  stbi_image_free(data);
+
+  return WriteCookedTexture(cooked_path, texture);
+}
+
+bool WriteCookedTexture(const std::string& path, const CookedTexture& texture) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+  auto write = [&file](const auto& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+
+  write(kCookedTextureMagic);
+  write(kCookedTextureVersion);
+  write(static_cast<unsigned int>(texture.format_));
+  write(static_cast<unsigned char>(texture.srgb_ ? 1 : 0));
+  write(texture.width_);
+  write(texture.height_);
+  write(static_cast<unsigned int>(texture.mips_.size()));
+  for (const std::vector<unsigned char>& mip : texture.mips_) {
+    write(static_cast<unsigned long long>(mip.size()));
+    file.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+  }
+
+  PLOG_WARNING_IF(!file) << "Unable to write cooked texture: " << path;
+  return static_cast<bool>(file);
+}
+
+//Levels from width x height down to 1x1
+static unsigned int GetMipCount(int width, int height) {
+  unsigned int count = 1;
+  while (width > 1 || height > 1) {
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+    ++count;
+  }
+  return count;
+}
+
+bool ReadCookedTexture(const std::string& path, CookedTexture& texture) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+
+  const unsigned long long file_size = static_cast<unsigned long long>(file.tellg());
+  file.seekg(0, std::ios::beg);
+
+  auto read = [&file](auto& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  };
+
+  unsigned int magic = 0;
+  unsigned int version = 0;
+  unsigned int format = 0;
+  unsigned char srgb = 0;
+  unsigned int mip_count = 0;
+  CookedTexture cooked;
+
+  if (!read(magic) || !read(version) || !read(format) || !read(srgb) || !read(cooked.width_) || !read(cooked.height_) || !read(mip_count)) {
+    return false;
+  }
+
+  if (magic != kCookedTextureMagic || version != kCookedTextureVersion || format > static_cast<unsigned int>(TextureFormat::kTextureFormatBC5)
+    || cooked.width_ <= 0 || cooked.height_ <= 0 || mip_count > kMaxCookedMips || mip_count != GetMipCount(cooked.width_, cooked.height_)) {
+    PLOG_WARNING << "Invalid cooked texture: " << path;
+    return false;
+  }
+
+  cooked.format_ = static_cast<TextureFormat>(format);
+  cooked.srgb_ = srgb != 0;
+  cooked.mips_.resize(mip_count);
+
+  //Sizes are checked against the format and what is left of the file, so a
+  //corrupt header can't request a huge allocation
+  for (unsigned int level = 0; level < mip_count; ++level) {
+    unsigned long long size = 0;
+    const int width = std::max(cooked.width_ >> level, 1);
+    const int height = std::max(cooked.height_ >> level, 1);
+    if (!read(size) || size != GetMipSize(cooked.format_, width, height) || size > file_size - static_cast<unsigned long long>(file.tellg())) {
+      PLOG_WARNING << "Corrupt cooked texture: " << path;
+      return false;
+    }
+
+    cooked.mips_[level].resize(static_cast<size_t>(size));
+    if (!file.read(reinterpret_cast<char*>(cooked.mips_[level].data()), size)) {
+      PLOG_WARNING << "Corrupt cooked texture: " << path;
+      return false;
+    }
+  }
+
+  if (file.peek() != std::ifstream::traits_type::eof()) {
+    PLOG_WARNING << "Corrupt cooked texture: " << path;
+    return false;
+  }
+
+  texture = std::move(cooked);
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef TEXTURE_COOKER_H_
+#define TEXTURE_COOKER_H_
+
+#include <string>
+#include <vector>
+
+//Offline block compression for material textures. Runs entirely on the CPU
+//and touches no GL state, so models are cooked on loader threads and the
+//result is stored in the mesh cache. Mips are generated here instead of by
+//the driver, color textures are downsampled in linear space.
+
+enum class TextureFormat {
+  kTextureFormatRGBA8,
+  //RGB, 4 bits per pixel
+  kTextureFormatBC1,
+  //RGBA, BC1 color plus a BC4 alpha block, 8 bits per pixel
+  kTextureFormatBC3,
+  //Two independent BC4 channels, 8 bits per pixel
+  kTextureFormatBC5,
+};
+
+constexpr const char* kCookedTextureExtension = ".rtex";
+
+struct TextureCookOptions {
+  bool enabled_ = true;
+  //Treat color channels as sRGB when filtering mips. Two channel textures
+  //are always filtered linearly.
+  bool srgb_ = true;
+};
+
+struct CookedTexture {
+  TextureFormat format_ = TextureFormat::kTextureFormatRGBA8;
+  bool srgb_ = false;
+  int width_ = 0;
+  int height_ = 0;
+  //Full chain down to 1x1, mips_[0] is the base level
+  std::vector<std::vector<unsigned char>> mips_;
+};
+
+bool IsCompressedFormat(const TextureFormat& format);
+size_t GetMipSize(const TextureFormat& format, const int& width, const int& height);
+
+//Pixels are tightly packed rows of components 8 or 16 bit channels, the same
+//layout tinygltf and stb_image hand out
+CookedTexture CookTexture(const unsigned char* pixels, const int& width, const int& height, const int& components, const int& bits, const TextureCookOptions& options = TextureCookOptions());
+
+//Cooks an image file (anything stb_image reads) into a .rtex container
+bool CookTextureFile(const std::string& source_path, const std::string& cooked_path, const TextureCookOptions& options = TextureCookOptions());
+
+bool WriteCookedTexture(const std::string& path, const CookedTexture& texture);
+bool ReadCookedTexture(const std::string& path, CookedTexture& texture);
+
+#endif
\ No newline at end of file
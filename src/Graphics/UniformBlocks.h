@@ -0,0 +1,50 @@
+#ifndef UNIFORM_BLOCKS_H_
+#define UNIFORM_BLOCKS_H_
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+
+//Binding points shared by every shader, see Shader::BindUniformBlock
+constexpr unsigned int kFrameUniformBinding = 0;
+constexpr unsigned int kMaterialUniformBinding = 1;
+
+//std140 rules the structs below have to follow: scalars align to 4 bytes,
+//vec2 to 8, vec3/vec4/mat4 columns to 16. A vec3 may share its 16 bytes with
+//one trailing float, otherwise pad it with Std140Vec3.
+constexpr size_t Std140Align(const size_t& offset, const size_t& alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+struct Std140Vec3 {
+  glm::vec3 value_ = glm::vec3(0.f);
+  float padding_ = 0.f;
+};
+
+//layout (std140) uniform FrameData, uploaded once per frame
+struct FrameUniforms {
+  glm::mat4 view_ = glm::mat4(1.f);
+  glm::mat4 projection_ = glm::mat4(1.f);
+  glm::mat4 view_projection_ = glm::mat4(1.f);
+  glm::vec3 camera_position_ = glm::vec3(0.f);
+  float time_ = 0.f;
+};
+
+static_assert(offsetof(FrameUniforms, camera_position_) == Std140Align(3 * sizeof(glm::mat4), 16), "FrameUniforms does not match std140");
+static_assert(offsetof(FrameUniforms, time_) == 204, "FrameUniforms does not match std140");
+static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms does not match std140");
+
+//layout (std140) uniform MaterialData, uploaded once when the material is created
+struct MaterialUniforms {
+  glm::vec4 base_color_ = glm::vec4(1.f);
+  //Layer of the texture array the material's texture lives in
+  int texture_layer_ = 0;
+  int padding_[3] = {};
+};
+
+static_assert(offsetof(MaterialUniforms, texture_layer_) == 16, "MaterialUniforms does not match std140");
+static_assert(sizeof(MaterialUniforms) == 32, "MaterialUniforms does not match std140");
+
+#endif
\ No newline at end of file
@@ -3,30 +3,34 @@
 #include <glad/glad.h>
 #include <plog/Log.h>
 
+#include "RenderState.h"
+
 void VertexArray::Create() {
   glGenVertexArrays(1, &id_);
-  glBindVertexArray(id_);
+  RenderState::BindVertexArray(id_);
 
   PLOGV << "Created vertex array";
 }
 
 VertexArray::~VertexArray() {
   PLOGV << "Destroyed vertex array";
+  RenderState::ForgetVertexArray(id_);
   glDeleteVertexArrays(1, &id_);
 }
 
 void VertexArray::Bind() {
-  glBindVertexArray(id_);
+  RenderState::BindVertexArray(id_);
 }
 
 void VertexArray::Unbind() {
-  glBindVertexArray(0);
+  RenderState::BindVertexArray(0);
 }
 
 void VertexArray::VertexAttribute(const unsigned int& index, const VertexFormat& format, const unsigned long long& stride, void* offset) {
 
   int num_components = 0;
   GLenum type = 0;
+  GLboolean normalized = GL_FALSE;
 
   switch (format) {
     case VertexFormat::kVertexFormatFloat2:
@@ -37,8 +41,44 @@ void VertexArray::VertexAttribute(const unsigned int& index, const VertexFormat&
       type = GL_FLOAT;
       num_components = 3; 
       break;
+    case VertexFormat::kVertexFormatHalf2:
+      type = GL_HALF_FLOAT;
+      num_components = 2;
+      break;
+    case VertexFormat::kVertexFormatShort2:
+      type = GL_SHORT;
+      num_components = 2;
+      break;
+    case VertexFormat::kVertexFormatShort4:
+      type = GL_SHORT;
+      num_components = 4;
+      break;
+    case VertexFormat::kVertexFormatShort2Norm:
+      type = GL_SHORT;
+      num_components = 2;
+      normalized = GL_TRUE;
+      break;
+    case VertexFormat::kVertexFormatUnsignedShort2Norm:
+      type = GL_UNSIGNED_SHORT;
+      num_components = 2;
+      normalized = GL_TRUE;
+      break;
   }
 
-  glVertexAttribPointer(index, num_components, type, GL_FALSE, stride, offset);
+  glVertexAttribPointer(index, num_components, type, normalized, stride, offset);
   glEnableVertexAttribArray(index);
 }
+
+void VertexArray::InstanceAttribute(const unsigned int& index, const VertexFormat& format, const unsigned long long& stride, const unsigned long long& offset) {
+  VertexAttribute(index, format, stride, (void*)offset);
+  glVertexAttribDivisor(index, 1);
+}
+
+void VertexArray::InstanceMatrixAttribute(const unsigned int& index, const unsigned long long& offset) {
+  constexpr GLsizei kMatrixStride = sizeof(float) * 16;
+  for (unsigned int column = 0; column < 4; ++column) {
+    glVertexAttribPointer(index + column, 4, GL_FLOAT, GL_FALSE, kMatrixStride, (void*)(offset + column * sizeof(float) * 4));
+    glEnableVertexAttribArray(index + column);
+    glVertexAttribDivisor(index + column, 1);
+  }
+}
\ No newline at end of file
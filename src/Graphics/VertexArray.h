@@ -4,6 +4,11 @@
 enum class VertexFormat {
   kVertexFormatFloat3,
   kVertexFormatFloat2,
+  kVertexFormatHalf2,
+  kVertexFormatShort2, //Converted to float as is
+  kVertexFormatShort4,
+  kVertexFormatShort2Norm, //Mapped to [-1, 1]
+  kVertexFormatUnsignedShort2Norm, //Mapped to [0, 1]
 };
 
 class VertexArray {
@@ -17,6 +22,13 @@ public:
   void Unbind();
 
   void VertexAttribute(const unsigned int& index, const VertexFormat& format, const unsigned long long& stride, void* offset);
+  //A per instance mat4 taking up locations index to index + 3, read from the
+  //bound array buffer starting at offset
+  void InstanceMatrixAttribute(const unsigned int& index, const unsigned long long& offset);
+  //Same as VertexAttribute, but advancing once per instance
+  void InstanceAttribute(const unsigned int& index, const VertexFormat& format, const unsigned long long& stride, const unsigned long long& offset);
+
+  unsigned int GetId() const { return id_; }
 private:
   unsigned int id_;
 };
@@ -0,0 +1,225 @@
+#include "VertexPacking.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+constexpr float kShortMax = 32767.f;
+constexpr float kUnsignedShortMax = 65535.f;
+
+unsigned short FloatToHalf(const float& value) {
+  unsigned int bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  unsigned int sign = (bits >> 16) & 0x8000u;
+  unsigned int exponent = (bits >> 23) & 0xFFu;
+  unsigned int mantissa = bits & 0x7FFFFFu;
+
+  //NaN and infinity
+  if (exponent == 0xFFu) {
+    return static_cast<unsigned short>(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+  }
+
+  int half_exponent = static_cast<int>(exponent) - 127 + 15;
+
+  //Too large, clamp to infinity
+  if (half_exponent >= 31) {
+    return static_cast<unsigned short>(sign | 0x7C00u);
+  }
+
+  //Denormal or zero
+  if (half_exponent <= 0) {
+    if (half_exponent < -10) {
+      return static_cast<unsigned short>(sign);
+    }
+    mantissa |= 0x800000u;
+    unsigned int shift = static_cast<unsigned int>(14 - half_exponent);
+    unsigned int half_mantissa = mantissa >> shift;
+    //Round to nearest even
+    unsigned int remainder = mantissa & ((1u << shift) - 1u);
+    unsigned int halfway = 1u << (shift - 1u);
+    if (remainder > halfway || (remainder == halfway && (half_mantissa & 1u))) {
+      ++half_mantissa;
+    }
+    return static_cast<unsigned short>(sign | half_mantissa);
+  }
+
+  unsigned int half = sign | (static_cast<unsigned int>(half_exponent) << 10) | (mantissa >> 13);
+  unsigned int remainder = mantissa & 0x1FFFu;
+  //Round to nearest even, a carry into the exponent is still correct
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    ++half;
+  }
+  return static_cast<unsigned short>(half);
+}
+
+float HalfToFloat(const unsigned short& half) {
+  unsigned int sign = (half & 0x8000u) << 16;
+  unsigned int exponent = (half >> 10) & 0x1Fu;
+  unsigned int mantissa = half & 0x3FFu;
+
+  unsigned int bits = 0;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    } else {
+      //Normalize the denormal
+      int shift = 0;
+      while ((mantissa & 0x400u) == 0) {
+        mantissa <<= 1;
+        ++shift;
+      }
+      mantissa &= 0x3FFu;
+      bits = sign | (static_cast<unsigned int>(127 - 15 + 1 - shift) << 23) | (mantissa << 13);
+    }
+  } else if (exponent == 31) {
+    bits = sign | 0x7F800000u | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  }
+
+  float value = 0.f;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static float SignNotZero(const float& value) {
+  return value >= 0.f ? 1.f : -1.f;
+}
+
+glm::vec2 OctahedralEncode(const glm::vec3& normal) {
+  float l1_norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (l1_norm <= 0.f) {
+    return glm::vec2(0.f, 0.f);
+  }
+
+  glm::vec2 encoded(normal.x / l1_norm, normal.y / l1_norm);
+  if (normal.z < 0.f) {
+    encoded = glm::vec2(
+      (1.f - std::abs(encoded.y)) * SignNotZero(encoded.x),
+      (1.f - std::abs(encoded.x)) * SignNotZero(encoded.y)
+    );
+  }
+  return encoded;
+}
+
+glm::vec3 OctahedralDecode(const glm::vec2& encoded) {
+  glm::vec3 normal(encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y));
+  if (normal.z < 0.f) {
+    float x = normal.x;
+    normal.x = (1.f - std::abs(normal.y)) * SignNotZero(x);
+    normal.y = (1.f - std::abs(x)) * SignNotZero(normal.y);
+  }
+  return glm::normalize(normal);
+}
+
+static short QuantizeSigned(const float& value) {
+  float clamped = std::min(std::max(value, -1.f), 1.f);
+  return static_cast<short>(std::lround(clamped * kShortMax));
+}
+
+static unsigned short QuantizeUnsigned(const float& value) {
+  float clamped = std::min(std::max(value, 0.f), 1.f);
+  return static_cast<unsigned short>(std::lround(clamped * kUnsignedShortMax));
+}
+
+static unsigned int GetFormatSize(const VertexFormat& format) {
+  switch (format) {
+    case VertexFormat::kVertexFormatFloat3:
+      return sizeof(float) * 3;
+    case VertexFormat::kVertexFormatFloat2:
+      return sizeof(float) * 2;
+    case VertexFormat::kVertexFormatHalf2:
+    case VertexFormat::kVertexFormatShort2:
+    case VertexFormat::kVertexFormatShort2Norm:
+    case VertexFormat::kVertexFormatUnsignedShort2Norm:
+      return sizeof(short) * 2;
+    case VertexFormat::kVertexFormatShort4:
+      return sizeof(short) * 4;
+  }
+  return 0;
+}
+
+PackedVertices PackVertices(const float* positions, const float* normals, const float* texcoords, const size_t& vertex_count, const VertexPackingOptions& options) {
+  PackedVertices packed;
+  VertexLayout& layout = packed.layout_;
+
+  glm::vec3 min_position(std::numeric_limits<float>::max());
+  glm::vec3 max_position(std::numeric_limits<float>::lowest());
+  bool texcoords_normalized = true;
+
+  for (size_t i = 0; i < vertex_count; ++i) {
+    glm::vec3 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+    min_position = glm::min(min_position, position);
+    max_position = glm::max(max_position, position);
+
+    float u = texcoords[i * 2];
+    float v = texcoords[i * 2 + 1];
+    texcoords_normalized = texcoords_normalized && u >= 0.f && u <= 1.f && v >= 0.f && v <= 1.f;
+  }
+
+  layout.position_format_ = options.quantize_positions_ ? VertexFormat::kVertexFormatShort4 : VertexFormat::kVertexFormatFloat3;
+  layout.normal_format_ = VertexFormat::kVertexFormatShort2;
+  layout.texcoord_format_ = texcoords_normalized ? VertexFormat::kVertexFormatUnsignedShort2Norm : VertexFormat::kVertexFormatHalf2;
+
+  layout.position_offset_ = 0;
+  layout.normal_offset_ = layout.position_offset_ + GetFormatSize(layout.position_format_);
+  layout.texcoord_offset_ = layout.normal_offset_ + GetFormatSize(layout.normal_format_);
+  layout.stride_ = layout.texcoord_offset_ + GetFormatSize(layout.texcoord_format_);
+
+  //Shorts go to the shader unnormalized, so fold the 1/32767 into the scale
+  glm::vec3 half_extent(0.f);
+  if (options.quantize_positions_ && vertex_count > 0) {
+    packed.position_offset_ = (min_position + max_position) * 0.5f;
+    half_extent = glm::max((max_position - min_position) * 0.5f, glm::vec3(1e-6f));
+    packed.position_scale_ = half_extent / kShortMax;
+  }
+
+  packed.data_.resize(static_cast<size_t>(layout.stride_) * vertex_count);
+
+  for (size_t i = 0; i < vertex_count; ++i) {
+    unsigned char* vertex = packed.data_.data() + i * layout.stride_;
+
+    glm::vec3 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+    if (options.quantize_positions_) {
+      glm::vec3 local = (position - packed.position_offset_) / half_extent;
+      short quantized[4] = { QuantizeSigned(local.x), QuantizeSigned(local.y), QuantizeSigned(local.z), 0 };
+      std::memcpy(vertex + layout.position_offset_, quantized, sizeof(quantized));
+    } else {
+      std::memcpy(vertex + layout.position_offset_, &positions[i * 3], sizeof(float) * 3);
+    }
+
+    glm::vec2 octahedral = OctahedralEncode(glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]));
+    short normal[2] = { QuantizeSigned(octahedral.x), QuantizeSigned(octahedral.y) };
+    std::memcpy(vertex + layout.normal_offset_, normal, sizeof(normal));
+
+    if (texcoords_normalized) {
+      unsigned short texcoord[2] = { QuantizeUnsigned(texcoords[i * 2]), QuantizeUnsigned(texcoords[i * 2 + 1]) };
+      std::memcpy(vertex + layout.texcoord_offset_, texcoord, sizeof(texcoord));
+    } else {
+      unsigned short texcoord[2] = { FloatToHalf(texcoords[i * 2]), FloatToHalf(texcoords[i * 2 + 1]) };
+      std::memcpy(vertex + layout.texcoord_offset_, texcoord, sizeof(texcoord));
+    }
+  }
+
+  return packed;
+}
+
+glm::vec3 UnpackPosition(const unsigned char* vertex, const VertexLayout& layout, const glm::vec3& scale, const glm::vec3& offset) {
+  if (layout.position_format_ == VertexFormat::kVertexFormatShort4) {
+    short quantized[4];
+    std::memcpy(quantized, vertex + layout.position_offset_, sizeof(quantized));
+    return glm::vec3(static_cast<float>(quantized[0]), static_cast<float>(quantized[1]), static_cast<float>(quantized[2])) * scale + offset;
+  }
+
+  float position[3];
+  std::memcpy(position, vertex + layout.position_offset_, sizeof(position));
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+glm::vec3 UnpackPosition(const PackedVertices& vertices, const size_t& index) {
+  return UnpackPosition(vertices.data_.data() + index * vertices.layout_.stride_, vertices.layout_, vertices.position_scale_, vertices.position_offset_);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef VERTEX_PACKING_H_
+#define VERTEX_PACKING_H_
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <vector>
+
+#include "VertexArray.h"
+
+//Interleaved vertex layout produced by PackVertices. Normals are always
+//octahedral encoded into two shorts, texcoords are unorm16 when they fit in
+//[0, 1] and half floats otherwise. Positions stay float3 unless quantized, in
+//which case they are shorts relative to the mesh bounds and the shader
+//rebuilds them with position * position_scale_ + position_offset_.
+struct VertexLayout {
+  unsigned int stride_ = 0;
+
+  VertexFormat position_format_ = VertexFormat::kVertexFormatFloat3;
+  unsigned int position_offset_ = 0;
+
+  VertexFormat normal_format_ = VertexFormat::kVertexFormatShort2;
+  unsigned int normal_offset_ = 0;
+
+  VertexFormat texcoord_format_ = VertexFormat::kVertexFormatHalf2;
+  unsigned int texcoord_offset_ = 0;
+};
+
+struct VertexPackingOptions {
+  bool quantize_positions_ = false;
+};
+
+struct PackedVertices {
+  VertexLayout layout_;
+  glm::vec3 position_scale_ = glm::vec3(1.f);
+  glm::vec3 position_offset_ = glm::vec3(0.f);
+  std::vector<unsigned char> data_;
+};
+
+unsigned short FloatToHalf(const float& value);
+float HalfToFloat(const unsigned short& half);
+
+//Unit vector to octahedral coordinates in [-1, 1]
+glm::vec2 OctahedralEncode(const glm::vec3& normal);
+glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+
+//Expects tightly packed float3 positions and normals and float2 texcoords
+PackedVertices PackVertices(const float* positions, const float* normals, const float* texcoords, const size_t& vertex_count, const VertexPackingOptions& options);
+
+//Float position of a vertex in a packed buffer, for CPU side passes
+glm::vec3 UnpackPosition(const PackedVertices& vertices, const size_t& index);
+glm::vec3 UnpackPosition(const unsigned char* vertex, const VertexLayout& layout, const glm::vec3& scale, const glm::vec3& offset);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "LevelCollision.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <plog/Log.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include "../Graphics/MeshCache.h"
+#include "../Graphics/VertexPacking.h"
+
+#include "PhysicsMath.h"
+
+constexpr unsigned int kCollisionCacheMagic = 0x4C4F4352; //"RCOL"
+constexpr unsigned int kCollisionCacheVersion = 1;
+
+static glm::mat4 TransformToMatrix(const TransformComponent& transform) {
+  glm::mat4 matrix(1.0);
+  matrix = glm::translate(matrix, transform.position_);
+  matrix = matrix * glm::mat4(transform.rotation_);
+  matrix = glm::scale(matrix, transform.scale_);
+  return matrix;
+}
+
+static unsigned int ReadIndex(const PrimitiveData& primitive, const size_t& index) {
+  const unsigned char* indices = primitive.indices_.data_;
+  if (primitive.component_type_ == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+    return indices[index];
+  }
+  if (primitive.component_type_ == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+    unsigned short value;
+    std::memcpy(&value, indices + index * sizeof(value), sizeof(value));
+    return value;
+  }
+
+  unsigned int value;
+  std::memcpy(&value, indices + index * sizeof(value), sizeof(value));
+  return value;
+}
+
+LevelCollision::~LevelCollision() {
+  //Bodies leave the world before the shapes and arrays they use are freed
+  for (const std::shared_ptr<btRigidBody>& body : bodies_) {
+    world_->RemoveRigidBody(body);
+  }
+  btAlignedFree(bvh_buffer_);
+}
+
+void LevelCollision::AddStaticBody(PhysicsWorld& world, const std::shared_ptr<btCollisionShape>& shape) {
+  assert((!world_ || world_ == &world) && "Level collision already belongs to another world");
+  world_ = &world;
+
+  //Static bodies never move, so they don't need a motion state
+  btRigidBody::btRigidBodyConstructionInfo construction_info(0.f, nullptr, shape.get());
+  std::shared_ptr<btRigidBody> body = std::make_shared<btRigidBody>(construction_info);
+
+  world.AddRigidBody(body, shape);
+  bodies_.push_back(body);
+}
+
+void LevelCollision::AddColliders(PhysicsWorld& world, const std::vector<MapLoader::Collider>& colliders) {
+  if (colliders.empty()) {
+    return;
+  }
+
+  std::shared_ptr<btCompoundShape> compound = std::make_shared<btCompoundShape>(true, static_cast<int>(colliders.size()));
+
+  for (const MapLoader::Collider& collider : colliders) {
+    assert(collider.type_ == MapLoader::CollisionType::kBoxType && "Unsupported collider type");
+
+    //Levels reuse a handful of box sizes, the world hands out shared shapes.
+    //Children are raw pointers, so the level holds a reference to each one.
+    std::shared_ptr<btBoxShape> box = world.AcquireBoxShape(collider.size_);
+    child_shapes_.push_back(box);
+
+    btTransform child_transform(GLM_To_BT_Quaternion(collider.rotation_), GLM_To_BT_Vec3(collider.position_));
+    compound->addChildShape(child_transform, box.get());
+  }
+
+  //Shared shapes show up once per collider, keep a single reference each
+  std::sort(child_shapes_.begin(), child_shapes_.end());
+  child_shapes_.erase(std::unique(child_shapes_.begin(), child_shapes_.end()), child_shapes_.end());
+
+  AddStaticBody(world, compound);
+  collider_count_ += colliders.size();
+
+  PLOGD << "Baked " << colliders.size() << " colliders into one compound shape";
+}
+
+bool LevelCollision::AddRenderMesh(PhysicsWorld& world, Model& model, const std::string& cache_path, const glm::mat4& transform) {
+  assert(!mesh_shape_ && "Render mesh already added");
+
+  for (const Mesh& mesh : model.GetMeshes()) {
+    const glm::mat4 mesh_transform = transform * TransformToMatrix(mesh.local_transform_);
+
+    for (const PrimitiveData& primitive : mesh.primitives_) {
+      if (primitive.draw_mode_ != TINYGLTF_MODE_TRIANGLES) {
+        continue;
+      }
+
+      const int first_vertex = static_cast<int>(vertices_.size() / 3);
+      for (int vertex = 0; vertex < primitive.vertex_count_; ++vertex) {
+        const unsigned char* packed = primitive.vertices_.data_ + static_cast<size_t>(vertex) * primitive.layout_.stride_;
+        glm::vec3 position = glm::vec3(mesh_transform * glm::vec4(UnpackPosition(packed, primitive.layout_, primitive.position_scale_, primitive.position_offset_), 1.f));
+        vertices_.insert(vertices_.end(), { position.x, position.y, position.z });
+      }
+
+      //Full detail level only
+      size_t index_offset = primitive.lods_.empty() ? 0 : primitive.lods_[0].index_offset_;
+      size_t index_count = primitive.lods_.empty() ? static_cast<size_t>(primitive.indices_count_) : primitive.lods_[0].index_count_;
+      for (size_t index = index_offset; index < index_offset + index_count; ++index) {
+        indices_.push_back(first_vertex + static_cast<int>(ReadIndex(primitive, index)));
+      }
+    }
+  }
+
+  if (indices_.empty()) {
+    PLOG_WARNING << "Model has no triangles to collide with";
+    return false;
+  }
+
+  mesh_interface_ = std::make_unique<btTriangleIndexVertexArray>(static_cast<int>(indices_.size() / 3), indices_.data(), static_cast<int>(3 * sizeof(int)),
+    static_cast<int>(vertices_.size() / 3), vertices_.data(), static_cast<int>(3 * sizeof(float)));
+
+  unsigned long long hash = HashBytes(reinterpret_cast<const unsigned char*>(vertices_.data()), vertices_.size() * sizeof(float));
+  hash ^= HashBytes(reinterpret_cast<const unsigned char*>(indices_.data()), indices_.size() * sizeof(int));
+
+  btOptimizedBvh* bvh = nullptr;
+  if (LoadBvh(cache_path, hash)) {
+    //Null when the buffer is too small for the tree its header describes
+    bvh = btOptimizedBvh::deSerializeInPlace(bvh_buffer_, static_cast<unsigned int>(bvh_buffer_size_), false);
+    if (!bvh) {
+      PLOG_WARNING << "Corrupt collision cache: " << cache_path;
+      btAlignedFree(bvh_buffer_);
+      bvh_buffer_ = nullptr;
+      bvh_buffer_size_ = 0;
+    }
+  }
+
+  if (bvh) {
+    mesh_shape_ = std::make_shared<btBvhTriangleMeshShape>(mesh_interface_.get(), true, false);
+    mesh_shape_->setOptimizedBvh(bvh);
+    PLOGD << "Loaded collision BVH from " << cache_path;
+  } else {
+    mesh_shape_ = std::make_shared<btBvhTriangleMeshShape>(mesh_interface_.get(), true, true);
+    SaveBvh(cache_path, hash);
+  }
+
+  AddStaticBody(world, mesh_shape_);
+
+  PLOGD << "Baked " << GetTriangleCount() << " triangles into one mesh shape";
+  return true;
+}
+
+bool LevelCollision::LoadBvh(const std::string& cache_path, const unsigned long long& hash) {
+  std::ifstream file(cache_path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+
+  const std::streamoff file_size = file.tellg();
+  file.seekg(0, std::ios::beg);
+
+  unsigned int magic = 0;
+  unsigned int version = 0;
+  unsigned long long cached_hash = 0;
+  unsigned int size = 0;
+
+  auto read = [&file](auto& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  };
+
+  if (!read(magic) || !read(version) || !read(cached_hash) || !read(size)) {
+    return false;
+  }
+
+  if (magic != kCollisionCacheMagic || version != kCollisionCacheVersion || cached_hash != hash) {
+    PLOGD << "Collision cache out of date: " << cache_path;
+    return false;
+  }
+
+  //The tree has to at least hold its header and fill the rest of the file,
+  //deSerializeInPlace reads the header before checking anything
+  if (size < sizeof(btQuantizedBvh) || static_cast<std::streamoff>(size) != file_size - file.tellg()) {
+    PLOG_WARNING << "Corrupt collision cache: " << cache_path;
+    return false;
+  }
+
+  void* buffer = btAlignedAlloc(size, 16);
+  if (!file.read(static_cast<char*>(buffer), size)) {
+    PLOG_WARNING << "Corrupt collision cache: " << cache_path;
+    btAlignedFree(buffer);
+    return false;
+  }
+
+  btAlignedFree(bvh_buffer_);
+  bvh_buffer_ = buffer;
+  bvh_buffer_size_ = size;
+  return true;
+}
+
+void LevelCollision::SaveBvh(const std::string& cache_path, const unsigned long long& hash) {
+  const btOptimizedBvh* bvh = mesh_shape_->getOptimizedBvh();
+  const unsigned int size = bvh->calculateSerializeBufferSize();
+
+  void* buffer = btAlignedAlloc(size, 16);
+  bvh->serializeInPlace(buffer, size, false);
+
+  std::ofstream file(cache_path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&kCollisionCacheMagic), sizeof(kCollisionCacheMagic));
+  file.write(reinterpret_cast<const char*>(&kCollisionCacheVersion), sizeof(kCollisionCacheVersion));
+  file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+  file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  file.write(static_cast<const char*>(buffer), size);
+  btAlignedFree(buffer);
+
+  PLOG_WARNING_IF(!file) << "Unable to write collision cache: " << cache_path;
+  PLOGD_IF(file) << "Wrote collision cache: " << cache_path << " (" << size << " bytes)";
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef LEVEL_COLLISION_H_
+#define LEVEL_COLLISION_H_
+
+#include <btBulletDynamicsCommon.h>
+#include <glm/mat4x4.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Core/MapLoader.h"
+#include "../Graphics/ModelLoader.h"
+
+#include "PhysicsWorld.h"
+
+constexpr const char* kCollisionCacheExtension = ".rcol";
+
+//Bakes a level's static collision into single bodies instead of one body per
+//collider. Every collider from the level JSON goes into one btCompoundShape,
+//which keeps its own dynamic AABB tree, and the render mesh can become one
+//btBvhTriangleMeshShape. Either way the broadphase only sees one proxy.
+//The bodies point into shapes and arrays owned here, so they are removed from
+//the world on destruction. The world has to outlive this.
+class LevelCollision {
+public:
+  LevelCollision() = default;
+  LevelCollision(const LevelCollision&) = delete;
+  LevelCollision& operator=(const LevelCollision&) = delete;
+  ~LevelCollision();
+
+  void AddColliders(PhysicsWorld& world, const std::vector<MapLoader::Collider>& colliders);
+  //Triangle primitives only. The quantized BVH is cached in cache_path and
+  //rebuilt whenever the triangles change.
+  bool AddRenderMesh(PhysicsWorld& world, Model& model, const std::string& cache_path, const glm::mat4& transform = glm::mat4(1.f));
+
+  size_t GetColliderCount() const { return collider_count_; }
+  size_t GetTriangleCount() const { return indices_.size() / 3; }
+private:
+  void AddStaticBody(PhysicsWorld& world, const std::shared_ptr<btCollisionShape>& shape);
+  bool LoadBvh(const std::string& cache_path, const unsigned long long& hash);
+  void SaveBvh(const std::string& cache_path, const unsigned long long& hash);
+private:
+  size_t collider_count_ = 0;
+
+  PhysicsWorld* world_ = nullptr;
+  std::vector<std::shared_ptr<btRigidBody>> bodies_;
+  //One reference per distinct compound child, released with the bodies
+  std::vector<std::shared_ptr<btCollisionShape>> child_shapes_;
+
+  std::vector<float> vertices_;
+  std::vector<int> indices_;
+  std::unique_ptr<btTriangleIndexVertexArray> mesh_interface_;
+  std::shared_ptr<btBvhTriangleMeshShape> mesh_shape_;
+  //16 byte aligned, the cached BVH is deserialized in place
+  void* bvh_buffer_ = nullptr;
+  size_t bvh_buffer_size_ = 0;
+};
+
+#endif
\ No newline at end of file
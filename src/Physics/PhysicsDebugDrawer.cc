@@ -4,11 +4,16 @@
 #include "../Graphics/DebugDrawer.h"
 #include "PhysicsMath.h"
 
+constexpr float kContactNormalLength = 0.25f;
+
 void PhysicsDebugDrawer::drawLine(const btVector3& from, const btVector3& to, const btVector3& color) {
   DebugDrawer::CreateLine(BT_To_GLM_Vec3(from), BT_To_GLM_Vec3(to), BT_To_GLM_Vec3(color));
 }
 
 void PhysicsDebugDrawer::drawContactPoint(const btVector3& PointOnB, const btVector3& normalOnB, btScalar distance, int lifeTime, const btVector3& color) {
+  glm::vec3 point = BT_To_GLM_Vec3(PointOnB);
+  //Kept until the next step redraws the contacts, see clearLines
+  DebugDrawer::CreateArrow(point, point + BT_To_GLM_Vec3(normalOnB) * kContactNormalLength, BT_To_GLM_Vec3(color), kDebugLifetimeForever);
 }
 
 void PhysicsDebugDrawer::reportErrorWarning(const char* warningString) {
@@ -27,8 +32,10 @@ int PhysicsDebugDrawer::getDebugMode() const {
   return debug_mode_;
 }
 
+//Called at the start of every debug draw, contact arrows go with the lines
 void PhysicsDebugDrawer::clearLines() {
   DebugDrawer::FlushLines();
+  DebugDrawer::FlushShapes(DebugDrawer::Shape::kShapeArrow);
 }
 
 
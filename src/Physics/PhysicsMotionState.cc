@@ -0,0 +1,31 @@
+#include "PhysicsMotionState.h"
+
+#include "PhysicsWorld.h"
+
+PhysicsMotionState::PhysicsMotionState(PhysicsWorld& world, const btTransform& start_transform, const unsigned int& user_index) 
+  : world_(world), previous_(start_transform), current_(start_transform), user_index_(user_index) {
+}
+
+void PhysicsMotionState::getWorldTransform(btTransform& world_transform) const {
+  world_transform = current_;
+}
+
+//Called by Bullet during stepSimulation, once per active body
+void PhysicsMotionState::setWorldTransform(const btTransform& world_transform) {
+  previous_ = current_;
+
+  //Bodies about to fall asleep are still active but no longer moving
+  if (world_transform == current_) {
+    return;
+  }
+
+  current_ = world_transform;
+  world_.OnBodyMoved(*this);
+}
+
+btTransform PhysicsMotionState::GetInterpolatedTransform(const float& alpha) const {
+  btTransform transform;
+  transform.setOrigin(previous_.getOrigin().lerp(current_.getOrigin(), alpha));
+  transform.setRotation(previous_.getRotation().slerp(current_.getRotation(), alpha));
+  return transform;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef PHYSICS_MOTION_STATE_H_
+#define PHYSICS_MOTION_STATE_H_
+
+#include <bullet/LinearMath/btMotionState.h>
+#include <bullet/LinearMath/btTransform.h>
+
+class PhysicsWorld;
+
+//Keeps the transforms of the last two fixed steps and tells its world when
+//Bullet moves the body. Bullet only writes active bodies, so sleeping and
+//static ones never show up in the world's moved list.
+class PhysicsMotionState : public btMotionState {
+public:
+  PhysicsMotionState(PhysicsWorld& world, const btTransform& start_transform, const unsigned int& user_index);
+
+  void getWorldTransform(btTransform& world_transform) const override;
+  void setWorldTransform(const btTransform& world_transform) override;
+
+  //alpha 0 is the previous step, 1 the latest one
+  btTransform GetInterpolatedTransform(const float& alpha) const;
+  const btTransform& GetTransform() const { return current_; }
+  //Whatever the owner needs to find its way back, usually an entity
+  unsigned int GetUserIndex() const { return user_index_; }
+private:
+  friend class PhysicsWorld;
+
+  PhysicsWorld& world_;
+  btTransform previous_;
+  btTransform current_;
+  unsigned int user_index_;
+  //Last step that changed the transform
+  unsigned int moved_step_ = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef PHYSICS_QUERY_H_
+#define PHYSICS_QUERY_H_
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class btCollisionObject;
+
+//Batched world queries, see PhysicsWorld::RayCastBatch and friends. Results
+//are written to the same index as their query.
+
+enum class QueryShape {
+  kQueryShapeSphere,
+  kQueryShapeBox,
+};
+
+struct RayQuery {
+  glm::vec3 from_ = glm::vec3(0.f);
+  glm::vec3 to_ = glm::vec3(0.f);
+};
+
+//Spheres use half_extents_.x as their radius
+struct SweepQuery {
+  QueryShape shape_ = QueryShape::kQueryShapeSphere;
+  glm::vec3 half_extents_ = glm::vec3(0.5f);
+  glm::quat rotation_ = glm::quat(1.f, 0.f, 0.f, 0.f);
+  glm::vec3 from_ = glm::vec3(0.f);
+  glm::vec3 to_ = glm::vec3(0.f);
+};
+
+struct OverlapQuery {
+  QueryShape shape_ = QueryShape::kQueryShapeSphere;
+  glm::vec3 half_extents_ = glm::vec3(0.5f);
+  glm::quat rotation_ = glm::quat(1.f, 0.f, 0.f, 0.f);
+  glm::vec3 position_ = glm::vec3(0.f);
+};
+
+//Closest hit along a ray or sweep
+struct QueryHit {
+  const btCollisionObject* object_ = nullptr;
+  //The object's user index, RigidBodyComponent stores its entity there. -1 for level collision.
+  int user_index_ = -1;
+  //Distance along the query, 1 when nothing was hit
+  float fraction_ = 1.f;
+  glm::vec3 point_ = glm::vec3(0.f);
+  glm::vec3 normal_ = glm::vec3(0.f);
+
+  bool IsHit() const { return object_ != nullptr; }
+};
+
+struct OverlapHit {
+  //First object found, nullptr when nothing overlaps
+  const btCollisionObject* object_ = nullptr;
+  int user_index_ = -1;
+  //Distinct objects overlapping the query shape
+  unsigned int count_ = 0;
+
+  bool IsHit() const { return count_ != 0; }
+};
+
+#endif
\ No newline at end of file
@@ -1,23 +1,152 @@
 #include "PhysicsWorld.h"
 
+#if BT_THREADSAFE
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#endif
 #include <plog/Log.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+
+#include "../Core/JobSystem.h"
+
 #include "PhysicsMath.h"
 
-PhysicsWorld::PhysicsWorld() {
-  physics_config_ = std::make_shared<btDefaultCollisionConfiguration>();
-  physics_dispatcher_ = std::make_shared<btCollisionDispatcher>(physics_config_.get());
+#if BT_THREADSAFE
+//Bullet's count of running parallel loops, kept so its solver doesn't nest
+//them. Exported by LinearMath but missing from btThreads.h.
+void btPushThreadsAreRunning();
+void btPopThreadsAreRunning();
+
+//Runs Bullet's parallel loops on the job system instead of a second pool of threads
+class JobTaskScheduler : public btITaskScheduler {
+public:
+  JobTaskScheduler() : btITaskScheduler("JobSystem") {}
+
+  int getMaxNumThreads() const override {
+    return static_cast<int>(JobSystem::GetWorkerCount()) + 1;
+  }
+
+  //Bullet sizes its per thread arrays with this and any worker may pick up a
+  //chunk, so it can't be lowered
+  int getNumThreads() const override {
+    return getMaxNumThreads();
+  }
+
+  void setNumThreads(int) override {}
+
+  void parallelFor(int begin, int end, int grain_size, const btIParallelForBody& body) override {
+    ++parallel_for_count_;
+    btPushThreadsAreRunning();
+    JobSystem::ParallelFor(static_cast<size_t>(end - begin), static_cast<size_t>(grain_size), [begin, &body](size_t chunk_begin, size_t chunk_end) {
+      body.forLoop(begin + static_cast<int>(chunk_begin), begin + static_cast<int>(chunk_end));
+    });
+    btPopThreadsAreRunning();
+  }
+
+  btScalar parallelSum(int begin, int end, int grain_size, const btIParallelSumBody& body) override {
+    btScalar sum = 0.f;
+    std::mutex sum_mutex;
+
+    btPushThreadsAreRunning();
+    JobSystem::ParallelFor(static_cast<size_t>(end - begin), static_cast<size_t>(grain_size), [begin, &body, &sum, &sum_mutex](size_t chunk_begin, size_t chunk_end) {
+      btScalar chunk_sum = body.sumLoop(begin + static_cast<int>(chunk_begin), begin + static_cast<int>(chunk_end));
+      std::lock_guard<std::mutex> lock(sum_mutex);
+      sum += chunk_sum;
+    });
+    btPopThreadsAreRunning();
+
+    return sum;
+  }
+
+  unsigned int GetParallelForCount() const { return parallel_for_count_; }
+private:
+  std::atomic<unsigned int> parallel_for_count_ { 0 };
+};
+
+//Bullet keeps a single global scheduler, shared by every parallel world
+static JobTaskScheduler& GetJobTaskScheduler() {
+  static JobTaskScheduler scheduler;
+  return scheduler;
+}
+
+//Libraries built without BT_THREADSAFE run btParallelFor inline and never
+//reach the scheduler, which is the only sign of a mismatched build
+static bool IsBulletThreadSafe() {
+  struct EmptyBody : public btIParallelForBody {
+    void forLoop(int, int) const override {}
+  };
+
+  const unsigned int count = GetJobTaskScheduler().GetParallelForCount();
+  btParallelFor(0, 1, 1, EmptyBody());
+  return GetJobTaskScheduler().GetParallelForCount() != count;
+}
+#endif
+
+PhysicsWorld::PhysicsWorld(const PhysicsBackend& backend) : backend_(backend) {
   physics_broadphase_ = std::make_shared<btDbvtBroadphase>();
-  physics_solver_ = std::make_shared<btSequentialImpulseConstraintSolver>();
-  physics_world_ = std::make_shared<btDiscreteDynamicsWorld>(physics_dispatcher_.get(), physics_broadphase_.get(), physics_solver_.get(), physics_config_.get());
+
+#if BT_THREADSAFE
+  if (backend_ == PhysicsBackend::kPhysicsBackendParallel && JobSystem::GetWorkerCount() + 1 > BT_MAX_THREAD_COUNT) {
+    PLOG_WARNING << "Too many job workers for Bullet, falling back to sequential physics";
+    backend_ = PhysicsBackend::kPhysicsBackendSequential;
+  }
+
+  if (backend_ == PhysicsBackend::kPhysicsBackendParallel) {
+    //Has to be set from the main thread before any Mt object is created, the
+    //first thread to ask Bullet for its index becomes its main thread
+    btSetTaskScheduler(&GetJobTaskScheduler());
+
+    if (!IsBulletThreadSafe()) {
+      PLOG_ERROR << "Bullet libraries were built without BT_THREADSAFE=1, rebuild them or build without --bullet-threadsafe";
+      assert(false && "Bullet libraries were built without BT_THREADSAFE=1");
+      backend_ = PhysicsBackend::kPhysicsBackendSequential;
+    }
+  }
+
+  if (backend_ == PhysicsBackend::kPhysicsBackendParallel) {
+    //Workers allocate manifolds and collision algorithms concurrently, so
+    //start with pools big enough to avoid falling back to the heap
+    btDefaultCollisionConstructionInfo construction_info;
+    construction_info.m_defaultMaxPersistentManifoldPoolSize = 80000;
+    construction_info.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+    physics_config_ = std::make_shared<btDefaultCollisionConfiguration>(construction_info);
+
+    physics_dispatcher_ = std::make_shared<btCollisionDispatcherMt>(physics_config_.get());
+    std::shared_ptr<btConstraintSolverPoolMt> solver_pool = std::make_shared<btConstraintSolverPoolMt>(GetJobTaskScheduler().getNumThreads());
+    physics_solver_mt_ = std::make_shared<btSequentialImpulseConstraintSolverMt>();
+    physics_solver_ = solver_pool;
+    physics_world_ = std::make_shared<btDiscreteDynamicsWorldMt>(physics_dispatcher_.get(), physics_broadphase_.get(), solver_pool.get(), physics_solver_mt_.get(), physics_config_.get());
+  }
+#endif
+
+  if (backend_ == PhysicsBackend::kPhysicsBackendSequential) {
+    physics_config_ = std::make_shared<btDefaultCollisionConfiguration>();
+    physics_dispatcher_ = std::make_shared<btCollisionDispatcher>(physics_config_.get());
+    physics_solver_ = std::make_shared<btSequentialImpulseConstraintSolver>();
+    physics_world_ = std::make_shared<btDiscreteDynamicsWorld>(physics_dispatcher_.get(), physics_broadphase_.get(), physics_solver_.get(), physics_config_.get());
+  }
 
   physics_world_->setGravity(btVector3(0.f, -9.81f, 0.f));
   physics_world_->setDebugDrawer(&debug_drawer_);
 
-  PLOGD << "Physics World created";
+  PLOGD << "Physics World created (" << (backend_ == PhysicsBackend::kPhysicsBackendSequential ? "sequential" : "parallel") << ")";
 }
 
 PhysicsWorld::~PhysicsWorld() {
+  //The Bullet world is destroyed after the vectors owning its bodies, and its
+  //destructor still walks every collision object it holds
+  for (const RigidBody& rigid_body : rigid_bodies_) {
+    physics_world_->removeRigidBody(rigid_body.body_.get());
+  }
+
   PLOGD << "Physics world destroyed";
 }
 
@@ -29,16 +158,129 @@ void PhysicsWorld::AddMotionState(const std::shared_ptr<btMotionState>& motion_s
   motion_states_.push_back(motion_state);
 }
 
-void PhysicsWorld::AddRigidBody(const std::shared_ptr<btRigidBody>& body) {
-  rigid_bodies_.push_back(body);
+void PhysicsWorld::AddRigidBody(const std::shared_ptr<btRigidBody>& body, const std::shared_ptr<btCollisionShape>& shape) {
+  rigid_bodies_.push_back(RigidBody { body, shape });
   physics_world_->addRigidBody(body.get());
 }
 
-void PhysicsWorld::UpdateWorld() {
-  physics_world_->stepSimulation(time_step_, 10);
+void PhysicsWorld::RemoveRigidBody(const std::shared_ptr<btRigidBody>& body) {
+  auto entry = std::find_if(rigid_bodies_.begin(), rigid_bodies_.end(), [&body](const RigidBody& rigid_body) { return rigid_body.body_ == body; });
+  if (entry == rigid_bodies_.end()) {
+    return;
+  }
+
+  physics_world_->removeRigidBody(body.get());
+
+  //The sync lists must not outlive the motion state
+  btMotionState* motion_state = body->getMotionState();
+  if (motion_state) {
+    for (std::vector<PhysicsMotionState*>* list : { &moved_, &previous_moved_, &settled_ }) {
+      list->erase(std::remove(list->begin(), list->end(), motion_state), list->end());
+    }
+    motion_states_.erase(std::remove_if(motion_states_.begin(), motion_states_.end(), 
+      [motion_state](const std::shared_ptr<btMotionState>& state) { return state.get() == motion_state; }), motion_states_.end());
+  }
+
+  *entry = std::move(rigid_bodies_.back());
+  rigid_bodies_.pop_back();
+}
+
+//Never below one quantum, a dimension that rounds to 0 would give a shape
+//nothing can collide with
+static int QuantizeDimension(const float& dimension) {
+  return std::max(1, static_cast<int>(std::lround(dimension / kShapeQuantum)));
+}
+
+bool PhysicsWorld::ShapeKey::operator==(const ShapeKey& other) const {
+  return type_ == other.type_ && std::equal(dimensions_, dimensions_ + 3, other.dimensions_);
+}
+
+size_t PhysicsWorld::ShapeKeyHash::operator()(const ShapeKey& key) const {
+  size_t hash = static_cast<size_t>(key.type_);
+  for (const int& dimension : key.dimensions_) {
+    hash = hash * 31 + std::hash<int>()(dimension);
+  }
+  return hash;
+}
+
+std::shared_ptr<btCollisionShape> PhysicsWorld::FindSharedShape(const ShapeKey& key) {
+  auto shape = shared_shapes_.find(key);
+  return shape != shared_shapes_.end() ? shape->second.lock() : nullptr;
+}
+
+void PhysicsWorld::AddSharedShape(const ShapeKey& key, const std::shared_ptr<btCollisionShape>& shape) {
+  shared_shapes_[key] = shape;
+
+  if (shared_shapes_.size() >= shared_shape_sweep_size_) {
+    for (auto entry = shared_shapes_.begin(); entry != shared_shapes_.end();) {
+      entry = entry->second.expired() ? shared_shapes_.erase(entry) : std::next(entry);
+    }
+    shared_shape_sweep_size_ = std::max<size_t>(64, shared_shapes_.size() * 2);
+  }
+}
+
+//Shapes are built from the quantized dimensions, so every user of a shared
+//shape gets exactly the same one no matter who created it first
+std::shared_ptr<btBoxShape> PhysicsWorld::AcquireBoxShape(const glm::vec3& half_extents) {
+  ShapeKey key { ShapeType::kShapeTypeBox, { QuantizeDimension(half_extents.x), QuantizeDimension(half_extents.y), QuantizeDimension(half_extents.z) } };
+  if (std::shared_ptr<btCollisionShape> shape = FindSharedShape(key)) {
+    return std::static_pointer_cast<btBoxShape>(shape);
+  }
+
+  std::shared_ptr<btBoxShape> box = std::make_shared<btBoxShape>(btVector3(key.dimensions_[0], key.dimensions_[1], key.dimensions_[2]) * kShapeQuantum);
+  AddSharedShape(key, box);
+  return box;
+}
+
+std::shared_ptr<btSphereShape> PhysicsWorld::AcquireSphereShape(const float& radius) {
+  ShapeKey key { ShapeType::kShapeTypeSphere, { QuantizeDimension(radius), 0, 0 } };
+  if (std::shared_ptr<btCollisionShape> shape = FindSharedShape(key)) {
+    return std::static_pointer_cast<btSphereShape>(shape);
+  }
+
+  std::shared_ptr<btSphereShape> sphere = std::make_shared<btSphereShape>(key.dimensions_[0] * kShapeQuantum);
+  AddSharedShape(key, sphere);
+  return sphere;
+}
+
+size_t PhysicsWorld::GetSharedShapeCount() const {
+  return std::count_if(shared_shapes_.begin(), shared_shapes_.end(), [](const auto& entry) { return !entry.second.expired(); });
+}
+
+//Called from the fixed update, so take exactly one step of the given size and
+//leave sub-stepping and interpolation to the application loop
+void PhysicsWorld::UpdateWorld(const float& time_step) {
+  previous_moved_.swap(moved_);
+  moved_.clear();
+  ++step_;
+
+  auto start = std::chrono::steady_clock::now();
+  physics_world_->stepSimulation(time_step, 0);
+  step_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  //Bodies that moved last step but not this one would otherwise keep
+  //interpolating towards where they already are
+  for (PhysicsMotionState* motion_state : previous_moved_) {
+    if (motion_state->moved_step_ != step_) {
+      motion_state->previous_ = motion_state->current_;
+      settled_.push_back(motion_state);
+    }
+  }
+
   physics_world_->debugDrawWorld();
 }
 
+void PhysicsWorld::ClearSettledBodies() {
+  settled_.clear();
+}
+
+//Motion states are synchronized on the stepping thread, even by the parallel
+//backend, so the lists need no locking
+void PhysicsWorld::OnBodyMoved(PhysicsMotionState& motion_state) {
+  motion_state.moved_step_ = step_;
+  moved_.push_back(&motion_state);
+}
+
 void PhysicsWorld::EnableDebug(void) {
   physics_world_->getDebugDrawer()->setDebugMode(btIDebugDraw::DBG_DrawWireframe | btIDebugDraw::DBG_DrawContactPoints);
 }
@@ -51,3 +293,125 @@ void PhysicsWorld::DisableDebug(void) {
 void PhysicsWorld::SingleRayCast(const glm::vec3& from, const glm::vec3& to, btCollisionWorld::RayResultCallback& result) {
   physics_world_->rayTest(GLM_To_BT_Vec3(from), GLM_To_BT_Vec3(to), result);
 }
+
+#if BT_THREADSAFE
+//Small enough that a few hundred rays still spread over every worker
+constexpr size_t kQueryGrainSize = 32;
+#endif
+
+//Only the parallel backend requires a thread safe Bullet, otherwise the
+//broadphase shares a single ray test stack between all callers
+static void RunQueries(const PhysicsBackend& backend, const size_t& count, const std::function<void(size_t, size_t)>& body) {
+#if BT_THREADSAFE
+  if (backend == PhysicsBackend::kPhysicsBackendParallel) {
+    JobSystem::ParallelFor(count, kQueryGrainSize, body);
+    return;
+  }
+#endif
+  body(0, count);
+}
+
+void PhysicsWorld::RayCastBatch(const RayQuery* queries, const size_t& count, QueryHit* results) const {
+  const btDiscreteDynamicsWorld* world = physics_world_.get();
+
+  RunQueries(backend_, count, [world, queries, results](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      btVector3 from = GLM_To_BT_Vec3(queries[i].from_);
+      btVector3 to = GLM_To_BT_Vec3(queries[i].to_);
+      btCollisionWorld::ClosestRayResultCallback callback(from, to);
+      world->rayTest(from, to, callback);
+
+      QueryHit hit;
+      if (callback.hasHit()) {
+        hit.object_ = callback.m_collisionObject;
+        hit.user_index_ = callback.m_collisionObject->getUserIndex();
+        hit.fraction_ = callback.m_closestHitFraction;
+        hit.point_ = BT_To_GLM_Vec3(callback.m_hitPointWorld);
+        hit.normal_ = BT_To_GLM_Vec3(callback.m_hitNormalWorld);
+      }
+      results[i] = hit;
+    }
+  });
+}
+
+void PhysicsWorld::SweepBatch(const SweepQuery* queries, const size_t& count, QueryHit* results) const {
+  const btDiscreteDynamicsWorld* world = physics_world_.get();
+
+  RunQueries(backend_, count, [world, queries, results](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const SweepQuery& query = queries[i];
+
+      //Cast shapes are cheap to build and private to the query, so nothing is shared between workers
+      btSphereShape sphere(query.half_extents_.x);
+      btBoxShape box(GLM_To_BT_Vec3(query.half_extents_));
+      const btConvexShape* shape = query.shape_ == QueryShape::kQueryShapeBox ? static_cast<const btConvexShape*>(&box) : &sphere;
+
+      btQuaternion rotation = GLM_To_BT_Quaternion(query.rotation_);
+      btTransform from(rotation, GLM_To_BT_Vec3(query.from_));
+      btTransform to(rotation, GLM_To_BT_Vec3(query.to_));
+
+      btCollisionWorld::ClosestConvexResultCallback callback(from.getOrigin(), to.getOrigin());
+      world->convexSweepTest(shape, from, to, callback);
+
+      QueryHit hit;
+      if (callback.hasHit()) {
+        hit.object_ = callback.m_hitCollisionObject;
+        hit.user_index_ = callback.m_hitCollisionObject->getUserIndex();
+        hit.fraction_ = callback.m_closestHitFraction;
+        hit.point_ = BT_To_GLM_Vec3(callback.m_hitPointWorld);
+        hit.normal_ = BT_To_GLM_Vec3(callback.m_hitNormalWorld);
+      }
+      results[i] = hit;
+    }
+  });
+}
+
+//Counts each object once, compounds and meshes report a contact per child or triangle
+struct OverlapCallback : public btCollisionWorld::ContactResultCallback {
+  btScalar addSingleResult(btManifoldPoint& point, const btCollisionObjectWrapper* query, int, int, const btCollisionObjectWrapper* other, int, int) override {
+    //Contacts within the breaking threshold are reported too, only keep real overlaps
+    if (point.getDistance() > 0.f) {
+      return 0.f;
+    }
+
+    const btCollisionObject* object = other->getCollisionObject();
+    if (object == query_object_) {
+      object = query->getCollisionObject();
+    }
+
+    if (std::find(objects_.begin(), objects_.end(), object) == objects_.end()) {
+      objects_.push_back(object);
+    }
+    return 0.f;
+  }
+
+  const btCollisionObject* query_object_ = nullptr;
+  std::vector<const btCollisionObject*> objects_;
+};
+
+void PhysicsWorld::OverlapBatch(const OverlapQuery* queries, const size_t& count, OverlapHit* results) {
+  OverlapCallback callback;
+
+  for (size_t i = 0; i < count; ++i) {
+    const OverlapQuery& query = queries[i];
+
+    btSphereShape sphere(query.half_extents_.x);
+    btBoxShape box(GLM_To_BT_Vec3(query.half_extents_));
+
+    btCollisionObject object;
+    object.setCollisionShape(query.shape_ == QueryShape::kQueryShapeBox ? static_cast<btCollisionShape*>(&box) : &sphere);
+    object.setWorldTransform(btTransform(GLM_To_BT_Quaternion(query.rotation_), GLM_To_BT_Vec3(query.position_)));
+
+    callback.query_object_ = &object;
+    callback.objects_.clear();
+    physics_world_->contactTest(&object, callback);
+
+    OverlapHit hit;
+    hit.count_ = static_cast<unsigned int>(callback.objects_.size());
+    if (!callback.objects_.empty()) {
+      hit.object_ = callback.objects_.front();
+      hit.user_index_ = hit.object_->getUserIndex();
+    }
+    results[i] = hit;
+  }
+}
\ No newline at end of file
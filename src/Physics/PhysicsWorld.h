@@ -6,38 +6,126 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "PhysicsDebugDrawer.h"
+#include "PhysicsMotionState.h"
+#include "PhysicsQuery.h"
+
+enum class PhysicsBackend {
+  kPhysicsBackendSequential,
+#if BT_THREADSAFE
+  //btDiscreteDynamicsWorldMt with collision and islands split across the
+  //job system's workers. Only built with --bullet-threadsafe, the Bullet
+  //libraries in libs have to be built with BT_THREADSAFE=1 to match.
+  kPhysicsBackendParallel,
+#endif
+};
+
+//Shared shapes match dimensions to the nearest 1/1024 of a unit and are
+//never smaller than that
+constexpr float kShapeQuantum = 1.f / 1024.f;
 
 class PhysicsWorld {
 public:
-  PhysicsWorld();
+  PhysicsWorld(const PhysicsBackend& backend = PhysicsBackend::kPhysicsBackendSequential);
   ~PhysicsWorld();
 
+  //Kept alive for the lifetime of the world
   void AddCollisionShape(const std::shared_ptr<btCollisionShape>& collision_shape);
   void AddMotionState(const std::shared_ptr<btMotionState>& motion_state);
-  void AddRigidBody(const std::shared_ptr<btRigidBody>& body);
+  //The world holds on to shape until the body is removed
+  void AddRigidBody(const std::shared_ptr<btRigidBody>& body, const std::shared_ptr<btCollisionShape>& shape = nullptr);
+  void RemoveRigidBody(const std::shared_ptr<btRigidBody>& body);
+
+  //Colliders with the same type and dimensions share one shape. A shape is
+  //freed once the last component and body holding it are gone.
+  std::shared_ptr<btBoxShape> AcquireBoxShape(const glm::vec3& half_extents);
+  std::shared_ptr<btSphereShape> AcquireSphereShape(const float& radius);
+  size_t GetSharedShapeCount() const;
 
-  void UpdateWorld();
+  void UpdateWorld(const float& time_step);
 
   void EnableDebug(void);
   void DisableDebug(void);
 
   void SingleRayCast(const glm::vec3& from, const glm::vec3& to, btCollisionWorld::RayResultCallback& result);
+
+  //Batched queries against the world as the last step left it. Never run
+  //them while the world is stepping. The parallel backend splits rays and
+  //sweeps across the job system, the sequential one runs them on the calling
+  //thread. results must hold count entries.
+  void RayCastBatch(const RayQuery* queries, const size_t& count, QueryHit* results) const;
+  void SweepBatch(const SweepQuery* queries, const size_t& count, QueryHit* results) const;
+  //Runs on the calling thread, contact tests allocate narrowphase algorithms
+  //and manifolds from the world's dispatcher
+  void OverlapBatch(const OverlapQuery* queries, const size_t& count, OverlapHit* results);
+
+  //Bodies the latest step moved. Their transforms interpolate every frame
+  //until the next step.
+  const std::vector<PhysicsMotionState*>& GetMovedBodies() const { return moved_; }
+  //Bodies that stopped since the last ClearSettledBodies and need one final sync.
+  //Can list a body twice if it stopped more than once.
+  const std::vector<PhysicsMotionState*>& GetSettledBodies() const { return settled_; }
+  void ClearSettledBodies();
+
+  PhysicsBackend GetBackend() const { return backend_; }
+  //Wall time of the last UpdateWorld step in milliseconds, debug drawing excluded
+  double GetStepTime() const { return step_time_; }
+private:
+  enum class ShapeType {
+    kShapeTypeBox,
+    kShapeTypeSphere,
+  };
+
+  struct ShapeKey {
+    ShapeType type_;
+    int dimensions_[3];
+
+    bool operator==(const ShapeKey& other) const;
+  };
+
+  struct ShapeKeyHash {
+    size_t operator()(const ShapeKey& key) const;
+  };
+
+  struct RigidBody {
+    std::shared_ptr<btRigidBody> body_;
+    std::shared_ptr<btCollisionShape> shape_;
+  };
+
+  friend class PhysicsMotionState;
+  void OnBodyMoved(PhysicsMotionState& motion_state);
+
+  std::shared_ptr<btCollisionShape> FindSharedShape(const ShapeKey& key);
+  void AddSharedShape(const ShapeKey& key, const std::shared_ptr<btCollisionShape>& shape);
 private:
   std::shared_ptr<btDefaultCollisionConfiguration> physics_config_;
   std::shared_ptr<btCollisionDispatcher> physics_dispatcher_;
   std::shared_ptr<btBroadphaseInterface> physics_broadphase_;
-  std::shared_ptr<btSequentialImpulseConstraintSolver> physics_solver_;
+  //Solver pool for the parallel backend, the plain solver otherwise
+  std::shared_ptr<btConstraintSolver> physics_solver_;
+  //Single multithreaded solver the parallel backend hands large islands to
+  std::shared_ptr<btConstraintSolver> physics_solver_mt_;
   std::shared_ptr<btDiscreteDynamicsWorld> physics_world_;
 
   std::vector<std::shared_ptr<btCollisionShape>> collision_shapes_;
   std::vector<std::shared_ptr<btMotionState>> motion_states_;
-  std::vector<std::shared_ptr<btRigidBody>> rigid_bodies_;
+  std::vector<RigidBody> rigid_bodies_;
+
+  //Expired entries are swept whenever the map doubles in size
+  std::unordered_map<ShapeKey, std::weak_ptr<btCollisionShape>, ShapeKeyHash> shared_shapes_;
+  size_t shared_shape_sweep_size_ = 64;
 
   PhysicsDebugDrawer debug_drawer_;
 
-  float time_step_ = 1.0f / 60.0f;
+  unsigned int step_ = 0;
+  std::vector<PhysicsMotionState*> moved_;
+  std::vector<PhysicsMotionState*> previous_moved_;
+  std::vector<PhysicsMotionState*> settled_;
+
+  PhysicsBackend backend_;
+  double step_time_ = 0.0;
 };
 
 
@@ -7,6 +7,7 @@
 #include "Core/ResourceManager.h"
 #include "Core/Time.h"
 #include "Core/Input.h"
+#include "Core/JobSystem.h"
 
 #include "Core/MapLoader.h"
 
@@ -17,6 +18,8 @@
 #include "Graphics/ModelLoader.h"
 
 #include "Graphics/DebugDrawer.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/RenderState.h"
 
 #include "Components/RigidBodyComponent.h"
 #include "Components/BoxColliderComponent.h"
@@ -27,10 +30,12 @@
 #include "Components/InputComponent.h"
 #include "Components/CameraComponent.h"
 #include "Components/TransformComponent.h"
+#include "Components/BoundsComponent.h"
 #include "Components/Components.h"
 
 #include "Gui/ImGui_Backend.h"
 
+#include "Physics/LevelCollision.h"
 #include "Physics/PhysicsWorld.h"
 #include "Physics/PhysicsMath.h"
 
@@ -43,6 +48,7 @@ struct {
   entt::entity camera_;
 
   PhysicsWorld physics_world;
+  LevelCollision level_collision_;
 } Core;
 
 struct {
@@ -56,6 +62,21 @@ void DrawUI(void) {
     ImGui::Text("Frames: %.3f ms", 1000.0f / ImGui::GetIO().Framerate);
     ImGui::Text("FPS: %.2f", ImGui::GetIO().Framerate);
 
+    JobSystem::Stats job_stats = JobSystem::GetStats();
+    ImGui::Text("Jobs: %llu (%llu stolen)", job_stats.jobs_executed_, job_stats.jobs_stolen_);
+
+    RenderQueue::Stats render_stats = RenderQueue::GetStats();
+    ImGui::Text("Draws: %u (%u instanced), state changes: %u", render_stats.draw_calls_, render_stats.instanced_draw_calls_, render_stats.state_changes_);
+    ImGui::Text("Sort: %.3f ms", render_stats.sort_time_);
+
+    MeshCullingStats culling_stats = GetMeshCullingStats();
+    ImGui::Text("Meshes: %u visible, %u culled (%.3f ms)", culling_stats.visible_, culling_stats.culled_, culling_stats.cull_time_);
+
+    RenderState::Stats state_stats = RenderState::GetStats();
+    ImGui::Text("GL state calls: %u (%u elided)", state_stats.issued_, state_stats.elided_);
+
+    ImGui::Text("Physics step: %.3f ms, %zu bodies moved", Core.physics_world.GetStepTime(), Core.physics_world.GetMovedBodies().size());
+
     if (ImGui::Checkbox("Debug Draw", &UI.draw_debug_)) {
       if (UI.draw_debug_) {
         Core.physics_world.EnableDebug();
@@ -89,25 +110,44 @@ void ClearBackgroundColor(void) {
 
 void Setup_PhysicsDemo() {  
 
-  Core.resource_manager_.LoadModelAsset("../../assets/map3.gltf");
-  Core.resource_manager_.LoadShaderAsset("../../assets/shader.glsl");
+  ModelResource map_resource = Core.resource_manager_.LoadModelAssetAsync("../../assets/map3.gltf");
+
+  MapLoader map;
+  map.LoadMap("../../assets/leveldata/level3.json");
+  Core.level_collision_.AddColliders(Core.physics_world, map.GetColliders());
+  Core.resource_manager_.LoadShaderAsset("../../assets/shader.glsl", true);
 
   ShaderResource shader_resource = Core.resource_manager_.GetShaderResource("../../assets/shader.glsl");
   ShaderComponent& shader_component = Core.resource_manager_.GetShaderFromHandle(shader_resource.shader_handle_);
 
   shader_component.shader_
     ->LoadUniform("model")
-    .LoadUniform("viewProjection")
-    .LoadUniform("fragBaseColor")
+    .LoadUniform("positionScale")
+    .LoadUniform("positionOffset")
     .LoadUniform("texture0")
-    .SetUniform_Int("texture0", 0);
+    .BindUniformBlock("FrameData", kFrameUniformBinding)
+    .BindUniformBlock("MaterialData", kMaterialUniformBinding);
+
+  //Model matrices come from the instance buffer in this one
+  shader_component.instanced_shader_
+    ->LoadUniform("positionScale")
+    .LoadUniform("positionOffset")
+    .LoadUniform("texture0")
+    .BindUniformBlock("FrameData", kFrameUniformBinding)
+    .BindUniformBlock("MaterialData", kMaterialUniformBinding);
+
+  shader_component.shader_->Bind();
+  shader_component.shader_->SetUniform_Int("texture0", 0);
+  shader_component.instanced_shader_->Bind();
+  shader_component.instanced_shader_->SetUniform_Int("texture0", 0);
+  shader_component.instanced_shader_->Unbind();
 
   entt::entity minecraft_pp = Core.registry_.create();
 
   TransformComponent transform{};
   transform.position_ = glm::vec3(0.f, 0.f, 0.f);
 
-  Core.registry_.emplace<ModelComponent>(minecraft_pp, Core.resource_manager_.GetModelResource("../../assets/map3.gltf"));
+  Core.registry_.emplace<ModelComponent>(minecraft_pp, map_resource);
   Core.registry_.emplace<TransformComponent>(minecraft_pp, transform);
   Core.registry_.emplace<ShaderComponent>(minecraft_pp, shader_component);
 
@@ -118,36 +158,63 @@ void Setup_PhysicsDemo() {
   Input::SetCursorState(Input::CursorState::kCursorStateDisabled);
 }
 
+void FixedUpdate(void) {
+  Core.physics_world.UpdateWorld(static_cast<float>(Time::GetFixedDeltaTime()));
+}
+
 void Update(void) {
-  Core.physics_world.UpdateWorld();
-  UpdatePhysicsSystem(Core.registry_); 
+  UpdatePhysicsSystem(Core.registry_, Core.physics_world); 
 }
 
 void DrawDebug(void) {
   CameraComponent camera = Core.registry_.get<CameraComponent>(Core.camera_);
-  DebugDrawer::DrawSquares(camera.projection_ * camera.view_);
+  DebugDrawer::DrawShapes(camera.projection_ * camera.view_);
   DebugDrawer::DrawLines(camera.projection_ * camera.view_);
 }
 
 int main(void) {
   Application::SetTargetFPS(120);
+  Application::SetFixedUpdateRate(60);
 
   DebugDrawer::InitializeDebugDrawer(); 
 
   Core.app_
     .AddSystem(Application::SystemType::kSystemStart, ImGui_Backend::Start)
     .AddSystem(Application::SystemType::kSystemStart, Setup_PhysicsDemo)
+    .AddSystem(Application::SystemType::kSystemFixedUpdate, FixedUpdate)
     .AddSystem(Application::SystemType::kSystemUpdate, ImGui_Backend::NewFrame)
-    .AddSystem(Application::SystemType::kSystemUpdate, Update)
     .AddSystem(Application::SystemType::kSystemUpdate, DrawUI)
     .AddSystem(Application::SystemType::kSystemUpdate, ClearBackgroundColor)
-    .AddSystem(Application::SystemType::kSystemUpdate, [](){ 
-      UpdateCameraComponents(Core.registry_, glm::vec2(Core.app_.GetWindowWidth(), Core.app_.GetWindowHeight())); 
-    })
-    .AddSystem(Application::SystemType::kSystemUpdate, [](){ UpdateMeshComponents(Core.registry_, Core.resource_manager_); })
-    .AddSystem(Application::SystemType::kSystemUpdate, DrawDebug)
+    .AddSystem(Application::SystemType::kSystemUpdate, [](){ Core.resource_manager_.ProcessUploads(0.002); })
+    .AddSystem(Application::SystemType::kSystemUpdate, 
+      SystemAccess(Core.registry_).Read<RigidBodyComponent>().Write<TransformComponent>(), 
+      Update
+    )
+    .AddSystem(Application::SystemType::kSystemUpdate, 
+      SystemAccess(Core.registry_).Read<InputComponent>().Write<CameraComponent, FlyCameraComponent>(),
+      [](){ UpdateCameraComponents(Core.registry_, glm::vec2(Core.app_.GetWindowWidth(), Core.app_.GetWindowHeight())); }
+    )
+    .AddSystem(Application::SystemType::kSystemUpdate, 
+      SystemAccess(Core.registry_).MainThread().Read<ModelComponent, ShaderComponent, TransformComponent, CameraComponent>().Write<BoundsComponent>(),
+      [](){ 
+        UpdateMeshComponents(Core.registry_, Core.resource_manager_); 
+
+        const CameraComponent& camera = Core.registry_.get<CameraComponent>(Core.camera_);
+
+        FrameUniforms frame;
+        frame.view_ = camera.view_;
+        frame.projection_ = camera.projection_;
+        frame.view_projection_ = camera.projection_ * camera.view_;
+        frame.camera_position_ = camera.position_;
+        frame.time_ = static_cast<float>(Time::GetElapsedTime());
+        RenderQueue::Flush(frame);
+      }
+    )
+    .AddSystem(Application::SystemType::kSystemUpdate, SystemAccess(Core.registry_).MainThread().Read<CameraComponent>(), DrawDebug)
     .AddSystem(Application::SystemType::kSystemUpdate, ImGui_Backend::Render)
     .AddSystem(Application::SystemType::kSystemEnd, [](){ ReleaseMeshResources(Core.registry_); })
+    .AddSystem(Application::SystemType::kSystemEnd, RenderQueue::Release)
+    .AddSystem(Application::SystemType::kSystemEnd, DebugDrawer::Release)
     .AddSystem(Application::SystemType::kSystemEnd, ImGui_Backend::End)
     .Run();
   
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+
+#include "../src/Graphics/MeshOptimizer.h"
+
+//The import time passes on small hand built meshes
+
+using Triangle = std::array<unsigned int, 3>;
+
+//Rotated so the smallest index comes first, winding is kept
+static std::vector<Triangle> GetSortedTriangles(const std::vector<unsigned int>& indices) {
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    Triangle triangle = { indices[i], indices[i + 1], indices[i + 2] };
+    std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+//size x size quads, two triangles each, sharing the grid's vertices
+static std::vector<unsigned int> MakeGrid(const unsigned int& size) {
+  std::vector<unsigned int> indices;
+  for (unsigned int y = 0; y < size; ++y) {
+    for (unsigned int x = 0; x < size; ++x) {
+      unsigned int corner = y * (size + 1) + x;
+      indices.insert(indices.end(), { corner, corner + 1, corner + size + 1 });
+      indices.insert(indices.end(), { corner + 1, corner + size + 2, corner + size + 1 });
+    }
+  }
+  return indices;
+}
+
+static void ShuffleTriangles(std::vector<unsigned int>& indices, const unsigned int& seed) {
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    triangles.push_back(Triangle { indices[i], indices[i + 1], indices[i + 2] });
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+
+  indices.clear();
+  for (const Triangle& triangle : triangles) {
+    indices.insert(indices.end(), triangle.begin(), triangle.end());
+  }
+}
+
+TEST_CASE(VertexRemapMergesIdenticalVertices) {
+  const std::vector<float> vertices = {
+    0.f, 1.f, 2.f,
+    3.f, 0.f, 5.f,
+    0.f, 1.f, 2.f,
+    //Equal to the second vertex but not bitwise identical
+    3.f, -0.f, 5.f,
+    3.f, 0.f, 5.f,
+  };
+
+  std::vector<unsigned int> remap;
+  size_t unique = GenerateVertexRemap(remap, vertices.data(), 5, 3);
+
+  CHECK(unique == 3);
+  CHECK(remap.size() == 5);
+  CHECK(remap[0] == 0);
+  CHECK(remap[1] == 1);
+  CHECK(remap[2] == remap[0]);
+  CHECK(remap[3] == 2);
+  CHECK(remap[4] == remap[1]);
+
+  std::vector<float> remapped = vertices;
+  RemapVertices(remapped, remap, unique, 3);
+  CHECK(remapped.size() == unique * 3);
+  CHECK(std::equal(remapped.begin(), remapped.begin() + 6, vertices.begin()));
+}
+
+TEST_CASE(VertexCacheKeepsEveryTriangle) {
+  std::vector<unsigned int> indices = MakeGrid(8);
+  ShuffleTriangles(indices, 1);
+  //Degenerate triangles are still triangles as far as the optimizer is concerned
+  indices.insert(indices.end(), { 4, 4, 20, 7, 7, 7, 30, 31, 30 });
+  const size_t vertex_count = 9 * 9;
+
+  std::vector<unsigned int> optimized = indices;
+  OptimizeVertexCache(optimized, vertex_count);
+
+  CHECK(optimized.size() == indices.size());
+  CHECK(GetSortedTriangles(optimized) == GetSortedTriangles(indices));
+}
+
+TEST_CASE(VertexCacheLowersGridAcmr) {
+  const unsigned int size = 32;
+  const size_t vertex_count = (size + 1) * (size + 1);
+
+  //Row by row is the usual exporter order, shuffled is the worst case
+  std::vector<unsigned int> rows = MakeGrid(size);
+  std::vector<unsigned int> shuffled = rows;
+  ShuffleTriangles(shuffled, 2);
+
+  for (std::vector<unsigned int>* indices : { &rows, &shuffled }) {
+    VertexCacheStats before = AnalyzeVertexCache(*indices, vertex_count);
+    OptimizeVertexCache(*indices, vertex_count);
+    VertexCacheStats after = AnalyzeVertexCache(*indices, vertex_count);
+
+    CHECK(after.acmr_ < before.acmr_);
+    CHECK(after.vertices_transformed_ < before.vertices_transformed_);
+    //Every vertex has to be transformed at least once
+    CHECK(after.atvr_ >= 1.f);
+  }
+}
+
+TEST_CASE(VertexFetchRemapFollowsFirstUse) {
+  const std::vector<unsigned int> indices = { 3, 1, 3, 0, 5, 1 };
+
+  std::vector<unsigned int> remap;
+  size_t used = GenerateVertexFetchRemap(remap, indices, 6);
+
+  CHECK(used == 4);
+  CHECK(remap.size() == 6);
+  CHECK(remap[3] == 0);
+  CHECK(remap[1] == 1);
+  CHECK(remap[0] == 2);
+  CHECK(remap[5] == 3);
+  //Unreferenced vertices get no slot
+  CHECK(remap[2] >= used);
+  CHECK(remap[4] >= used);
+
+  std::vector<unsigned int> remapped = indices;
+  RemapIndices(remapped, remap);
+  CHECK((remapped == std::vector<unsigned int> { 0, 1, 0, 2, 3, 1 }));
+}
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include <cmath>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Test.h"
+
+#include "../src/Graphics/MeshSimplifier.h"
+
+//Level of detail generation on tessellated planes and height fields
+
+using Edge = std::pair<unsigned int, unsigned int>;
+
+//Position and texcoord, the simplifier only looks at the first three floats
+static const size_t kVertexFloats = 5;
+
+struct TestMesh {
+  std::vector<float> vertices_;
+  std::vector<unsigned int> indices_;
+
+  size_t GetVertexCount() const { return vertices_.size() / kVertexFloats; }
+};
+
+//columns x rows quads over the xy plane starting at x_offset, heights from
+//height(x, y). Counter clockwise seen from +z.
+template <typename Height>
+static void AddGrid(TestMesh& mesh, const unsigned int& columns, const unsigned int& rows, const float& x_offset, const Height& height) {
+  const unsigned int first = static_cast<unsigned int>(mesh.GetVertexCount());
+  for (unsigned int y = 0; y <= rows; ++y) {
+    for (unsigned int x = 0; x <= columns; ++x) {
+      float position_x = x_offset + static_cast<float>(x);
+      float position_y = static_cast<float>(y);
+      mesh.vertices_.insert(mesh.vertices_.end(), { position_x, position_y, height(position_x, position_y),
+        static_cast<float>(x) / columns, static_cast<float>(y) / rows });
+    }
+  }
+
+  for (unsigned int y = 0; y < rows; ++y) {
+    for (unsigned int x = 0; x < columns; ++x) {
+      unsigned int corner = first + y * (columns + 1) + x;
+      mesh.indices_.insert(mesh.indices_.end(), { corner, corner + 1, corner + columns + 1 });
+      mesh.indices_.insert(mesh.indices_.end(), { corner + 1, corner + columns + 2, corner + columns + 1 });
+    }
+  }
+}
+
+static float GetFlatHeight(const float&, const float&) {
+  return 0.f;
+}
+
+//Gentle enough that every source triangle still faces +z
+static float GetBumpyHeight(const float& x, const float& y) {
+  return 0.4f * std::sin(x * 0.5f) * std::cos(y * 0.4f);
+}
+
+//Edges used by a single triangle, with their winding
+static std::set<Edge> GetBorderEdges(const std::vector<unsigned int>& indices) {
+  std::set<Edge> edges;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t k = 0; k < 3; ++k) {
+      edges.insert(Edge(indices[i + k], indices[i + (k + 1) % 3]));
+    }
+  }
+
+  std::set<Edge> border;
+  for (const Edge& edge : edges) {
+    if (edges.count(Edge(edge.second, edge.first)) == 0) {
+      border.insert(edge);
+    }
+  }
+  return border;
+}
+
+static float GetNormalZ(const TestMesh& mesh, const unsigned int* triangle) {
+  const float* a = &mesh.vertices_[triangle[0] * kVertexFloats];
+  const float* b = &mesh.vertices_[triangle[1] * kVertexFloats];
+  const float* c = &mesh.vertices_[triangle[2] * kVertexFloats];
+  return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+static bool IsValidTriangleList(const std::vector<unsigned int>& indices, const size_t& vertex_count) {
+  if (indices.size() % 3 != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count || indices[i + 2] >= vertex_count) {
+      return false;
+    }
+    if (indices[i] == indices[i + 1] || indices[i + 1] == indices[i + 2] || indices[i] == indices[i + 2]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST_CASE(SimplifierReachesTargetOnPlane) {
+  TestMesh mesh;
+  AddGrid(mesh, 16, 16, 0.f, GetFlatHeight);
+
+  //Every interior collapse on a plane is free, so only the count stops it
+  const size_t target = mesh.indices_.size() / 4 / 3 * 3;
+  float error = -1.f;
+  std::vector<unsigned int> result = SimplifyMesh(mesh.indices_, mesh.vertices_.data(), mesh.GetVertexCount(), kVertexFloats, target, 0.01f, error);
+
+  CHECK(IsValidTriangleList(result, mesh.GetVertexCount()));
+  CHECK(!result.empty());
+  CHECK(result.size() <= target);
+  CHECK(error >= 0.f && error < 1e-4f);
+}
+
+TEST_CASE(SimplifierKeepsBorderVertices) {
+  TestMesh mesh;
+  AddGrid(mesh, 12, 12, 0.f, GetBumpyHeight);
+
+  float error = 0.f;
+  std::vector<unsigned int> result = SimplifyMesh(mesh.indices_, mesh.vertices_.data(), mesh.GetVertexCount(), kVertexFloats, 0, 1.f, error);
+  CHECK(result.size() < mesh.indices_.size());
+
+  //Locked vertices are never collapsed, so the outline comes through edge for edge
+  CHECK(GetBorderEdges(result) == GetBorderEdges(mesh.indices_));
+}
+
+TEST_CASE(SimplifierKeepsSeamVertices) {
+  //Two halves that meet at x = 8 without sharing vertices, like a texcoord seam
+  TestMesh mesh;
+  AddGrid(mesh, 8, 12, 0.f, GetFlatHeight);
+  const unsigned int right_first = static_cast<unsigned int>(mesh.GetVertexCount());
+  AddGrid(mesh, 8, 12, 8.f, GetFlatHeight);
+
+  std::vector<unsigned int> seam;
+  for (unsigned int i = 0; i < mesh.GetVertexCount(); ++i) {
+    if (mesh.vertices_[i * kVertexFloats] == 8.f) {
+      seam.push_back(i);
+    }
+  }
+  CHECK(seam.size() == 26);
+
+  float error = 0.f;
+  std::vector<unsigned int> result = SimplifyMesh(mesh.indices_, mesh.vertices_.data(), mesh.GetVertexCount(), kVertexFloats, 0, 1.f, error);
+  CHECK(IsValidTriangleList(result, mesh.GetVertexCount()));
+  CHECK(result.size() < mesh.indices_.size() / 2);
+
+  std::set<unsigned int> used(result.begin(), result.end());
+  for (const unsigned int& vertex : seam) {
+    CHECK(used.count(vertex) == 1);
+  }
+
+  //Both sides of the seam still close up against each other
+  std::set<Edge> left_seam, right_seam;
+  for (const Edge& edge : GetBorderEdges(result)) {
+    const float x_first = mesh.vertices_[edge.first * kVertexFloats];
+    const float x_second = mesh.vertices_[edge.second * kVertexFloats];
+    if (x_first != 8.f || x_second != 8.f) {
+      continue;
+    }
+    const float y_first = mesh.vertices_[edge.first * kVertexFloats + 1];
+    const float y_second = mesh.vertices_[edge.second * kVertexFloats + 1];
+    if (edge.first < right_first) {
+      left_seam.insert(Edge(static_cast<unsigned int>(y_first), static_cast<unsigned int>(y_second)));
+    } else {
+      right_seam.insert(Edge(static_cast<unsigned int>(y_second), static_cast<unsigned int>(y_first)));
+    }
+  }
+  CHECK(left_seam.size() == 12);
+  CHECK(left_seam == right_seam);
+}
+
+TEST_CASE(SimplifierStaysWithinTargetError) {
+  TestMesh mesh;
+  AddGrid(mesh, 24, 24, 0.f, GetBumpyHeight);
+
+  size_t previous_size = mesh.indices_.size() + 1;
+  for (const float target_error : { 0.f, 0.01f, 0.05f, 0.2f }) {
+    float error = -1.f;
+    std::vector<unsigned int> result = SimplifyMesh(mesh.indices_, mesh.vertices_.data(), mesh.GetVertexCount(), kVertexFloats, 0, target_error, error);
+
+    CHECK(IsValidTriangleList(result, mesh.GetVertexCount()));
+    CHECK(error >= 0.f);
+    CHECK(error <= target_error);
+    //A looser bound never keeps more triangles
+    CHECK(result.size() <= previous_size);
+    previous_size = result.size();
+  }
+  CHECK(previous_size < mesh.indices_.size() / 2);
+}
+
+TEST_CASE(SimplifierNeverFlipsTriangles) {
+  TestMesh mesh;
+  AddGrid(mesh, 24, 24, 0.f, GetBumpyHeight);
+
+  //Jittered interior points leave concave one rings where a collapse can fold
+  //a neighbour over without costing much error
+  for (size_t i = 0; i < mesh.GetVertexCount(); ++i) {
+    float* position = &mesh.vertices_[i * kVertexFloats];
+    if (position[0] > 0.f && position[0] < 24.f && position[1] > 0.f && position[1] < 24.f) {
+      float x = position[0], y = position[1];
+      position[0] += 0.3f * std::sin(x * 12.9898f + y * 78.233f);
+      position[1] += 0.3f * std::cos(x * 39.34f + y * 11.13f);
+    }
+  }
+
+  float source_area = 0.f;
+  for (size_t i = 0; i < mesh.indices_.size(); i += 3) {
+    CHECK(GetNormalZ(mesh, &mesh.indices_[i]) > 0.f);
+    source_area += GetNormalZ(mesh, &mesh.indices_[i]);
+  }
+
+  for (const float target_error : { 0.05f, 1.f, 100.f }) {
+    float error = 0.f;
+    std::vector<unsigned int> result = SimplifyMesh(mesh.indices_, mesh.vertices_.data(), mesh.GetVertexCount(), kVertexFloats, 0, target_error, error);
+    CHECK(IsValidTriangleList(result, mesh.GetVertexCount()));
+
+    //Three points in a row make a triangle seen edge on from above, which is
+    //allowed. Anything folded over would face down and, with the outline
+    //locked, also cover part of the grid twice.
+    float area = 0.f;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      CHECK(GetNormalZ(mesh, &result[i]) >= 0.f);
+      area += GetNormalZ(mesh, &result[i]);
+    }
+    CHECK(std::fabs(area - source_area) < 1e-3f * source_area);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include <glad/glad.h>
+
+#include <cstring>
+#include <vector>
+
+#include "Test.h"
+
+#include "../src/Graphics/RenderState.h"
+
+//RenderState against a GL table that records calls instead of making them
+
+struct RecordedCall {
+  const char* function_;
+  unsigned int first_;
+  unsigned int second_;
+};
+
+static std::vector<RecordedCall> recorded_calls;
+
+static void Record(const char* function, const unsigned int& first, const unsigned int& second = 0) {
+  recorded_calls.push_back(RecordedCall { function, first, second });
+}
+
+static void APIENTRY RecordUseProgram(GLuint program) { Record("glUseProgram", program); }
+static void APIENTRY RecordBindVertexArray(GLuint vertex_array) { Record("glBindVertexArray", vertex_array); }
+static void APIENTRY RecordBindBuffer(GLenum target, GLuint buffer) { Record("glBindBuffer", target, buffer); }
+static void APIENTRY RecordBindBufferBase(GLenum, GLuint index, GLuint buffer) { Record("glBindBufferBase", index, buffer); }
+static void APIENTRY RecordActiveTexture(GLenum unit) { Record("glActiveTexture", unit); }
+static void APIENTRY RecordBindTexture(GLenum target, GLuint texture) { Record("glBindTexture", target, texture); }
+static void APIENTRY RecordEnable(GLenum capability) { Record("glEnable", capability); }
+static void APIENTRY RecordDisable(GLenum capability) { Record("glDisable", capability); }
+
+//Fresh tracker in the GL default state, nothing recorded yet
+static void ResetRenderState() {
+  glad_glUseProgram = RecordUseProgram;
+  glad_glBindVertexArray = RecordBindVertexArray;
+  glad_glBindBuffer = RecordBindBuffer;
+  glad_glBindBufferBase = RecordBindBufferBase;
+  glad_glActiveTexture = RecordActiveTexture;
+  glad_glBindTexture = RecordBindTexture;
+  glad_glEnable = RecordEnable;
+  glad_glDisable = RecordDisable;
+
+  RenderState::Initialize();
+  RenderState::BeginFrame();
+  recorded_calls.clear();
+}
+
+static size_t CountCalls(const char* function) {
+  size_t count = 0;
+  for (const RecordedCall& call : recorded_calls) {
+    count += std::strcmp(call.function_, function) == 0 ? 1 : 0;
+  }
+  return count;
+}
+
+TEST_CASE(RenderStateSkipsRedundantProgram) {
+  ResetRenderState();
+
+  RenderState::UseProgram(3);
+  RenderState::UseProgram(3);
+  CHECK(CountCalls("glUseProgram") == 1);
+
+  RenderState::UseProgram(4);
+  CHECK(CountCalls("glUseProgram") == 2);
+  CHECK(recorded_calls.back().first_ == 4);
+
+  //Initialize assumes program 0 is bound
+  RenderState::UseProgram(0);
+  RenderState::UseProgram(0);
+  CHECK(CountCalls("glUseProgram") == 3);
+}
+
+TEST_CASE(RenderStateSkipsRedundantBuffers) {
+  ResetRenderState();
+
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, 5);
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, 5);
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, 5);
+  CHECK(CountCalls("glBindBuffer") == 2);
+
+  RenderState::BindUniformBufferBase(1, 8);
+  RenderState::BindUniformBufferBase(1, 8);
+  CHECK(CountCalls("glBindBufferBase") == 1);
+
+  //Binding a range also binds the generic uniform target
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, 8);
+  CHECK(CountCalls("glBindBuffer") == 2);
+}
+
+TEST_CASE(RenderStateSkipsRedundantTextures) {
+  ResetRenderState();
+
+  RenderState::BindTexture(0, GL_TEXTURE_2D, 7);
+  RenderState::BindTexture(0, GL_TEXTURE_2D, 7);
+  CHECK(CountCalls("glBindTexture") == 1);
+  CHECK(CountCalls("glActiveTexture") == 0);
+
+  //Each target keeps its own binding per unit
+  RenderState::BindTexture(0, GL_TEXTURE_2D_ARRAY, 7);
+  CHECK(CountCalls("glBindTexture") == 2);
+
+  RenderState::BindTexture(2, GL_TEXTURE_2D, 7);
+  CHECK(CountCalls("glActiveTexture") == 1);
+  CHECK(CountCalls("glBindTexture") == 3);
+
+  //Deleting the texture leaves 0 bound where it was
+  RenderState::ForgetTexture(7);
+  RenderState::BindTexture(2, GL_TEXTURE_2D, 0);
+  CHECK(CountCalls("glBindTexture") == 3);
+}
+
+TEST_CASE(RenderStateSkipsRedundantCapabilities) {
+  ResetRenderState();
+
+  RenderState::SetCapability(RenderCapability::kCapabilityCullFace, true);
+  RenderState::SetCapability(RenderCapability::kCapabilityCullFace, true);
+  CHECK(CountCalls("glEnable") == 1);
+  CHECK(recorded_calls.back().first_ == GL_CULL_FACE);
+
+  RenderState::SetCapability(RenderCapability::kCapabilityCullFace, false);
+  RenderState::SetCapability(RenderCapability::kCapabilityCullFace, false);
+  CHECK(CountCalls("glDisable") == 1);
+
+  //Everything starts disabled
+  RenderState::SetCapability(RenderCapability::kCapabilityBlend, false);
+  CHECK(recorded_calls.size() == 2);
+}
+
+TEST_CASE(RenderStateVertexArrayForgetsElementBuffer) {
+  ResetRenderState();
+
+  RenderState::BindVertexArray(2);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+  CHECK(CountCalls("glBindBuffer") == 1);
+
+  //Same vertex array, the element binding is still known
+  RenderState::BindVertexArray(2);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+  CHECK(CountCalls("glBindVertexArray") == 1);
+  CHECK(CountCalls("glBindBuffer") == 1);
+
+  //Another vertex array brings its own element binding
+  RenderState::BindVertexArray(4);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+  CHECK(CountCalls("glBindVertexArray") == 2);
+  CHECK(CountCalls("glBindBuffer") == 2);
+
+  //The array buffer binding isn't part of the vertex array
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, 6);
+  RenderState::BindVertexArray(2);
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, 6);
+  CHECK(CountCalls("glBindBuffer") == 3);
+
+  //Deleting the bound vertex array falls back to 0
+  RenderState::ForgetVertexArray(2);
+  RenderState::BindVertexArray(0);
+  CHECK(CountCalls("glBindVertexArray") == 3);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+  CHECK(CountCalls("glBindBuffer") == 4);
+}
+
+TEST_CASE(RenderStateInvalidateReissues) {
+  ResetRenderState();
+
+  RenderState::UseProgram(3);
+  RenderState::BindVertexArray(2);
+  RenderState::Invalidate();
+  RenderState::UseProgram(3);
+  RenderState::BindVertexArray(2);
+  CHECK(CountCalls("glUseProgram") == 2);
+  CHECK(CountCalls("glBindVertexArray") == 2);
+}
+
+TEST_CASE(RenderStateCountsIssuedAndElided) {
+  ResetRenderState();
+
+  RenderState::UseProgram(3);
+  RenderState::UseProgram(3);
+  RenderState::BindVertexArray(2);
+  RenderState::BindVertexArray(2);
+  RenderState::BindVertexArray(2);
+
+  RenderState::BeginFrame();
+  RenderState::Stats stats = RenderState::GetStats();
+  CHECK(stats.issued_ == 2);
+  CHECK(stats.elided_ == 3);
+  CHECK(stats.issued_ == recorded_calls.size());
+}
\ No newline at end of file
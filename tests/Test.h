@@ -0,0 +1,35 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <vector>
+
+//Just enough of a test harness for headless engine code. TEST_CASE registers
+//the function that follows it, CHECK records a failure and carries on.
+
+struct TestCase {
+  const char* name_;
+  void (*function_)(void);
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportFailure(const char* file, const int& line, const char* expression);
+
+struct TestRegistrar {
+  TestRegistrar(const char* name, void (*function)(void)) {
+    GetTestCases().push_back(TestCase { name, function });
+  }
+};
+
+#define TEST_CASE(name) \
+  static void name(void); \
+  static TestRegistrar name##_registrar(#name, name); \
+  static void name(void)
+
+#define CHECK(expression) \
+  do { \
+    if (!(expression)) { \
+      ReportFailure(__FILE__, __LINE__, #expression); \
+    } \
+  } while (false)
+
+#endif
\ No newline at end of file
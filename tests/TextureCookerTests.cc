@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+
+#include "../src/Graphics/TextureCooker.h"
+
+//Cooked blocks are decoded the way the GPU does and compared with the source
+
+static unsigned short ReadShort(const unsigned char* data) {
+  return static_cast<unsigned short>(data[0] | (data[1] << 8));
+}
+
+static void UnpackRGB565(const unsigned short& packed, int* color) {
+  int r = (packed >> 11) & 31;
+  int g = (packed >> 5) & 63;
+  int b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+//BC3's color block always uses the four color mode, BC1 picks it from the endpoint order
+static void DecodeBC1Block(const unsigned char* block, const bool& four_colors, unsigned char* rgba) {
+  const unsigned short color0 = ReadShort(block);
+  const unsigned short color1 = ReadShort(block + 2);
+  const unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<unsigned int>(block[7]) << 24);
+
+  int palette[4][4];
+  UnpackRGB565(color0, palette[0]);
+  UnpackRGB565(color1, palette[1]);
+  palette[0][3] = palette[1][3] = palette[2][3] = 255;
+  if (four_colors || color0 > color1) {
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    palette[3][3] = 255;
+  } else {
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+    palette[3][3] = 0;
+  }
+
+  for (int i = 0; i < 16; ++i) {
+    const int* color = palette[(indices >> (i * 2)) & 3];
+    for (int c = 0; c < 4; ++c) {
+      rgba[i * 4 + c] = static_cast<unsigned char>(color[c]);
+    }
+  }
+}
+
+static void DecodeBC4Block(const unsigned char* block, unsigned char* values, const int& stride) {
+  const int value0 = block[0];
+  const int value1 = block[1];
+  unsigned long long indices = 0;
+  for (int i = 0; i < 6; ++i) {
+    indices |= static_cast<unsigned long long>(block[2 + i]) << (i * 8);
+  }
+
+  int palette[8] = { value0, value1 };
+  if (value0 > value1) {
+    for (int entry = 1; entry < 7; ++entry) {
+      palette[entry + 1] = ((7 - entry) * value0 + entry * value1) / 7;
+    }
+  } else {
+    for (int entry = 1; entry < 5; ++entry) {
+      palette[entry + 1] = ((5 - entry) * value0 + entry * value1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+
+  for (int i = 0; i < 16; ++i) {
+    values[i * stride] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+  }
+}
+
+//Back to tightly packed RGBA8, texels past the edge are dropped
+static std::vector<unsigned char> DecodeMip(const CookedTexture& texture, const size_t& level) {
+  const int width = std::max(texture.width_ >> level, 1);
+  const int height = std::max(texture.height_ >> level, 1);
+  const std::vector<unsigned char>& mip = texture.mips_[level];
+  if (!IsCompressedFormat(texture.format_)) {
+    return mip;
+  }
+
+  std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+  const size_t block_bytes = texture.format_ == TextureFormat::kTextureFormatBC1 ? 8 : 16;
+  const unsigned char* block = mip.data();
+
+  for (int block_y = 0; block_y < height; block_y += 4) {
+    for (int block_x = 0; block_x < width; block_x += 4) {
+      unsigned char texels[16 * 4];
+      if (texture.format_ == TextureFormat::kTextureFormatBC1) {
+        DecodeBC1Block(block, false, texels);
+      } else if (texture.format_ == TextureFormat::kTextureFormatBC3) {
+        DecodeBC1Block(block + 8, true, texels);
+        DecodeBC4Block(block, texels + 3, 4);
+      } else {
+        DecodeBC4Block(block, texels, 4);
+        DecodeBC4Block(block + 8, texels + 1, 4);
+        for (int i = 0; i < 16; ++i) {
+          texels[i * 4 + 2] = 0;
+          texels[i * 4 + 3] = 255;
+        }
+      }
+
+      for (int y = 0; y < 4 && block_y + y < height; ++y) {
+        for (int x = 0; x < 4 && block_x + x < width; ++x) {
+          std::copy(&texels[(y * 4 + x) * 4], &texels[(y * 4 + x) * 4] + 4, &rgba[(static_cast<size_t>(block_y + y) * width + block_x + x) * 4]);
+        }
+      }
+      block += block_bytes;
+    }
+  }
+  return rgba;
+}
+
+//Largest difference in any of the first components channels
+static int GetMaxError(const std::vector<unsigned char>& pixels, const int& components, const std::vector<unsigned char>& rgba) {
+  int error = 0;
+  for (size_t pixel = 0; pixel * components < pixels.size(); ++pixel) {
+    for (int c = 0; c < components; ++c) {
+      error = std::max(error, std::abs(pixels[pixel * components + c] - rgba[pixel * 4 + c]));
+    }
+  }
+  return error;
+}
+
+//Colors along one line through RGB, which BC1's endpoints can follow exactly
+static std::vector<unsigned char> MakeColorRamp(const int& width, const int& height) {
+  std::vector<unsigned char> pixels;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int t = (x + y * width) * 255 / (width * height - 1);
+      pixels.insert(pixels.end(), { static_cast<unsigned char>(t), static_cast<unsigned char>(255 - t / 2), static_cast<unsigned char>(64 + t / 4) });
+    }
+  }
+  return pixels;
+}
+
+TEST_CASE(CookPicksFormatFromChannels) {
+  const std::vector<unsigned char> rgb(4 * 4 * 3, 100);
+  std::vector<unsigned char> rgba(4 * 4 * 4, 100);
+  const std::vector<unsigned char> rg(4 * 4 * 2, 100);
+
+  CHECK(CookTexture(rgb.data(), 4, 4, 3, 8).format_ == TextureFormat::kTextureFormatBC1);
+  //Fully opaque alpha doesn't need the alpha block
+  std::fill(rgba.begin(), rgba.end(), 255);
+  CHECK(CookTexture(rgba.data(), 4, 4, 4, 8).format_ == TextureFormat::kTextureFormatBC1);
+  rgba[3] = 0;
+  CHECK(CookTexture(rgba.data(), 4, 4, 4, 8).format_ == TextureFormat::kTextureFormatBC3);
+  CHECK(CookTexture(rg.data(), 4, 4, 2, 8).format_ == TextureFormat::kTextureFormatBC5);
+
+  TextureCookOptions raw;
+  raw.enabled_ = false;
+  CHECK(CookTexture(rgb.data(), 4, 4, 3, 8, raw).format_ == TextureFormat::kTextureFormatRGBA8);
+}
+
+TEST_CASE(BC1DecodesCloseToSource) {
+  const std::vector<unsigned char> pixels = MakeColorRamp(8, 8);
+  const CookedTexture texture = CookTexture(pixels.data(), 8, 8, 3, 8);
+
+  CHECK(texture.format_ == TextureFormat::kTextureFormatBC1);
+  CHECK(texture.mips_[0].size() == 4 * 8);
+  //A block spans about 110 steps of red, its four palette entries are ~36
+  //apart, so half of that plus 565 rounding
+  CHECK(GetMaxError(pixels, 3, DecodeMip(texture, 0)) <= 20);
+}
+
+TEST_CASE(BC1SolidBlockUsesEqualEndpoints) {
+  std::vector<unsigned char> pixels;
+  for (int i = 0; i < 16; ++i) {
+    pixels.insert(pixels.end(), { 200, 100, 50 });
+  }
+
+  const CookedTexture texture = CookTexture(pixels.data(), 4, 4, 3, 8);
+  const std::vector<unsigned char>& block = texture.mips_[0];
+
+  //Equal endpoints switch a decoder into the three color mode, every index
+  //has to stay on color0 so nothing turns transparent
+  CHECK(ReadShort(block.data()) == ReadShort(block.data() + 2));
+  CHECK(std::all_of(block.begin() + 4, block.end(), [](const unsigned char& byte) { return byte == 0; }));
+
+  const std::vector<unsigned char> rgba = DecodeMip(texture, 0);
+  CHECK(GetMaxError(pixels, 3, rgba) <= 4);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(rgba[i * 4 + 3] == 255);
+  }
+}
+
+TEST_CASE(BC4DecodesCloseToSource) {
+  //Red ramps over the block, green is flat and takes the degenerate path
+  std::vector<unsigned char> pixels;
+  for (int i = 0; i < 16; ++i) {
+    pixels.insert(pixels.end(), { static_cast<unsigned char>(i * 17), 77 });
+  }
+
+  const CookedTexture texture = CookTexture(pixels.data(), 4, 4, 2, 8);
+  CHECK(texture.format_ == TextureFormat::kTextureFormatBC5);
+  CHECK(!texture.srgb_);
+
+  const std::vector<unsigned char>& block = texture.mips_[0];
+  CHECK(block[0] == 255 && block[1] == 0);
+  CHECK(block[8] == 77 && block[9] == 77);
+
+  const std::vector<unsigned char> rgba = DecodeMip(texture, 0);
+  CHECK(GetMaxError(pixels, 2, rgba) <= 18);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(rgba[i * 4 + 1] == 77);
+  }
+}
+
+TEST_CASE(BC3KeepsAlphaCloseToSource) {
+  std::vector<unsigned char> pixels;
+  for (int i = 0; i < 16; ++i) {
+    pixels.insert(pixels.end(), { 40, 80, 120, static_cast<unsigned char>(255 - i * 16) });
+  }
+
+  const CookedTexture texture = CookTexture(pixels.data(), 4, 4, 4, 8);
+  CHECK(texture.format_ == TextureFormat::kTextureFormatBC3);
+  CHECK(GetMaxError(pixels, 4, DecodeMip(texture, 0)) <= 18);
+}
+
+TEST_CASE(MipChainCoversNonPowerOfTwo) {
+  const std::vector<unsigned char> pixels = MakeColorRamp(5, 3);
+  TextureCookOptions raw;
+  raw.enabled_ = false;
+
+  //5x3, 2x1, 1x1
+  const CookedTexture texture = CookTexture(pixels.data(), 5, 3, 3, 8, raw);
+  CHECK(texture.mips_.size() == 3);
+  CHECK(texture.mips_[0].size() == 5 * 3 * 4);
+  CHECK(texture.mips_[1].size() == 2 * 1 * 4);
+  CHECK(texture.mips_[2].size() == 4);
+
+  //Blocks cover the partial edges, every level is at least one block
+  const CookedTexture compressed = CookTexture(pixels.data(), 5, 3, 3, 8);
+  CHECK(compressed.mips_.size() == 3);
+  CHECK(compressed.mips_[0].size() == 2 * 1 * 8);
+  CHECK(compressed.mips_[1].size() == 8);
+  CHECK(compressed.mips_[2].size() == 8);
+
+  CHECK(GetMipSize(TextureFormat::kTextureFormatBC1, 5, 3) == 16);
+  CHECK(GetMipSize(TextureFormat::kTextureFormatBC3, 9, 1) == 3 * 16);
+  CHECK(GetMipSize(TextureFormat::kTextureFormatBC5, 1, 1) == 16);
+  CHECK(GetMipSize(TextureFormat::kTextureFormatRGBA8, 7, 3) == 7 * 3 * 4);
+
+  const std::vector<unsigned char> column(1 * 7 * 3, 10);
+  CHECK(CookTexture(column.data(), 1, 7, 3, 8, raw).mips_.size() == 3);
+  CHECK(CookTexture(column.data(), 1, 1, 3, 8, raw).mips_.size() == 1);
+}
+
+TEST_CASE(SrgbDownsampleAveragesInLinearSpace) {
+  //Two black and two white texels, half transparent
+  const std::vector<unsigned char> pixels = {
+    0, 0, 0, 128,       255, 255, 255, 128,
+    255, 255, 255, 128, 0, 0, 0, 128,
+  };
+
+  TextureCookOptions options;
+  options.enabled_ = false;
+
+  options.srgb_ = true;
+  const CookedTexture srgb = CookTexture(pixels.data(), 2, 2, 4, 8, options);
+  options.srgb_ = false;
+  const CookedTexture linear = CookTexture(pixels.data(), 2, 2, 4, 8, options);
+
+  //Half the light is 0.735 in sRGB, not 0.5
+  CHECK(srgb.mips_[1][0] >= 186 && srgb.mips_[1][0] <= 189);
+  CHECK(linear.mips_[1][0] == 128);
+  //Alpha is never gamma corrected
+  CHECK(srgb.mips_[1][3] == 128);
+  CHECK(linear.mips_[1][3] == 128);
+}
+
+static std::vector<char> ReadBytes(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteBytes(const std::string& path, const std::vector<char>& bytes) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(bytes.data(), bytes.size());
+}
+
+TEST_CASE(ReadCookedTextureRejectsDamagedFiles) {
+  const std::string path = (std::filesystem::temp_directory_path() / "rune_test_texture.rtex").string();
+  const std::vector<unsigned char> pixels = MakeColorRamp(8, 8);
+  const CookedTexture texture = CookTexture(pixels.data(), 8, 8, 3, 8);
+
+  CHECK(WriteCookedTexture(path, texture));
+  CookedTexture read;
+  CHECK(ReadCookedTexture(path, read));
+  CHECK(read.format_ == texture.format_ && read.srgb_ == texture.srgb_ && read.mips_ == texture.mips_);
+
+  const std::vector<char> bytes = ReadBytes(path);
+
+  std::vector<char> truncated(bytes.begin(), bytes.end() - 1);
+  WriteBytes(path, truncated);
+  CHECK(!ReadCookedTexture(path, read));
+
+  std::vector<char> oversized = bytes;
+  oversized.push_back(0);
+  WriteBytes(path, oversized);
+  CHECK(!ReadCookedTexture(path, read));
+
+  //Width right after magic, version, format and the sRGB flag
+  std::vector<char> huge = bytes;
+  const int width = 1 << 30;
+  std::copy(reinterpret_cast<const char*>(&width), reinterpret_cast<const char*>(&width) + sizeof(width), huge.begin() + 13);
+  WriteBytes(path, huge);
+  CHECK(!ReadCookedTexture(path, read));
+
+  //The reads that failed left the output alone
+  CHECK(read.mips_ == texture.mips_);
+
+  std::filesystem::remove(path);
+}
\ No newline at end of file
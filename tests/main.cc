@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Test.h"
+
+//Runs every test, or only the ones named on the command line. Exits with 1
+//if anything failed.
+
+static unsigned int current_failures = 0;
+
+std::vector<TestCase>& GetTestCases() {
+  static std::vector<TestCase> test_cases;
+  return test_cases;
+}
+
+void ReportFailure(const char* file, const int& line, const char* expression) {
+  std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+  ++current_failures;
+}
+
+static bool IsSelected(const char* name, int argc, char** argv) {
+  if (argc < 2) {
+    return true;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  unsigned int passed = 0;
+  unsigned int failed = 0;
+
+  for (const TestCase& test_case : GetTestCases()) {
+    if (!IsSelected(test_case.name_, argc, argv)) {
+      continue;
+    }
+
+    current_failures = 0;
+    test_case.function_();
+
+    std::printf("[%s] %s\n", current_failures == 0 ? "  OK  " : " FAIL ", test_case.name_);
+    if (current_failures == 0) {
+      ++passed;
+    } else {
+      ++failed;
+    }
+  }
+
+  std::printf("%u passed, %u failed\n", passed, failed);
+  return failed == 0 ? 0 : 1;
+}
\ No newline at end of file